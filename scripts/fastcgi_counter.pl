@@ -0,0 +1,34 @@
+#!/usr/bin/perl -w
+
+use strict;
+use warnings;
+
+use CGI::Fast;
+
+# This script is started only once and stays resident as a FastCGI responder.
+# See the 'fastcgi' setting in the [perl] section of peb.ini.
+my $request_counter = 0;
+
+while (my $query = CGI::Fast->new) {
+	$request_counter++;
+
+	print "Content-type: text/html; charset=utf-8\n\n";
+
+	print "<html>\n";
+
+	print "<head>\n";
+	print "<title>Perl Executing Browser - FastCGI Counter</title>\n";
+	print "<meta http-equiv='Content-Type' content='text/html; charset=utf-8'>\n";
+	print "</head>\n";
+
+	print "<body>\n";
+	print "<p align='center'><font size='5' face='SansSerif'>\n";
+	print "Request number $request_counter served by process $$.\n";
+	print "</font></p>\n";
+	print "<p align='center'><font size='5' face='SansSerif'>\n";
+	print "<a href='http://perl-executing-browser-pseudodomain/scripts/fastcgi_counter.pl'>Next request</a>\n";
+	print "</font></p>\n";
+	print "</body>\n";
+
+	print "</html>\n";
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/perl -w
+
+use strict;
+use warnings;
+
+$|=1; # Disable in-built Perl buffering
+
+# Output benchmark:
+# prints megabytes of log lines, 100 by default.
+# Size can be changed from the query string: ?megabytes=10
+# Mixed ASCII and Cyrillic lines are printed with: ?cyrillic=1
+# Output size and throughput are logged by the browser when the script ends.
+# Throughput should not drop for bigger output sizes.
+
+my $megabytes = 100;
+my $cyrillic = 0;
+if (defined $ENV{'QUERY_STRING'}) {
+	if ($ENV{'QUERY_STRING'} =~ m/megabytes=(\d+)/) {
+		$megabytes = $1;
+	}
+	if ($ENV{'QUERY_STRING'} =~ m/cyrillic=1/) {
+		$cyrillic = 1;
+	}
+}
+
+print <<HEADER
+<html>
+
+	<head>
+	<title>Perl Executing Browser - Output Benchmark</title>
+	<meta http-equiv='Content-Type' content='text/html; charset=utf-8'>
+	</head>
+
+	<body>
+		<p align='center'><font size='5'>Output Benchmark - $megabytes MB</font></p>
+		<pre>
+HEADER
+;
+
+my $line = "Log line " . ("x" x 90);
+if ($cyrillic == 1) {
+	# UTF-8 encoded "Ред на " - two bytes per Cyrillic letter:
+	$line = "Log line " . ("x" x 40) . " " .
+		("\xD0\xA0\xD0\xB5\xD0\xB4 \xD0\xBD\xD0\xB0 " x 3);
+}
+my $line_length = length ($line) + 1;
+my $lines = int ($megabytes * 1024 * 1024 / $line_length);
+my $start = time();
+
+for (my $counter = 1; $counter <= $lines; $counter++) {
+	print "$line\n";
+}
+
+my $seconds = time() - $start;
+
+print <<FOOTER
+		</pre>
+		<p align='center'><font size='5'>
+		$lines lines printed in $seconds seconds.
+		</font></p>
+	</body>
+
+</html>
+FOOTER
+;
@@ -29,7 +29,13 @@
 // ZIP PACKAGES SUPPORT:
 // ==============================
 #if ZIP_SUPPORT == 1
-#include <quazip/JlCompress.h> // for unpacking root folder from a zip file
+#if QT_VERSION >= 0x050000
+// Qt5 code:
+#include <QStandardPaths> // for the cache folder of extracted packages
+#else
+// Qt4 code:
+#include <QDesktopServices> // for the cache folder of extracted packages
+#endif
 #endif
 
 // ==============================
@@ -98,6 +104,9 @@ void customMessageHandler(QtMsgType type, const char *message)
 // ==============================
 // MAIN APPLICATION DEFINITION:
 // ==============================
+// The programs in the 'tests' folder compile this file
+// with PEB_TESTS defined and have their own main().
+#ifndef PEB_TESTS
 int main(int argc, char **argv)
 {
     QApplication application(argc, argv);
@@ -312,38 +321,58 @@ int main(int argc, char **argv)
     applicationOutputDirectory.mkpath(".");
 
     // ==============================
-    // EXTRACT ROOT FOLDER FROM A ZIP PACKAGE:
+    // MOUNT ROOT FOLDER FROM A ZIP PACKAGE:
     // ==============================
 #if ZIP_SUPPORT == 1
     QString defaultZipPackageName = QApplication::applicationDirPath()
             + QDir::separator() + "default.peb";
     QFile defaultZipPackage(defaultZipPackageName);
-    QStringList extractedFiles;
+    bool zipPackageFound = false;
     bool zipPackageRootFolderConformant = false;
     bool zipPackageConfigurationFileConformant = false;
 
-    if (defaultZipPackage.exists()) {
-        QStringList allZipPackageEntries =
-                JlCompress::getFileList(defaultZipPackageName);
-        foreach (QString fileEntry, allZipPackageEntries) {
-            if (fileEntry.contains("root/")) {
-                zipPackageRootFolderConformant = true;
-            }
-            if (fileEntry.contains("peb.ini")) {
-                zipPackageConfigurationFileConformant = true;
-            }
-        }
-        // Extracting root folder from a ZIP file:
+    // Extracted entries are kept between sessions in the cache folder
+    // of the user or in the temporary folder of the session:
+#if QT_VERSION >= 0x050000
+    // Qt5 code:
+    QString packageCacheDirectoryName =
+            QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    // Qt4 code:
+    QString packageCacheDirectoryName =
+            QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+    if (packageCacheDirectoryName.length() == 0) {
+        packageCacheDirectoryName = applicationTempDirectoryName;
+    }
+    packageCacheDirectoryName = QDir::toNativeSeparators(
+                packageCacheDirectoryName + QDir::separator() + "packages");
+
+    // The root folder is not extracted, but served from the package
+    // at the place where the extraction would put it:
+    if (defaultZipPackage.exists() and
+            ZipPackage::instance()->mount(defaultZipPackageName,
+                                          packageCacheDirectoryName)) {
+        zipPackageFound = true;
+        QString packageRootDirName =
+                ZipPackage::instance()->mountDirectoryName()
+                + QDir::separator() + "root";
+        QString packageSettingsFileName =
+                packageRootDirName + QDir::separator() + "peb.ini";
+
+        zipPackageRootFolderConformant =
+                ZipPackage::instance()->contains(packageRootDirName);
+        zipPackageConfigurationFileConformant =
+                ZipPackage::instance()->contains(packageSettingsFileName);
+
         if (zipPackageRootFolderConformant == true and
                 zipPackageConfigurationFileConformant == true) {
-            extractedFiles =
-                    JlCompress::extractDir(defaultZipPackageName,
-                                           applicationTempDirectoryName);
-
-            // Settings file from the extracted ZIP package:
-            settingsDirName = applicationTempDirectoryName
-                    + QDir::separator() + "root";
-            settingsFileName = settingsDirName + QDir::separator() + "peb.ini";
+            // Settings file is the only entry extracted at startup:
+            ZipPackage::instance()->extract(packageSettingsFileName);
+            settingsDirName = packageRootDirName;
+            settingsFileName = packageSettingsFileName;
+        } else {
+            ZipPackage::instance()->unmount();
         }
     }
 #endif
@@ -430,6 +459,51 @@ int main(int argc, char **argv)
     }
     application.setProperty("perlInterpreter", perlInterpreter);
 
+    // Scripts started as persistent FastCGI responders:
+    QStringList fastCgiScripts;
+    int fastCgiSize = settings.beginReadArray("perl/fastcgi");
+    for (int index = 0; index < fastCgiSize; ++index) {
+        settings.setArrayIndex(index);
+        QString fastCgiSetting = settings.value("name").toString();
+        fastCgiScripts.append(
+                    QDir::toNativeSeparators(rootDirName + fastCgiSetting));
+    }
+    settings.endArray();
+#ifdef Q_OS_WIN
+    // FCGI_SOCKET_PATH is a Unix domain socket in the temporary folder:
+    fastCgiScripts.clear();
+#endif
+    application.setProperty("fastCgiScripts", fastCgiScripts);
+
+    // Trusted scripts run by the embedded Perl interpreter:
+    QStringList embeddedScripts;
+    int embeddedSize = settings.beginReadArray("perl/embedded");
+    for (int index = 0; index < embeddedSize; ++index) {
+        settings.setArrayIndex(index);
+        QString embeddedSetting = settings.value("name").toString();
+        embeddedScripts.append(
+                    QDir::toNativeSeparators(rootDirName + embeddedSetting));
+    }
+    settings.endArray();
+    application.setProperty("embeddedScripts", embeddedScripts);
+
+    // Fork-server with preloaded modules for ordinary scripts:
+    QString zygote = settings.value("perl/zygote").toString();
+#ifdef Q_OS_WIN
+    // There is no fork() on Windows:
+    zygote = "disable";
+#endif
+    application.setProperty("zygote", zygote);
+
+    QStringList zygotePreloadModules;
+    int zygotePreloadSize = settings.beginReadArray("perl/zygote_preload");
+    for (int index = 0; index < zygotePreloadSize; ++index) {
+        settings.setArrayIndex(index);
+        zygotePreloadModules.append(settings.value("name").toString());
+    }
+    settings.endArray();
+    application.setProperty("zygotePreloadModules", zygotePreloadModules);
+
     // PERLLIB environment variable:
     QString perlLibSetting = settings.value("perl/perllib").toString();
     QDir perlLibDir(perlLibSetting);
@@ -456,17 +530,81 @@ int main(int argc, char **argv)
                 QDir::toNativeSeparators(debuggerHtmlTemplateSetting);
     }
     application.setProperty("debuggerHtmlTemplate", debuggerHtmlTemplate);
+#if ZIP_SUPPORT == 1
+    ZipPackage::instance()->extract(debuggerHtmlTemplate);
+#endif
 
     // Display or hide STDERR from scripts:
     QString displayStderr =
             settings.value("perl/perl_display_stderr").toString();
     application.setProperty("displayStderr", displayStderr);
 
+    // Maximal number of updates per second with output from a script:
+    QString outputFrameRate =
+            settings.value("perl/perl_output_frame_rate").toString();
+    application.setProperty("outputFrameRate", outputFrameRate);
+
+    // Megabytes of output from a script kept in memory before spilling to disk:
+    QString outputMemoryLimit =
+            settings.value("perl/perl_output_memory_limit").toString();
+    application.setProperty("outputMemoryLimit", outputMemoryLimit);
+
+    // Opt-in cache for responses of GET scripts:
+    QString responseCache =
+            settings.value("perl/perl_response_cache").toString();
+    application.setProperty("responseCache", responseCache);
+
+    QString responseCacheSize =
+            settings.value("perl/perl_response_cache_size").toString();
+    application.setProperty("responseCacheSize", responseCacheSize);
+
+    QString responseCachePersistence =
+            settings.value("perl/perl_response_cache_persistence").toString();
+    application.setProperty("responseCachePersistence",
+                            responseCachePersistence);
+
     // Timeout for CGI scripts (not long-running ones):
     QString scriptTimeout =
             settings.value("perl/perl_script_timeout").toString();
     application.setProperty("scriptTimeout", scriptTimeout);
 
+    // Milliseconds until the first output of CGI scripts
+    // and between two outputs of all scripts (0 means no deadline):
+    QString firstByteTimeout =
+            settings.value("perl/perl_first_byte_timeout").toString();
+    application.setProperty("firstByteTimeout", firstByteTimeout);
+
+    QString idleOutputTimeout =
+            settings.value("perl/perl_idle_output_timeout").toString();
+    application.setProperty("idleOutputTimeout", idleOutputTimeout);
+
+    // Maximal number of scripts running at once in all windows:
+    QString maximumRunningScripts =
+            settings.value("perl/perl_maximum_running_scripts").toString();
+    application.setProperty("maximumRunningScripts", maximumRunningScripts);
+
+    // Resource limits of script processes (0 means no limit):
+    QString cpuTimeLimit =
+            settings.value("perl/perl_cpu_time_limit").toString();
+    application.setProperty("cpuTimeLimit", cpuTimeLimit);
+
+    QString addressSpaceLimit =
+            settings.value("perl/perl_memory_limit").toString();
+    application.setProperty("addressSpaceLimit", addressSpaceLimit);
+
+    QString openFilesLimit =
+            settings.value("perl/perl_open_files_limit").toString();
+    application.setProperty("openFilesLimit", openFilesLimit);
+
+    QString niceLevel =
+            settings.value("perl/perl_nice_level").toString();
+    application.setProperty("niceLevel", niceLevel);
+
+    // Milliseconds between SIGTERM and SIGKILL for stopped scripts:
+    QString terminationGracePeriod =
+            settings.value("perl/perl_termination_grace_period").toString();
+    application.setProperty("terminationGracePeriod", terminationGracePeriod);
+
     // Source viewer script path:
     QString sourceViewerSetting =
             settings.value("perl/perl_source_viewer").toString();
@@ -522,7 +660,12 @@ int main(int argc, char **argv)
 
     // Check if start page exists:
     QFile startPageFile(startPage);
-    if (!startPageFile.exists()) {
+    bool startPageFound = startPageFile.exists();
+#if ZIP_SUPPORT == 1
+    startPageFound = (startPageFound or
+                      ZipPackage::instance()->contains(startPage));
+#endif
+    if (startPageFound == false) {
         QMessageBox missingStartPageMessageBox;
         missingStartPageMessageBox.setWindowModality(Qt::WindowModal);
         missingStartPageMessageBox.setIcon(QMessageBox::Critical);
@@ -583,6 +726,9 @@ int main(int argc, char **argv)
         }
     }
 
+#if ZIP_SUPPORT == 1
+    ZipPackage::instance()->extract(iconPathName);
+#endif
     QFile iconFile(iconPathName);
     QPixmap icon(32, 32);
     if (iconFile.exists()) {
@@ -637,6 +783,9 @@ int main(int argc, char **argv)
                     QDir::toNativeSeparators(systrayIconPathNameSetting);
         }
         application.setProperty("systrayIconPathName", systrayIconPathName);
+#if ZIP_SUPPORT == 1
+        ZipPackage::instance()->extract(systrayIconPathName);
+#endif
     }
 
     // System tray icon double-click action:
@@ -677,6 +826,14 @@ int main(int argc, char **argv)
     }
     application.setProperty("allThemesDirectory", allThemesDirectory);
 
+#if ZIP_SUPPORT == 1
+    // Themes are copied and written on disk:
+    ZipPackage::instance()->extract(allThemesDirectory);
+    ZipPackage::instance()->extract(defaultThemeDirectory
+                                    + QDir::separator() + "current.css");
+    QDir().mkpath(defaultThemeDirectory);
+#endif
+
     // Check if default theme file exists, if not - copy it from themes folder:
     if (!QFile::exists(defaultThemeDirectory
                        + QDir::separator()
@@ -706,6 +863,10 @@ int main(int argc, char **argv)
     application.setProperty("allTranslationsDirectory",
                             allTranslationsDirectory);
 
+#if ZIP_SUPPORT == 1
+    ZipPackage::instance()->extract(allTranslationsDirectory);
+#endif
+
     // Install default translation, if any:
     QTranslator translator;
     if (defaultTranslation != "none") {
@@ -726,6 +887,9 @@ int main(int argc, char **argv)
         helpDirectory = QDir::toNativeSeparators(helpDirectorySetting);
     }
     application.setProperty("helpDirectory", helpDirectory);
+#if ZIP_SUPPORT == 1
+    ZipPackage::instance()->extract(helpDirectory);
+#endif
 
     // LOGGING:
     // Logging enable/disable switch:
@@ -816,18 +980,20 @@ int main(int argc, char **argv)
     // ZIP package without:
     // (1.) root folder named 'root' and
     // (2.) configuration file named 'peb.ini'.
-    if (zipPackageRootFolderConformant == false or
-            zipPackageConfigurationFileConformant == false) {
+    if (zipPackageFound == true and
+            (zipPackageRootFolderConformant == false or
+             zipPackageConfigurationFileConformant == false)) {
         qDebug() << "Non-standard ZIP package found!";
-        qDebug() << "It was not extracted and used.";
+        qDebug() << "It was not mounted and used.";
     }
 
-    // Log all extracted archive entries from a ZIP package:
-    if (extractedFiles.length() > 0) {
-        qDebug() << "ZIP package found and the following entries were extracted:";
-        foreach (QString fileEntry, extractedFiles) {
-            qDebug() << fileEntry;
-        }
+    if (ZipPackage::instance()->isMounted()) {
+        qDebug() << "Root folder is served from ZIP package:"
+                 << defaultZipPackageName;
+        qDebug() << "ZIP package entries extracted at startup:"
+                 << ZipPackage::instance()->extractedEntries;
+        qDebug() << "ZIP package entries reused from cache:"
+                 << ZipPackage::instance()->reusedEntries;
     }
 #endif
 
@@ -847,11 +1013,38 @@ int main(int argc, char **argv)
     }
     qDebug() << "Perl interpreter" << perlInterpreter;
     qDebug() << "PERLLIB folder:" << perlLib;
+    qDebug() << "FastCGI responders:";
+    foreach (QString fastCgiScript, fastCgiScripts) {
+        qDebug() << fastCgiScript;
+    }
+    if (EMBEDDED_PERL == 1) {
+        qDebug() << "Scripts run by the embedded Perl interpreter:";
+        foreach (QString embeddedScript, embeddedScripts) {
+            qDebug() << embeddedScript;
+        }
+    }
+    qDebug() << "Fork-server:" << zygote;
+    qDebug() << "Fork-server preloaded modules:" << zygotePreloadModules;
     if (PERL_DEBUGGER_INTERACTION == 1) {
         qDebug() << "Debugger HTML template:" << debuggerHtmlTemplate;
     }
     qDebug() << "Display STDERR from scripts:" << displayStderr;
+    qDebug() << "Script output frame rate:" << outputFrameRate;
+    qDebug() << "Script output memory limit:" << outputMemoryLimit << "MB";
+    qDebug() << "Script response cache:" << responseCache;
+    qDebug() << "Script response cache size:" << responseCacheSize << "MB";
+    qDebug() << "Script response cache persistence:"
+             << responseCachePersistence;
     qDebug() << "Script Timeout:" << scriptTimeout;
+    qDebug() << "Script first byte timeout:" << firstByteTimeout << "msecs";
+    qDebug() << "Script idle output timeout:" << idleOutputTimeout << "msecs";
+    qDebug() << "Maximal running scripts:" << maximumRunningScripts;
+    qDebug() << "Script CPU time limit:" << cpuTimeLimit << "seconds";
+    qDebug() << "Script memory limit:" << addressSpaceLimit << "MB";
+    qDebug() << "Script open files limit:" << openFilesLimit;
+    qDebug() << "Script nice level:" << niceLevel;
+    qDebug() << "Script termination grace period:"
+             << terminationGracePeriod << "msecs";
     qDebug() << "Source viewer:" << sourceViewer;
     qDebug() << "Source viewer arguments:" << sourceViewerArguments;
 
@@ -901,6 +1094,31 @@ int main(int argc, char **argv)
     qDebug() << "Logfiles prefix:" << logPrefix;
     qDebug() << "===============";
 
+    // ==============================
+    // ROOT INDEX INITIALIZATION:
+    // ==============================
+    // The root directory is scanned in the background and
+    // the file system is used until the scan is finished:
+    RootIndex::instance()->startScan();
+
+    // ==============================
+    // FORK-SERVER INITIALIZATION:
+    // ==============================
+    // Module preloading runs in the background and
+    // scripts are started as new processes until it is ready:
+    if (zygote == "enable") {
+        ZygoteServer::instance()->startSlot();
+    }
+
+#if EMBEDDED_PERL == 1
+    // ==============================
+    // EMBEDDED PERL INITIALIZATION:
+    // ==============================
+    if (embeddedScripts.length() > 0) {
+        EmbeddedPerl::instance()->initialize();
+    }
+#endif
+
     // ==============================
     // MAIN GUI CLASS INITIALIZATION:
     // ==============================
@@ -930,37 +1148,709 @@ int main(int argc, char **argv)
 
     return application.exec();
 }
+#endif // PEB_TESTS
 
 // ==============================
 // FILE DETECTOR CLASS CONSTRUCTOR:
 // ==============================
 FileDetector::FileDetector()
+    : QObject(qApp)
+{
+    // Case-folded suffixes of all file types known to the browser:
+    fileTypes.insert("htm", "browser-html");
+    fileTypes.insert("html", "browser-html");
+    fileTypes.insert("xhtml", "browser-html");
+    fileTypes.insert("css", "browser-css");
+    fileTypes.insert("js", "browser-js");
+    fileTypes.insert("png", "browser-image");
+    fileTypes.insert("jpg", "browser-image");
+    fileTypes.insert("jpeg", "browser-image");
+    fileTypes.insert("gif", "browser-image");
+    fileTypes.insert("pl", "perl");
+
+    // Content types of files served from the ZIP package:
+    mimeTypes.insert("htm", "text/html");
+    mimeTypes.insert("html", "text/html");
+    mimeTypes.insert("xhtml", "application/xhtml+xml");
+    mimeTypes.insert("css", "text/css");
+    mimeTypes.insert("js", "application/javascript");
+    mimeTypes.insert("json", "application/json");
+    mimeTypes.insert("xml", "application/xml");
+    mimeTypes.insert("txt", "text/plain");
+    mimeTypes.insert("png", "image/png");
+    mimeTypes.insert("jpg", "image/jpeg");
+    mimeTypes.insert("jpeg", "image/jpeg");
+    mimeTypes.insert("gif", "image/gif");
+    mimeTypes.insert("bmp", "image/bmp");
+    mimeTypes.insert("ico", "image/x-icon");
+    mimeTypes.insert("svg", "image/svg+xml");
+    mimeTypes.insert("webp", "image/webp");
+    mimeTypes.insert("ttf", "font/ttf");
+    mimeTypes.insert("otf", "font/otf");
+    mimeTypes.insert("woff", "font/woff");
+    mimeTypes.insert("woff2", "font/woff2");
+    mimeTypes.insert("pdf", "application/pdf");
+
+    shebangReads = 0;
+}
+
+// ==============================
+// UTF-8 STREAM DECODER CLASS CONSTRUCTOR:
+// ==============================
+Utf8StreamDecoder::Utf8StreamDecoder()
     : QObject(0)
 {
-    // Regular expressions for file type detection by shebang line:
-    perlShebang.setPattern("#!/.{1,}perl");
+}
 
-    // Regular expressions for file type detection by extension:
-    htmlExtensions.setPattern("htm");
-    htmlExtensions.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// CGI RESPONSE PARSER CLASS CONSTRUCTOR:
+// ==============================
+CgiResponseParser::CgiResponseParser()
+    : QObject(0)
+{
+    headersComplete = false;
+    lineStart = 0;
+    resetHeaders();
+}
+
+// ==============================
+// RENDER SCHEDULER CLASS CONSTRUCTOR:
+// ==============================
+RenderScheduler::RenderScheduler()
+    : QObject(0)
+{
+    committedUpdates = 0;
+    coalescedUpdates = 0;
+    droppedUpdates = 0;
+    updatePending = false;
+
+    int frameRate = qApp->property("outputFrameRate").toInt();
+    if (frameRate <= 0) {
+        frameRate = 60;
+    }
+    frameInterval = 1000 / frameRate;
+
+    commitTimer.setSingleShot(true);
+    QObject::connect(&commitTimer, SIGNAL(timeout()),
+                     this, SLOT(commitSlot()));
+}
+
+// ==============================
+// SCRIPT SPOOL CLASS CONSTRUCTOR:
+// ==============================
+ScriptSpool::ScriptSpool()
+    : QObject(0)
+{
+    segmentOffset = 0;
+    memoryBytes = 0;
+    memoryLimit = (qint64) qApp->property("outputMemoryLimit").toInt()
+            * 1048576;
+    if (memoryLimit <= 0) {
+        memoryLimit = 16777216;
+    }
+    availableBytes = 0;
+    spooledBytes = 0;
+    spoolReadOffset = 0;
+    mappedWindow = 0;
+    mappedOffset = 0;
+    mappedSize = 0;
+}
+
+// ==============================
+// SCRIPT OUTPUT BUFFER CLASS CONSTRUCTOR:
+// ==============================
+ScriptOutputBuffer::ScriptOutputBuffer()
+    : QObject(0)
+{
+    totalBytes = 0;
+    themeLinkPending = false;
+}
+
+// ==============================
+// SCRIPT RESPONSE CACHE CLASS CONSTRUCTOR:
+// ==============================
+ScriptResponseCache::ScriptResponseCache()
+    : QObject(qApp)
+{
+    enabled = ((qApp->property("responseCache").toString()) == "enable");
+    persistent = ((qApp->property("responseCachePersistence").toString())
+                  == "enable");
+
+    int cacheSize = qApp->property("responseCacheSize").toInt();
+    if (cacheSize <= 0) {
+        cacheSize = 32;
+    }
+    entries.setMaxCost(cacheSize * 1048576);
+
+    cacheDirectory = QDir::toNativeSeparators(
+                (qApp->property("applicationTempDirectory").toString())
+                + QDir::separator() + "response-cache");
+    if (persistent == true) {
+        QDir().mkpath(cacheDirectory);
+    }
+}
+
+// ==============================
+// SCRIPT REPLY CLASS CONSTRUCTOR:
+// ==============================
+ScriptReply::ScriptReply(QObject *parent,
+                         QNetworkAccessManager::Operation operation,
+                         const QNetworkRequest &request)
+    : QNetworkReply(parent)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(operation);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    // Defaults for scripts printing no CGI headers:
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, "OK");
+    setHeader(QNetworkRequest::ContentTypeHeader, "text/html; charset=utf-8");
+
+    bodyStarted = false;
+    metaDataAnnounced = false;
+    uploadSize = -1;
+
+    QObject::connect(&renderScheduler, SIGNAL(renderSignal()),
+                     this, SLOT(deliverSlot()));
+    replyClosing = false;
+}
+
+#if ZIP_SUPPORT == 1
+// ==============================
+// PACKAGE REPLY CLASS CONSTRUCTOR:
+// ==============================
+PackageReply::PackageReply(QObject *parent,
+                           const QNetworkRequest &request,
+                           QString packagedFilePath)
+    : QNetworkReply(parent)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    fullFilePath = packagedFilePath;
+    readPosition = 0;
+
+    QTimer::singleShot(0, this, SLOT(inflateSlot()));
+}
+#endif
+
+// ==============================
+// SCRIPT PIPE WORKER CLASS CONSTRUCTOR:
+// ==============================
+ScriptPipeWorker::ScriptPipeWorker(QObject *consumer)
+    : QObject(0), ringBuffer(256)
+{
+    this->consumer = consumer;
+    htmlTextOutput = false;
+    outputReceived = false;
+    headersHandedOver = false;
+}
 
-    cssExtension.setPattern("css");
-    cssExtension.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// SCRIPT REQUEST CLASS CONSTRUCTOR:
+// ==============================
+ScriptRequest::ScriptRequest(QObject *consumer)
+    : ScriptPipeWorker(consumer)
+{
+}
 
-    jsExtension.setPattern("js");
-    jsExtension.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// FASTCGI REQUEST CLASS CONSTRUCTOR:
+// ==============================
+FastCgiRequest::FastCgiRequest(QObject *consumer,
+                               QString socketName, quint16 requestId,
+                               QProcessEnvironment params,
+                               QByteArray stdinData)
+    : ScriptRequest(consumer)
+{
+    executionMode = "persistent FastCGI responder.";
+
+    this->socketName = socketName;
+    this->requestId = requestId;
+    this->params = params;
+    pendingInput = stdinData;
+
+    connectedOnce = false;
+    inputRequested = false;
+    inputClosing = false;
+    requestFinished = false;
+    disconnectionPending = false;
+    connectionAttempts = 0;
+
+    // The socket is a child of the request and
+    // moves with it to the I/O thread.
+    // A bounded read buffer lets a paused request stop reading:
+    socket = new QLocalSocket(this);
+    socket->setReadBufferSize(readChunkSize);
+
+    QObject::connect(socket, SIGNAL(connected()),
+                     this, SLOT(connectedSlot()));
+    QObject::connect(socket, SIGNAL(readyRead()),
+                     this, SLOT(readyReadSlot()));
+    QObject::connect(socket,
+                     SIGNAL(error(QLocalSocket::LocalSocketError)),
+                     this,
+                     SLOT(socketErrorSlot(QLocalSocket::LocalSocketError)));
+    QObject::connect(socket, SIGNAL(disconnected()),
+                     this, SLOT(disconnectedSlot()));
+    QObject::connect(socket, SIGNAL(bytesWritten(qint64)),
+                     this, SLOT(inputWrittenSlot()));
+}
 
-    pngExtension.setPattern("png");
-    pngExtension.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// FASTCGI RESPONDER CLASS CONSTRUCTOR:
+// ==============================
+FastCgiResponder::FastCgiResponder(QString scriptFullFilePath)
+    : QObject(qApp)
+{
+    this->scriptFullFilePath = scriptFullFilePath;
+    lastRequestId = 0;
+
+    // Responders run in a process group of their own and
+    // with the limits of all scripts except for the CPU time:
+    responderProcess = new GovernedProcess(this);
+    responderProcess->removeCpuTimeLimit();
+
+    // Unix domain socket paths are short, so
+    // the socket is named after a hash of the script path:
+    socketName = QDir::toNativeSeparators(
+                (qApp->property("applicationTempDirectory").toString())
+                + QDir::separator() + "fastcgi-"
+                + QString(QCryptographicHash::hash(
+                              scriptFullFilePath.toUtf8(),
+                              QCryptographicHash::Md5).toHex().left(12))
+                + ".sock");
+
+    QObject::connect(responderProcess, SIGNAL(readyReadStandardOutput()),
+                     this, SLOT(responderOutputSlot()));
+    QObject::connect(responderProcess, SIGNAL(readyReadStandardError()),
+                     this, SLOT(responderErrorSlot()));
+    QObject::connect(responderProcess,
+                     SIGNAL(finished(int, QProcess::ExitStatus)),
+                     this,
+                     SLOT(responderFinishedSlot(int, QProcess::ExitStatus)));
+}
 
-    jpgExtensions.setPattern("jpe{0,1}g");
-    jpgExtensions.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// ZYGOTE REQUEST CLASS CONSTRUCTOR:
+// ==============================
+ZygoteRequest::ZygoteRequest(QObject *consumer,
+                             QString socketName, QString scriptFullFilePath,
+                             QString workingDirectory,
+                             QProcessEnvironment environment,
+                             QByteArray stdinData)
+    : ScriptRequest(consumer)
+{
+    executionMode = "child of the preloaded fork-server.";
+
+    this->socketName = socketName;
+    this->scriptFullFilePath = scriptFullFilePath;
+    this->workingDirectory = workingDirectory;
+    this->environment = environment;
+    pendingInput = stdinData;
+
+    processGroup = 0;
+    connected = false;
+    inputRequested = false;
+    inputClosing = false;
+    requestFinished = false;
+    disconnectionPending = false;
+
+    // The socket is a child of the request and
+    // moves with it to the I/O thread.
+    // A bounded read buffer lets a paused request stop reading:
+    socket = new QLocalSocket(this);
+    socket->setReadBufferSize(readChunkSize);
+
+    QObject::connect(socket, SIGNAL(connected()),
+                     this, SLOT(connectedSlot()));
+    QObject::connect(socket, SIGNAL(readyRead()),
+                     this, SLOT(readyReadSlot()));
+    QObject::connect(socket,
+                     SIGNAL(error(QLocalSocket::LocalSocketError)),
+                     this,
+                     SLOT(socketErrorSlot(QLocalSocket::LocalSocketError)));
+    QObject::connect(socket, SIGNAL(disconnected()),
+                     this, SLOT(disconnectedSlot()));
+    QObject::connect(socket, SIGNAL(bytesWritten(qint64)),
+                     this, SLOT(inputWrittenSlot()));
+}
 
-    gifExtension.setPattern("gif");
-    gifExtension.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// ZYGOTE SERVER CLASS CONSTRUCTOR:
+// ==============================
+ZygoteServer::ZygoteServer()
+    : QObject(qApp)
+{
+    zygoteReady = false;
+
+    socketName = QDir::toNativeSeparators(
+                (qApp->property("applicationTempDirectory").toString())
+                + QDir::separator() + "zygote.sock");
+
+    QObject::connect(&zygoteProcess, SIGNAL(readyReadStandardOutput()),
+                     this, SLOT(zygoteOutputSlot()));
+    QObject::connect(&zygoteProcess, SIGNAL(readyReadStandardError()),
+                     this, SLOT(zygoteErrorSlot()));
+    QObject::connect(&zygoteProcess,
+                     SIGNAL(finished(int, QProcess::ExitStatus)),
+                     this, SLOT(zygoteFinishedSlot()));
+}
 
-    plExtension.setPattern("pl");
-    plExtension.setCaseSensitivity(Qt::CaseInsensitive);
+// ==============================
+// CENSOR VERDICT CACHE CLASS CONSTRUCTOR:
+// ==============================
+CensorVerdictCache::CensorVerdictCache()
+    : QObject(qApp)
+{
+    verdictFileName = QDir::toNativeSeparators(
+                (qApp->property("applicationTempDirectory").toString())
+                + QDir::separator() + "censor-verdicts.ini");
+
+    // Verdicts saved earlier in the same browser session are loaded:
+    QSettings verdictSettings(verdictFileName, QSettings::IniFormat);
+    foreach (QString scriptKey, verdictSettings.childGroups()) {
+        verdictSettings.beginGroup(scriptKey);
+        CensorVerdict savedVerdict;
+        savedVerdict.size = verdictSettings.value("size").toLongLong();
+        savedVerdict.modified = verdictSettings.value("modified").toUInt();
+        savedVerdict.hash = verdictSettings.value("hash").toByteArray();
+        verdicts.insert(verdictSettings.value("path").toString(),
+                        savedVerdict);
+        verdictSettings.endGroup();
+    }
+}
+
+// ==============================
+// SCRIPT CENSOR CLASS CONSTRUCTOR:
+// ==============================
+ScriptCensor::ScriptCensor()
+    : QObject(0)
+{
+    approved = false;
+
+    allowedUsePragmas << "attributes" << "autodie" << "autouse" << "base"
+                      << "bigint" << "bignum" << "bigrat" << "open"
+                      << "strict" << "warnings" << "utf8";
+
+    // The same modules as in censor.pl:
+    allowedModules << "CGI::Simple::Standard" << "Cwd" << "DBI" << "Env"
+                   << "URI::Escape" << "XML::LibXML";
+
+    // Only scripts run as FastCGI responders may also use these:
+    responderModules << "CGI::Fast" << "FCGI";
+
+    prohibitedCoreFunctions << "fork" << "unlink";
+
+    protectedEnvironmentVariables << "DOCUMENT_ROOT" << "FILE_TO_OPEN"
+                                  << "FILE_TO_CREATE" << "FOLDER_TO_OPEN";
+
+    quoteLikeOperators << "q" << "qq" << "qw" << "qr" << "qx"
+                       << "m" << "s" << "tr" << "y";
+
+    // Longer operators are matched first:
+    multiCharacterOperators << "<=>" << "**=" << "||=" << "&&=" << "//="
+                            << "<<=" << ">>=" << "..."
+                            << "=>" << "->" << "==" << "!=" << "<=" << ">="
+                            << "=~" << "!~" << "+=" << "-=" << "*=" << "/="
+                            << ".=" << "%=" << "|=" << "&=" << "^="
+                            << "||" << "&&" << "//" << "::" << "++" << "--"
+                            << "**" << "<<" << ">>" << "..";
+}
+
+#if EMBEDDED_PERL == 1
+// ==============================
+// EMBEDDED PERL JOB CLASS CONSTRUCTOR:
+// ==============================
+EmbeddedPerlJob::EmbeddedPerlJob(QMutex *interpreterMutex,
+                                 QString scriptFullFilePath,
+                                 QProcessEnvironment environment,
+                                 QByteArray stdinData)
+    : QObject(0)
+{
+    this->interpreterMutex = interpreterMutex;
+    this->scriptFullFilePath = scriptFullFilePath;
+    this->environment = environment;
+    this->stdinData = stdinData;
+}
+
+// ==============================
+// EMBEDDED PERL REQUEST CLASS CONSTRUCTOR:
+// ==============================
+EmbeddedPerlRequest::EmbeddedPerlRequest(QObject *consumer,
+                                         QThreadPool *threadPool,
+                                         EmbeddedPerlJob *job)
+    : ScriptRequest(consumer)
+{
+    executionMode = "embedded Perl interpreter.";
+    this->threadPool = threadPool;
+    this->job = job;
+    requestFinished = false;
+}
+
+// ==============================
+// EMBEDDED PERL CLASS CONSTRUCTOR:
+// ==============================
+EmbeddedPerl::EmbeddedPerl()
+    : QObject(qApp)
+{
+    embeddedPerlReady = false;
+}
+#endif
+
+// ==============================
+// SCRIPT I/O THREAD CLASS CONSTRUCTOR:
+// ==============================
+ScriptIoThread::ScriptIoThread()
+    : QThread(0)
+{
+    QObject::connect(qApp, SIGNAL(aboutToQuit()),
+                     this, SLOT(stopSlot()));
+    start();
+}
+
+// ==============================
+// GOVERNED PROCESS CLASS CONSTRUCTOR:
+// ==============================
+GovernedProcess::GovernedProcess(QObject *parent)
+    : QProcess(parent)
+{
+    // Limits are copied here, because the child process
+    // must not touch Qt objects before exec():
+#ifndef Q_OS_WIN
+    outputPipe[0] = -1;
+    outputPipe[1] = -1;
+    errorPipe[0] = -1;
+    errorPipe[1] = -1;
+    usagePipe[0] = -1;
+    usagePipe[1] = -1;
+    processGroup = 0;
+    cpuTimeLimit = qApp->property("cpuTimeLimit").toInt();
+    addressSpaceLimit =
+            (rlim_t) qApp->property("addressSpaceLimit").toInt() * 1048576;
+    openFilesLimit = qApp->property("openFilesLimit").toInt();
+#endif
+    niceLevel = qApp->property("niceLevel").toInt();
+    terminationGracePeriod =
+            qApp->property("terminationGracePeriod").toInt();
+    if (terminationGracePeriod <= 0) {
+        terminationGracePeriod = 2000;
+    }
+    terminationRequested = false;
+
+    QObject::connect(this, SIGNAL(started()),
+                     this, SLOT(processStartedSlot()));
+}
+
+// ==============================
+// SCRIPT PROCESS WORKER CLASS CONSTRUCTOR:
+// ==============================
+ScriptProcessWorker::ScriptProcessWorker(QObject *consumer,
+                                         QString program,
+                                         QStringList arguments,
+                                         QProcessEnvironment environment,
+                                         QString workingDirectory,
+                                         QByteArray stdinData)
+    : ScriptPipeWorker(consumer)
+{
+    this->program = program;
+    this->arguments = arguments;
+    this->environment = environment;
+    this->workingDirectory = workingDirectory;
+    this->stdinData = stdinData;
+    processExited = false;
+    processFinished = false;
+    inputRequested = false;
+    inputClosing = false;
+
+    // The process is a child of the worker and
+    // moves with it to the I/O thread:
+    process = new GovernedProcess(this);
+
+    // On Unix the output pipes are watched, when the process is started:
+#ifndef Q_OS_WIN
+    outputNotifier = 0;
+    errorNotifier = 0;
+#else
+    QObject::connect(process, SIGNAL(readyReadStandardOutput()),
+                     this, SLOT(readOutputSlot()));
+    QObject::connect(process, SIGNAL(readyReadStandardError()),
+                     this, SLOT(readErrorSlot()));
+#endif
+    QObject::connect(process, SIGNAL(finished(int, QProcess::ExitStatus)),
+                     this, SLOT(processFinishedSlot()));
+    QObject::connect(process, SIGNAL(error(QProcess::ProcessError)),
+                     this, SLOT(processErrorSlot(QProcess::ProcessError)));
+    QObject::connect(process, SIGNAL(bytesWritten(qint64)),
+                     this, SLOT(inputWrittenSlot()));
+}
+
+// ==============================
+// DEADLINE WHEEL CLASS CONSTRUCTOR:
+// ==============================
+DeadlineWheel::DeadlineWheel()
+    : QObject(qApp), wheel(wheelSize)
+{
+    processedTime = 0;
+    lastDeadlineId = 0;
+    clock.start();
+
+    // Deadlines are tracked in milliseconds and
+    // expire within one tick of the wheel timer:
+    tickTimer.setInterval(tickInterval);
+    QObject::connect(&tickTimer, SIGNAL(timeout()),
+                     this, SLOT(tickSlot()));
+}
+
+// ==============================
+// SCRIPT JOB CLASS CONSTRUCTOR:
+// ==============================
+ScriptJob::ScriptJob(QObject *page, QString scriptFullFilePath)
+    : QObject(0)
+{
+    this->page = page;
+    this->scriptFullFilePath = scriptFullFilePath;
+    executionMode = "new Perl process.";
+    outputType = "final";
+    outputThemeEnabled = true;
+    replyOutput = false;
+    outputBytes = 0;
+    responseRouted = false;
+    outputReceived = false;
+    expiredDeadline = NoDeadline;
+    killed = false;
+    jobFinished = false;
+    scriptWorker = 0;
+    workerRunning = false;
+    launchPending = false;
+    forkServerLaunch = false;
+    firstByteTimeout = 0;
+    idleOutputTimeout = 0;
+    totalTimeout = 0;
+    firstByteDeadlineId = 0;
+    idleOutputDeadlineId = 0;
+    totalDeadlineId = 0;
+    uploadedBytes = 0;
+    uploadChunkPending = false;
+    responseCacheable = false;
+    responseRevalidated = false;
+    responseNotModified = false;
+
+    // Output in the 'latest' mode is displayed once per display frame:
+    QObject::connect(&renderScheduler, SIGNAL(renderSignal()),
+                     this, SIGNAL(renderSignal()));
+}
+
+// ==============================
+// SCRIPT JOB REGISTRY CLASS CONSTRUCTOR:
+// ==============================
+ScriptJobRegistry::ScriptJobRegistry()
+    : QObject(qApp)
+{
+    lastJobId = 0;
+}
+
+// ==============================
+// SCRIPT SCHEDULER CLASS CONSTRUCTOR:
+// ==============================
+ScriptScheduler::ScriptScheduler()
+    : QObject(qApp)
+{
+    // One running script per processor core by default:
+    maximumRunningJobs = qApp->property("maximumRunningScripts").toInt();
+    if (maximumRunningJobs <= 0) {
+        maximumRunningJobs = QThread::idealThreadCount();
+    }
+    if (maximumRunningJobs <= 0) {
+        maximumRunningJobs = 1;
+    }
+}
+
+#if ZIP_SUPPORT == 1
+// ==============================
+// PACKAGE CACHE CLEANER CLASS CONSTRUCTOR:
+// ==============================
+PackageCacheCleaner::PackageCacheCleaner(QString cacheDirectoryName,
+                                         QString packageDirectoryName,
+                                         QString generationName)
+    : QThread(0)
+{
+    this->cacheDirectoryName = cacheDirectoryName;
+    this->packageDirectoryName = packageDirectoryName;
+    this->generationName = generationName;
+    removedGenerations = 0;
+}
+
+// ==============================
+// PACKAGE EXTRACTOR CLASS CONSTRUCTOR:
+// ==============================
+PackageExtractor::PackageExtractor(QString packageFileName,
+                                   QString mountDirectory,
+                                   QStringList folders,
+                                   QStringList keys,
+                                   QStringList archiveNames,
+                                   QStringList directoryNames)
+    : QThread(0)
+{
+    this->packageFileName = packageFileName;
+    this->mountDirectory = mountDirectory;
+    this->folders = folders;
+    this->keys = keys;
+    this->archiveNames = archiveNames;
+    this->directoryNames = directoryNames;
+}
+
+// ==============================
+// ZIP PACKAGE CLASS CONSTRUCTOR:
+// ==============================
+ZipPackage::ZipPackage()
+    : QObject(qApp)
+{
+    mounted = false;
+    extractor = 0;
+#if QT_VERSION >= 0x050100
+    sessionLock = 0;
+#endif
+    inflatedEntries = 0;
+    extractedEntries = 0;
+    reusedEntries = 0;
+
+    // Entries of a generation, which were completely extracted:
+    manifestName = "extracted.lst";
+}
+#endif
+
+// ==============================
+// ROOT INDEX SCANNER CLASS CONSTRUCTOR:
+// ==============================
+RootIndexScanner::RootIndexScanner(QString rootDirectory)
+    : QThread(0)
+{
+    this->rootDirectory = rootDirectory;
+}
+
+// ==============================
+// ROOT INDEX CLASS CONSTRUCTOR:
+// ==============================
+RootIndex::RootIndex()
+    : QObject(qApp)
+{
+    rootDirectory = QDir::fromNativeSeparators(
+                qApp->property("rootDirName").toString());
+    if (!rootDirectory.endsWith("/")) {
+        rootDirectory.append("/");
+    }
+    scanner = 0;
+    ready = false;
+
+    QObject::connect(&watcher, SIGNAL(directoryChanged(QString)),
+                     this, SLOT(directoryChangedSlot(QString)));
+    QObject::connect(&watcher, SIGNAL(fileChanged(QString)),
+                     this, SLOT(fileChangedSlot(QString)));
 }
 
 // ==============================
@@ -1034,13 +1924,6 @@ Page::Page()
     QWebSettings::setMaximumPagesInCache(0);
     QWebSettings::setObjectCacheCapacities(0, 0, 0);
 
-    QObject::connect(&scriptHandler, SIGNAL(readyReadStandardOutput()),
-                     this, SLOT(scriptOutputSlot()));
-    QObject::connect(&scriptHandler, SIGNAL(readyReadStandardError()),
-                     this, SLOT(scriptErrorSlot()));
-    QObject::connect(&scriptHandler, SIGNAL(finished(int, QProcess::ExitStatus)),
-                     this, SLOT(scriptFinishedSlot()));
-
     if (PERL_DEBUGGER_INTERACTION == 1) {
         QObject::connect(&debuggerHandler, SIGNAL(readyReadStandardOutput()),
                          this, SLOT(debuggerOutputSlot()));
@@ -1132,8 +2015,6 @@ Page::Page()
 
     // Icon for dialogs:
     icon.load(qApp->property("iconPathName").toString());
-
-    runningScriptsInCurrentWindowList.clear();
 }
 
 // ==============================
@@ -1237,9 +2118,9 @@ TopLevel::TopLevel()
     mainPage->setNetworkAccessManager(networkAccessManager);
 
     QObject::connect(networkAccessManager,
-                     SIGNAL(startScriptSignal(QUrl, QByteArray)),
+                     SIGNAL(startScriptSignal(QUrl, ScriptReply*)),
                      mainPage,
-                     SLOT(startScriptSlot(QUrl, QByteArray)));
+                     SLOT(startScriptSlot(QUrl, ScriptReply*)));
 
     if (PERL_DEBUGGER_INTERACTION == 1) {
         QObject::connect(networkAccessManager,
@@ -17,6 +17,7 @@
 #include <QApplication>
 #include <QtWebKit>
 #include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
 #include <QUrl>
 #include <QWebPage>
 #include <QWebView>
@@ -30,10 +31,70 @@
 #include <QMenu>
 #include <QDesktopWidget>
 #include <QSystemTrayIcon>
+#include <QLocalSocket>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QCryptographicHash>
+#include <QSettings>
+#include <QDateTime>
+#include <QTextCodec>
+#include <QScopedPointer>
+#include <QThread>
+#include <QVector>
+#include <QAtomicInt>
+#include <QCache>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // ==============================
 // PRINT SUPPORT:
 // ==============================
+#ifndef Q_OS_WIN
+#include <signal.h> // for kill()
+#endif
+
+// ==============================
+// SCRIPT RESOURCE LIMITS SUPPORT:
+// ==============================
+#ifndef Q_OS_WIN
+#include <unistd.h> // for setpgid() and link()
+#include <sys/time.h>
+#include <sys/resource.h> // for setrlimit(), setpriority() and getrusage()
+#include <sys/wait.h> // for wait4() reporting the resources of a script
+#include <sys/stat.h> // for stat() used by the file detector
+#include <fcntl.h> // for the output pipes of script processes
+#include <errno.h>
+#endif
+
+// ==============================
+// ZIP PACKAGES SUPPORT:
+// ==============================
+#if ZIP_SUPPORT == 1
+#include <quazip/quazip.h> // for serving root folder from a zip file
+#include <quazip/quazipfileinfo.h>
+#include <quazip/JlCompress.h> // for parallel extraction
+#if QT_VERSION >= 0x050100
+#include <QLockFile> // for cache generations used by several sessions
+#endif
+#endif
+
+// ==============================
+// EMBEDDED PERL SUPPORT:
+// ==============================
+#if EMBEDDED_PERL == 1
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutex>
+#include "perlembed.h"
+#endif
+
 #ifndef QT_NO_PRINTER
 #include <QPrintPreviewDialog>
 #include <qglobal.h>
@@ -52,278 +113,6949 @@
 // ==============================
 // FILE DETECTOR CLASS DEFINITION:
 // ==============================
+// File type detection for every request, context menu and new window.
+// Known suffixes are found in one case-folded hash table built once,
+// extensionless files are checked for a Perl shebang line and
+// the result is cached until the inode, size or
+// modification time of the file changes.
+// lookup() returns 'browser-html', 'browser-css', 'browser-js',
+// 'browser-image', the Perl interpreter or 'undefined'.
 class FileDetector : public QObject
 {
     Q_OBJECT
 
-public slots:
-    void defineInterpreter(QString filepath)
+public:
+    FileDetector();
+
+    static FileDetector *instance()
     {
-        interpreter = "undefined";
+        static FileDetector *fileDetector = new FileDetector();
+        return fileDetector;
+    }
 
-        extension = filepath.section(".", 1, 1);
+    QString lookup(QString filepath)
+    {
+        QString fileType = detectFileType(filepath);
+        if (fileType == "perl") {
+            fileType = (qApp->property("perlInterpreter").toString());
+        }
+        return fileType;
+    }
 
-        if (extension.length() == 0) {
-            QString firstLine;
+    // Read-only after construction, so it is also used by
+    // the root index scanner thread:
+    QString extensionType(QString fileExtension) const
+    {
+        return fileTypes.value(fileExtension, "undefined");
+    }
 
-            QFile file(filepath);
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                firstLine = file.readLine();
-            }
+    // Content types of files served without a script,
+    // read-only after construction like the file types:
+    QString mimeType(QString fileExtension) const
+    {
+        return mimeTypes.value(fileExtension, "application/octet-stream");
+    }
 
-            if (firstLine.contains(perlShebang)) {
-                interpreter = (qApp->property("perlInterpreter").toString());
-            }
-        } else {
-            if (extension.contains(htmlExtensions)) {
-                interpreter = "browser-html";
-            }
-            if (extension.contains(cssExtension)) {
-                interpreter = "browser-css";
-            }
-            if (extension.contains(jsExtension)) {
-                interpreter = "browser-js";
-            }
-            if (extension.contains(pngExtension)) {
-                interpreter = "browser-image";
-            }
-            if (extension.contains(jpgExtensions)) {
-                interpreter = "browser-image";
-            }
-            if (extension.contains(gifExtension)) {
-                interpreter = "browser-image";
-            }
+    static bool hasPerlShebang(QString filepath)
+    {
+        QByteArray firstLine;
+        QFile file(filepath);
+        if (file.open(QIODevice::ReadOnly)) {
+            firstLine = file.readLine(maximumShebangSize);
+        }
+        return (firstLine.startsWith("#!/") and firstLine.contains("perl"));
+    }
 
-            if (extension == "pl") {
-                interpreter = (qApp->property("perlInterpreter").toString());
-            }
+    // Suffix after the last dot of the file name, in lower case:
+    static QString extension(QString filepath)
+    {
+        int nameStart = qMax(filepath.lastIndexOf('/'),
+                             filepath.lastIndexOf('\\')) + 1;
+        int dot = filepath.lastIndexOf('.');
+        if (dot < nameStart) {
+            return QString();
         }
+        return filepath.mid(dot + 1).toLower();
     }
 
-public:
-    FileDetector();
+    // Called by the root index when a watched file has changed:
+    void forget(QString filepath)
+    {
+        shebangCache.remove(filepath);
+    }
 
-    QString extension;
-    QString interpreter;
+    qint64 shebangReads;
 
 private:
-    // Regular expressions for file type detection by shebang line:
-    QRegExp perlShebang;
-
-    // Regular expressions for file type detection by extension:
-    QRegExp htmlExtensions;
-    QRegExp cssExtension;
-    QRegExp jsExtension;
-    QRegExp pngExtension;
-    QRegExp jpgExtensions;
-    QRegExp gifExtension;
-
-    QRegExp plExtension;
+    QString detectFileType(QString filepath)
+    {
+        QString fileExtension = extension(filepath);
+        if (fileExtension.length() > 0) {
+            return extensionType(fileExtension);
+        }
+
+        ShebangEntry cachedEntry = shebangCache.value(filepath);
+        ShebangEntry currentEntry = fileIdentity(filepath);
+        if (shebangCache.contains(filepath) and
+                cachedEntry.inode == currentEntry.inode and
+                cachedEntry.size == currentEntry.size and
+                cachedEntry.modified == currentEntry.modified) {
+            return cachedEntry.fileType;
+        }
+
+        shebangReads++;
+        currentEntry.fileType = hasPerlShebang(filepath) ? "perl" : "undefined";
+        shebangCache.insert(filepath, currentEntry);
+
+        return currentEntry.fileType;
+    }
+
+    struct ShebangEntry {
+        quint64 inode;
+        qint64 size;
+        qint64 modified;
+        QString fileType;
+    };
+
+    static ShebangEntry fileIdentity(QString filepath)
+    {
+        ShebangEntry entry;
+        entry.inode = 0;
+        entry.size = -1;
+        entry.modified = 0;
+#ifndef Q_OS_WIN
+        struct stat fileStatus;
+        if (::stat(QFile::encodeName(filepath).constData(),
+                   &fileStatus) == 0) {
+            entry.inode = fileStatus.st_ino;
+            entry.size = fileStatus.st_size;
+            entry.modified = fileStatus.st_mtime;
+        }
+#else
+        QFileInfo fileInfo(filepath);
+        entry.size = fileInfo.exists() ? fileInfo.size() : -1;
+        entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+#endif
+        return entry;
+    }
+
+    static const int maximumShebangSize = 256;
+
+    QHash<QString, QString> fileTypes;
+    QHash<QString, QString> mimeTypes;
+    QHash<QString, ShebangEntry> shebangCache;
 };
 
+#if ZIP_SUPPORT == 1
 // ==============================
-// SYSTEM TRAY ICON CLASS DEFINITION:
+// PACKAGE CACHE CLEANER CLASS DEFINITION:
 // ==============================
-class TrayIcon : public QSystemTrayIcon
+// Removes stale generations of extracted ZIP packages in a background thread.
+// Every package folder of the cache holds the generations of one package,
+// only the current generation of the running package is kept.
+// Folders of packages, which no longer exist, are removed completely.
+// Every session holds a lock file on the generation it uses and
+// a generation is removed only under its own lock file and
+// only when no session lock file of a running browser is left on it.
+// Without lock files (Qt4) other generations are never removed.
+class PackageCacheCleaner : public QThread
 {
     Q_OBJECT
 
-public slots:
-    void trayIconActivatedSlot(QSystemTrayIcon::ActivationReason reason)
+public:
+    PackageCacheCleaner(QString cacheDirectoryName,
+                        QString packageDirectoryName,
+                        QString generationName);
+
+    // Lock files are kept next to the generation folders,
+    // so that they are not removed with them:
+    static QString generationLockName(QString packageDirectoryName,
+                                      QString generationName)
     {
-        if (reason == QSystemTrayIcon::DoubleClick) {
+        return packageDirectoryName + "/" + generationName + ".lock";
+    }
 
-            if ((qApp->property("systrayIconDoubleClickAction")
-                 .toString()) == "quit") {
-                QMessageBox confirmExitMessageBox;
-                confirmExitMessageBox.setWindowModality(Qt::WindowModal);
-                confirmExitMessageBox.setWindowTitle(tr("Quit"));
-                confirmExitMessageBox
-                        .setIconPixmap((qApp->property("icon").toString()));
-                confirmExitMessageBox
-                        .setText(tr("You are going to quit the program.<br>")
-                                 + tr("Are you sure?"));
-                confirmExitMessageBox
-                        .setStandardButtons(QMessageBox::Yes
-                                            | QMessageBox::No);
-                confirmExitMessageBox.setButtonText(QMessageBox::Yes,
-                                                    tr("Yes"));
-                confirmExitMessageBox.setButtonText(QMessageBox::No,
-                                                    tr("No"));
-                confirmExitMessageBox.setDefaultButton(QMessageBox::No);
-                if (confirmExitMessageBox.exec() == QMessageBox::Yes) {
-                    QApplication::quit();
-                }
+    static QString sessionLockName(QString packageDirectoryName,
+                                   QString generationName)
+    {
+        return packageDirectoryName + "/" + generationName + "-"
+                + QString::number(QCoreApplication::applicationPid())
+                + ".session.lock";
+    }
+
+    static bool removeGeneration(QString packageDirectoryName,
+                                 QString generationName)
+    {
+#if QT_VERSION >= 0x050100
+        // Locks are never stale only because they are old,
+        // locks of crashed sessions are taken over:
+        QLockFile generationLock(generationLockName(packageDirectoryName,
+                                                    generationName));
+        generationLock.setStaleLockTime(0);
+        if (!generationLock.tryLock(0)) {
+            return false;
+        }
+
+        QDir packageDirectory(packageDirectoryName);
+        foreach (QString sessionLockFileName,
+                 packageDirectory.entryList(QStringList()
+                                            << generationName
+                                            + "-*.session.lock",
+                                            QDir::Files)) {
+            QLockFile sessionLock(packageDirectoryName + "/"
+                                  + sessionLockFileName);
+            sessionLock.setStaleLockTime(0);
+            if (!sessionLock.tryLock(0)) {
+                return false;
             }
+            sessionLock.unlock();
+        }
 
-            if ((qApp->property("systrayIconDoubleClickAction")
-                 .toString()) == "minimize_all_windows") {
-                foreach (QWidget *window, QApplication::topLevelWidgets()) {
-                    if (window->isVisible()) {
-                        window->showMinimized();
+        return removeDirectory(packageDirectoryName + "/" + generationName);
+#else
+        Q_UNUSED(packageDirectoryName);
+        Q_UNUSED(generationName);
+        return false;
+#endif
+    }
+
+    static bool removeDirectory(QString directoryName)
+    {
+        QDir directory(directoryName);
+        if (!directory.exists()) {
+            return true;
+        }
+
+        bool removed = true;
+        QFileInfoList fileInfoList =
+                directory.entryInfoList(QDir::AllEntries | QDir::Hidden
+                                        | QDir::System | QDir::NoDotAndDotDot);
+        foreach (QFileInfo fileInfo, fileInfoList) {
+            if (fileInfo.isDir() and !fileInfo.isSymLink()) {
+                removed = removeDirectory(fileInfo.absoluteFilePath())
+                        and removed;
+            } else {
+                removed = QFile::remove(fileInfo.absoluteFilePath())
+                        and removed;
+            }
+        }
+
+        return (directory.rmdir(directory.absolutePath()) and removed);
+    }
+
+protected:
+    void run()
+    {
+        QDir cacheDirectory(cacheDirectoryName);
+        foreach (QFileInfo packageDirectoryInfo,
+                 cacheDirectory.entryInfoList(QDir::Dirs
+                                              | QDir::NoDotAndDotDot)) {
+            QString packageDirectoryPath =
+                    packageDirectoryInfo.absoluteFilePath();
+
+            QDir packageDirectory(packageDirectoryPath);
+            QStringList generations =
+                    packageDirectory.entryList(QDir::Dirs
+                                               | QDir::NoDotAndDotDot);
+
+            if (QDir::cleanPath(packageDirectoryPath) ==
+                    QDir::cleanPath(packageDirectoryName)) {
+                foreach (QString generation, generations) {
+                    if (generation != generationName and
+                            removeGeneration(packageDirectoryPath,
+                                             generation)) {
+                        removedGenerations++;
                     }
                 }
+                continue;
             }
 
+            QFile packageNameFile(packageDirectoryPath + "/package.txt");
+            if (!packageNameFile.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            QString packageFileName =
+                    QString::fromUtf8(packageNameFile.readAll().trimmed());
+            packageNameFile.close();
+
+            if (packageFileName.length() > 0 and
+                    !QFile::exists(packageFileName)) {
+                bool allRemoved = true;
+                foreach (QString generation, generations) {
+                    if (removeGeneration(packageDirectoryPath, generation)) {
+                        removedGenerations++;
+                    } else {
+                        allRemoved = false;
+                    }
+                }
+                if (allRemoved == true) {
+                    removeDirectory(packageDirectoryPath);
+                }
+            }
         }
-    }
 
-    void trayIconHideSlot()
-    {
-        trayIcon->hide();
+        qDebug() << "Stale ZIP package cache generations removed:"
+                 << removedGenerations;
     }
 
 public:
-    TrayIcon();
-
-    QAction *quitAction;
-    QAction *aboutAction;
-    QAction *aboutQtAction;
+    int removedGenerations;
 
 private:
-    QSystemTrayIcon *trayIcon;
-    QMenu *trayIconMenu;
+    QString cacheDirectoryName;
+    QString packageDirectoryName;
+    QString generationName;
 };
+#endif
 
+#if ZIP_SUPPORT == 1
 // ==============================
-// NETWORK ACCESS MANAGER CLASS DEFINITION:
+// PACKAGE EXTRACTOR CLASS DEFINITION:
 // ==============================
-class ModifiedNetworkAccessManager : public QNetworkAccessManager
+// Extracts entries of the ZIP package in a background thread.
+// Entries are inflated by all processor cores into a staging folder and
+// are moved into the mount folder from there, so that other sessions
+// using the same generation never see a partially written file.
+// The package index is updated by the GUI thread from 'extractedKeys'.
+class PackageExtractor : public QThread
 {
     Q_OBJECT
 
-signals:
-    void startScriptSignal(QUrl url, QByteArray postDataArray);
-    void startPerlDebuggerSignal(QUrl debuggerUrl);
+public:
+    PackageExtractor(QString packageFileName,
+                     QString mountDirectory,
+                     QStringList folders,
+                     QStringList keys,
+                     QStringList archiveNames,
+                     QStringList directoryNames);
+
+    QStringList folders;
+    QStringList keys;
+    QStringList extractedKeys;
 
 protected:
-    virtual QNetworkReply *createRequest(Operation operation,
-                                         const QNetworkRequest &request,
-                                         QIODevice *outgoingData = 0)
+    void run()
     {
-        // GET requests to local content:
-        if (operation == GetOperation and
-                (QUrl(PSEUDO_DOMAIN)).isParentOf(request.url())) {
+        foreach (QString directoryName, directoryNames) {
+            QDir().mkpath(mountDirectory + directoryName);
+        }
 
-            QString filepath = request.url()
-                    .toString(QUrl::RemoveScheme
-                              | QUrl::RemoveAuthority
-                              | QUrl::RemoveQuery
-                              | QUrl::RemoveFragment);
+        if (keys.isEmpty()) {
+            return;
+        }
 
-            QString fullFilePath = QDir::toNativeSeparators
-                    ((qApp->property("rootDirName").toString())
-                     + filepath);
+        QString stagingDirectory = mountDirectory + ".staging-"
+                + QString::number(QCoreApplication::applicationPid());
+
+        // One broken entry fails the whole parallel extraction,
+        // so all entries are extracted again one by one:
+        if (JlCompress::extractFilesParallel(packageFileName, archiveNames,
+                                             stagingDirectory).size() == 0) {
+            for (int index = 0; index < keys.size(); index++) {
+                JlCompress::extractFile(packageFileName, archiveNames.at(index),
+                                        stagingDirectory + "/"
+                                        + archiveNames.at(index));
+            }
+        }
 
-            FileDetector fileDetector;
-            fileDetector.defineInterpreter(fullFilePath);
+        for (int index = 0; index < keys.size(); index++) {
+            QString stagedFilePath =
+                    stagingDirectory + "/" + archiveNames.at(index);
+            QString filePath = mountDirectory + QDir::cleanPath(
+                        QDir::fromNativeSeparators(archiveNames.at(index)));
+            if (!QFile::exists(stagedFilePath)) {
+                continue;
+            }
 
-            // Local HTML, CSS, JS or supported image files:
-            if (fileDetector.interpreter.contains ("browser")) {
+            QDir().mkpath(QFileInfo(filePath).absolutePath());
+            QFile::remove(filePath);
+            if (QFile::rename(stagedFilePath, filePath)) {
+                extractedKeys.append(keys.at(index));
+            }
+        }
 
-                QNetworkRequest networkRequest;
-                networkRequest.setUrl
-                        (QUrl::fromLocalFile
-                         (QDir::toNativeSeparators(
-                              (qApp->property("rootDirName").toString())
-                              + request.url().toString(
-                                  QUrl::RemoveScheme
-                                  | QUrl::RemoveAuthority))));
+        PackageCacheCleaner::removeDirectory(stagingDirectory);
+    }
 
-                return QNetworkAccessManager::createRequest
-                        (QNetworkAccessManager::GetOperation,
-                         QNetworkRequest(networkRequest));
-            }
+private:
+    QString packageFileName;
+    QString mountDirectory;
+    QStringList archiveNames;
+    QStringList directoryNames;
+};
+#endif
 
-            // Local Perl scripts:
-            if ((!fileDetector.interpreter.contains("undefined")) and
-                    (!fileDetector.interpreter.contains("browser"))) {
+#if ZIP_SUPPORT == 1
+// ==============================
+// ZIP PACKAGE CLASS DEFINITION:
+// ==============================
+// Read-only root folder served directly from the 'default.peb' ZIP package.
+// The central directory is read once at startup and every entry is indexed
+// by its path, so no entry is found by walking the archive.
+// Browser files are inflated in memory only when they are requested.
+// Perl must see its files on disk, so the folder of a script is extracted
+// in the background, before the script is started for the first time.
+// The folders of a packaged Perl interpreter and PERLLIB go with it.
+// Browser files in these folders are left in the package.
+// Extracted entries are used from disk afterwards.
+// They are kept in a per-user cache folder, one generation for
+// every content of the package identified by its central directory.
+// A later session with the same package reuses its generation and
+// a changed package takes over all unchanged entries of the previous one.
+// Files of a reused generation are checked against the size and
+// the modification time in its manifest, so files changed by scripts
+// are extracted again. Entries of a previous generation are
+// linked or copied, never moved, because other sessions may still use
+// that generation. Only read-only entries are linked, so that
+// a script writing a file changes it in its own generation only.
+struct ZipPackageEntry {
+    QString name;
+    QString archiveName;
+    unz64_file_pos position;
+    quint32 crc;
+    qint64 size;
+    qint64 modified;
+    QFile::Permissions permissions;
+    bool directory;
+    bool extracted;
+};
 
-                QByteArray emptyPostDataArray;
-                emit startScriptSignal(request.url(), emptyPostDataArray);
-            }
+class ZipPackage : public QObject
+{
+    Q_OBJECT
 
-            // Local files without recognized file type:
-            if (fileDetector.interpreter.contains("undefined")) {
+public slots:
+    void extractionFinishedSlot()
+    {
+        foreach (QString key, extractor->extractedKeys) {
+            markExtracted(key);
+        }
 
-                qDebug() << "File type not recognized!";
-                qDebug() << "===============";
+        // Entries, which could not be extracted, are not tried again -
+        // Perl reports the missing files:
+        foreach (QString folder, extractor->folders) {
+            preparedFolders.insert(folder);
+        }
 
-                QNetworkRequest networkRequest;
-                networkRequest.setUrl
-                        (QUrl::fromLocalFile
-                         ((qApp->property("helpDirectory").toString())
-                          + QDir::separator()
-                          + "notrecognized.htm"));
+        qDebug() << "ZIP package entries extracted for scripts:"
+                 << extractor->extractedKeys.size() << "of"
+                 << extractor->keys.size() << "in"
+                 << extractionTimer.elapsed() << "msecs";
+        qDebug() << "===============";
 
-                return QNetworkAccessManager::createRequest
-                        (QNetworkAccessManager::GetOperation,
-                         QNetworkRequest(networkRequest));
+        extractor->deleteLater();
+        extractor = 0;
+
+        for (int index = waiters.size() - 1; index >= 0; index--) {
+            if (folderPrepared(waiters.at(index).folders)) {
+                if (!waiters.at(index).receiver.isNull()) {
+                    QMetaObject::invokeMethod(
+                                waiters.at(index).receiver.data(),
+                                waiters.at(index).member.constData(),
+                                Qt::QueuedConnection);
+                }
+                waiters.removeAt(index);
             }
         }
 
-        // Take data from a local form using CGI POST method and
-        // execute associated local script:
-        if (operation == PostOperation and
-                (QUrl(PSEUDO_DOMAIN)).isParentOf(request.url())) {
+        startExtractor();
+    }
 
-            if (outgoingData) {
-                QByteArray postDataArray = outgoingData->readAll();
-                emit startScriptSignal(request.url(), postDataArray);
+public:
+    ZipPackage();
+
+    static ZipPackage *instance()
+    {
+        static ZipPackage *zipPackage = new ZipPackage();
+        return zipPackage;
+    }
+
+    // Entries are mounted in the current generation folder of the package
+    // inside 'cacheDirectoryName', where they are extracted:
+    bool mount(QString packageFileName, QString cacheDirectoryName)
+    {
+        QElapsedTimer mountTimer;
+        mountTimer.start();
+
+        archive.setZipName(packageFileName);
+        if (!archive.open(QuaZip::mdUnzip)) {
+            return false;
+        }
+
+        // The generation is named after the names, CRCs and sizes of
+        // all entries, so the package is never read completely:
+        QCryptographicHash generationHash(QCryptographicHash::Sha1);
+
+        for (bool more = archive.goToFirstFile(); more;
+             more = archive.goToNextFile()) {
+            QuaZipFileInfo64 fileInfo;
+            if (!archive.getCurrentFileInfo(&fileInfo)) {
+                continue;
+            }
+
+            // Names leaving the mount folder are never used:
+            QString name = QDir::cleanPath(
+                        QDir::fromNativeSeparators(fileInfo.name));
+            if (name == "." or name.startsWith("../") or
+                    name == ".." or name.startsWith("/")) {
+                continue;
             }
+
+            ZipPackageEntry entry;
+            entry.name = name;
+            entry.archiveName = fileInfo.name;
+            unzGetFilePos64(archive.getUnzFile(), &entry.position);
+            entry.crc = fileInfo.crc;
+            entry.size = fileInfo.uncompressedSize;
+            entry.permissions = fileInfo.getPermissions();
+            entry.directory = fileInfo.name.endsWith("/");
+            entry.extracted = false;
+            entry.modified = 0;
+
+            QString key = foldCase(name);
+            entries.insert(key, entry);
+            addParentDirectories(name);
+
+            generationHash.addData(QByteArray::number(entry.crc, 16) + " "
+                                   + QByteArray::number(entry.size) + " "
+                                   + entry.name.toUtf8() + "\n");
         }
 
-        if (PERL_DEBUGGER_INTERACTION == 1) {
-            // Perl debugger interaction.
-            // Implementation of an idea proposed by Valcho Nedelchev.
-            // Transmit requests to Perl debugger
-            // in case debugger is started in a new window:
-            if (operation == GetOperation and
-                    request.url().scheme().contains("file") and
-                    request.url().hasQuery()) {
+        // Generations of one package are kept in one folder:
+        QString packageFilePath =
+                QFileInfo(packageFileName).absoluteFilePath();
+        packageDirectory = QDir::fromNativeSeparators(cacheDirectoryName)
+                + "/" + QString(QCryptographicHash::hash(
+                                    packageFilePath.toUtf8(),
+                                    QCryptographicHash::Sha1).toHex());
+        generation = QString(generationHash.result().toHex());
+        mountDirectory = packageDirectory + "/" + generation + "/";
+        QDir().mkpath(packageDirectory);
+
+#if QT_VERSION >= 0x050100
+        // The generation is used under a session lock file taken
+        // under the generation lock file, so that no cache cleaner
+        // of another session can remove it meanwhile:
+        QLockFile generationLock(
+                    PackageCacheCleaner::generationLockName(packageDirectory,
+                                                            generation));
+        generationLock.setStaleLockTime(0);
+        generationLock.lock();
+        sessionLock = new QLockFile(
+                    PackageCacheCleaner::sessionLockName(packageDirectory,
+                                                         generation));
+        sessionLock->setStaleLockTime(0);
+        sessionLock->lock();
+        generationLock.unlock();
+#endif
 
-                emit startPerlDebuggerSignal(request.url());
+        bool generationFound = QFile::exists(mountDirectory + manifestName);
+        QDir().mkpath(mountDirectory);
+
+        QFile packageNameFile(packageDirectory + "/package.txt");
+        if (!packageNameFile.exists() and
+                packageNameFile.open(QIODevice::WriteOnly)) {
+            packageNameFile.write(packageFilePath.toUtf8());
+            packageNameFile.close();
+        }
+
+        if (generationFound == true) {
+            reusedEntries = takeEntries(mountDirectory, false);
+        } else {
+            QString previousGeneration = previousGenerationDirectory();
+            if (previousGeneration.length() > 0) {
+#if QT_VERSION >= 0x050100
+                // Entries are copied under the lock file of
+                // the previous generation, while it can not be removed:
+                QLockFile previousGenerationLock(
+                            PackageCacheCleaner::generationLockName(
+                                packageDirectory,
+                                QDir(previousGeneration).dirName()));
+                previousGenerationLock.setStaleLockTime(0);
+                if (previousGenerationLock.tryLock(lockTimeout)) {
+                    reusedEntries = takeEntries(previousGeneration, true);
+                }
+#else
+                reusedEntries = takeEntries(previousGeneration, true);
+#endif
+            }
+        }
 
+        manifestFile.setFileName(mountDirectory + manifestName);
+        manifestFile.open(QIODevice::WriteOnly | QIODevice::Append);
+        if (generationFound == false) {
+            foreach (ZipPackageEntry entry, entries) {
+                if (entry.extracted == true) {
+                    manifestFile.write(manifestLine(entry));
+                }
             }
+            manifestFile.flush();
         }
 
-        // GET, POST and PUT requests to network resources.
-        // Domain filtering happens here:
-        if ((operation == GetOperation or
-             operation == PostOperation or
-             operation == PutOperation) and
-                ((request.url().scheme().contains("file")) or
-                 (request.url().toString().contains(PSEUDO_DOMAIN)) or
-                 ((qApp->property("allowedDomainsList").toStringList())
-                  .contains(request.url().authority())))) {
+        mounted = true;
+
+        qDebug() << "ZIP package mounted:" << packageFileName;
+        qDebug() << entries.size() << "entries indexed in"
+                 << mountTimer.elapsed() << "msecs";
+        qDebug() << "ZIP package cache generation:" << mountDirectory;
+        qDebug() << "Cached entries" << (generationFound ? "reused:" :
+                                         "taken from previous generation:")
+                 << reusedEntries;
+
+        // Stale generations are removed without delaying the startup:
+        PackageCacheCleaner *cleaner =
+                new PackageCacheCleaner(cacheDirectoryName,
+                                        packageDirectory, generation);
+        QObject::connect(cleaner, SIGNAL(finished()),
+                         cleaner, SLOT(deleteLater()));
+        cleaner->start(QThread::LowestPriority);
+
+        return true;
+    }
+
+    QString mountDirectoryName()
+    {
+        return QDir::toNativeSeparators(QDir::cleanPath(mountDirectory));
+    }
+
+    void unmount()
+    {
+        manifestFile.close();
+        archive.close();
+        entries.clear();
+        mounted = false;
+
+#if QT_VERSION >= 0x050100
+        delete sessionLock;
+        sessionLock = 0;
+#endif
+    }
+
+    bool isMounted()
+    {
+        return mounted;
+    }
+
+    bool contains(QString fullFilePath)
+    {
+        if (mounted == false) {
+            return false;
+        }
+        return entries.contains(entryKey(fullFilePath));
+    }
+
+    // Files to be served from memory:
+    bool isPackaged(QString fullFilePath)
+    {
+        if (mounted == false) {
+            return false;
+        }
+        QString key = entryKey(fullFilePath);
+        if (!entries.contains(key)) {
+            return false;
+        }
+        ZipPackageEntry entry = entries.value(key);
+        return (entry.directory == false and entry.extracted == false);
+    }
+
+    // Same types as the root index entries:
+    QString fileType(QString fullFilePath)
+    {
+        QString key = entryKey(fullFilePath);
+        ZipPackageEntry entry = entries.value(key);
+        if (entry.directory == true) {
+            return QString("directory");
+        }
+
+        QString fileExtension = FileDetector::extension(key);
+        if (fileExtension.length() > 0) {
+            return FileDetector::instance()->extensionType(fileExtension);
+        }
+
+        if (!shebangTypes.contains(key)) {
+            bool inflated;
+            QByteArray firstBytes =
+                    inflate(entry, inflated, maximumShebangSize);
+            QByteArray firstLine = firstBytes.left(firstBytes.indexOf('\n'));
+            shebangTypes.insert(key, (firstLine.startsWith("#!/") and
+                                      firstLine.contains("perl")) ?
+                                    "perl" : "undefined");
+        }
+        return shebangTypes.value(key);
+    }
+
+    QByteArray read(QString fullFilePath, bool &ok)
+    {
+        ok = false;
+        QString key = entryKey(fullFilePath);
+        if (!entries.contains(key) or entries.value(key).directory == true) {
+            return QByteArray();
+        }
+
+        inflatedEntries++;
+        return inflate(entries.value(key), ok, -1);
+    }
+
+    // Files and whole folders are extracted, if not already on disk:
+    bool extract(QString fullFilePath)
+    {
+        if (mounted == false) {
+            return false;
+        }
+
+        QString key = entryKey(fullFilePath);
+        if (!entries.contains(key)) {
+            return false;
+        }
+
+        if (entries.value(key).directory == false) {
+            return extractEntry(key);
+        }
+
+        bool allExtracted =
+                QDir().mkpath(mountDirectory + entries.value(key).name);
+        QString prefix = key + "/";
+        foreach (QString entryName, entries.keys()) {
+            if (entryName.startsWith(prefix) and
+                    entries.value(entryName).directory == false) {
+                allExtracted = extractEntry(entryName) and allExtracted;
+            }
+        }
+        return allExtracted;
+    }
+
+    // Scripts are started only when their folders are on disk.
+    // False is returned while they are extracted in the background and
+    // 'member' of 'receiver' is called when they are ready.
+    // An empty script name prepares only the folders of Perl itself.
+    bool prepareScript(QString scriptFullFilePath,
+                       QObject *receiver, const char *member)
+    {
+        if (mounted == false) {
+            return true;
+        }
+
+        QStringList folders = scriptFolders(scriptFullFilePath);
+        if (folderPrepared(folders)) {
+            return true;
+        }
+
+        PackageWaiter waiter;
+        waiter.receiver = receiver;
+        waiter.member = member;
+        waiter.folders = folders;
+        waiters.append(waiter);
+
+        foreach (QString folder, folders) {
+            if (!preparedFolders.contains(folder) and
+                    !pendingFolders.contains(folder) and
+                    (extractor == 0 or !extractor->folders.contains(folder))) {
+                pendingFolders.append(folder);
+            }
+        }
+        startExtractor();
+
+        return false;
+    }
+
+    // Full paths of the packaged folders of Perl itself:
+    QStringList perlFolders()
+    {
+        QStringList folderPaths;
+        foreach (QString folder, scriptFolders(QString())) {
+            folderPaths.append(mountDirectory + folder);
+        }
+        return folderPaths;
+    }
+
+    int inflatedEntries;
+    int extractedEntries;
+    int reusedEntries;
+
+private:
+    struct PackageWaiter {
+        QPointer<QObject> receiver;
+        QByteArray member;
+        QStringList folders;
+    };
+
+    // Keys of the folders needed by a script: its own folder and
+    // the folders of a packaged Perl interpreter and PERLLIB.
+    // Interpreters in a 'bin' folder take the folder above it too.
+    // The empty key stands for the whole package.
+    QStringList scriptFolders(QString scriptFullFilePath)
+    {
+        QStringList folderPaths;
+        if (scriptFullFilePath.length() > 0) {
+            folderPaths.append(QFileInfo(scriptFullFilePath).path());
+        }
+
+        QString perlInterpreterFolder = QFileInfo(
+                    qApp->property("perlInterpreter").toString()).path();
+        if (QFileInfo(perlInterpreterFolder).fileName() == "bin") {
+            perlInterpreterFolder = QFileInfo(perlInterpreterFolder).path();
+        }
+        folderPaths.append(perlInterpreterFolder);
+        folderPaths.append(qApp->property("perlLib").toString());
+
+        QStringList folders;
+        QString root = QDir::cleanPath(mountDirectory);
+        foreach (QString folderPath, folderPaths) {
+            QString path = QDir::cleanPath(QDir::fromNativeSeparators(folderPath));
+            QString folder;
+            if (path.compare(root, caseSensitivity()) == 0) {
+                folder = QString("");
+            } else {
+                folder = entryKey(path);
+                if (folder.isNull() or !entries.value(folder).directory) {
+                    continue;
+                }
+            }
+            if (!folders.contains(folder)) {
+                folders.append(folder);
+            }
+        }
+        return folders;
+    }
+
+    bool folderPrepared(QStringList folders)
+    {
+        foreach (QString folder, folders) {
+            if (!preparedFolders.contains(folder)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool inFolder(QString key, QString folder)
+    {
+        return (folder.length() == 0 or key.startsWith(folder + "/"));
+    }
+
+    // Only one extraction runs at a time,
+    // folders requested meanwhile are extracted together after it:
+    void startExtractor()
+    {
+        if (extractor != 0 or pendingFolders.isEmpty()) {
+            return;
+        }
+
+        QStringList keys;
+        QStringList archiveNames;
+        QStringList directoryNames;
+        foreach (QString key, entries.keys()) {
+            bool needed = false;
+            foreach (QString folder, pendingFolders) {
+                if (inFolder(key, folder)) {
+                    needed = true;
+                    break;
+                }
+            }
+            if (needed == false) {
+                continue;
+            }
+
+            ZipPackageEntry entry = entries.value(key);
+            if (entry.directory == true) {
+                directoryNames.append(entry.name);
+                continue;
+            }
+            if (entry.extracted == false and
+                    !FileDetector::instance()->extensionType(
+                        FileDetector::extension(key)).startsWith("browser")) {
+                keys.append(key);
+                archiveNames.append(entry.archiveName);
+            }
+        }
+
+        extractionTimer.start();
+        extractor = new PackageExtractor(archive.getZipName(), mountDirectory,
+                                         pendingFolders, keys, archiveNames,
+                                         directoryNames);
+        pendingFolders.clear();
+        QObject::connect(extractor, SIGNAL(finished()),
+                         this, SLOT(extractionFinishedSlot()));
+        extractor->start();
+    }
+
+    // Keys are paths relative to the mount folder with '/' separators:
+    QString entryKey(QString fullFilePath)
+    {
+        QString path = QDir::cleanPath(QDir::fromNativeSeparators(fullFilePath));
+        QString root = QDir::cleanPath(mountDirectory);
+
+        if (!path.startsWith(root + "/", caseSensitivity())) {
+            return QString();
+        }
+        return foldCase(path.mid(root.length() + 1));
+    }
+
+    static Qt::CaseSensitivity caseSensitivity()
+    {
+#ifdef Q_OS_WIN
+        return Qt::CaseInsensitive;
+#else
+        return Qt::CaseSensitive;
+#endif
+    }
+
+    static QString foldCase(QString key)
+    {
+#ifdef Q_OS_WIN
+        return key.toLower();
+#else
+        return key;
+#endif
+    }
+
+    // Folders without their own archive entries are added, so that
+    // they are found like folders on disk:
+    void addParentDirectories(QString name)
+    {
+        int separator = name.lastIndexOf('/');
+        while (separator > 0) {
+            QString parentName = name.left(separator);
+            if (entries.contains(foldCase(parentName))) {
+                return;
+            }
+
+            ZipPackageEntry parentEntry;
+            parentEntry.name = parentName;
+            parentEntry.size = 0;
+            parentEntry.directory = true;
+            parentEntry.extracted = false;
+            entries.insert(foldCase(parentName), parentEntry);
+
+            separator = parentName.lastIndexOf('/');
+        }
+    }
+
+    // The CRC of every completely inflated entry is verified by
+    // unzCloseCurrentFile(), partially read entries are not verified:
+    QByteArray inflate(const ZipPackageEntry &entry, bool &ok,
+                       qint64 maximumSize)
+    {
+        ok = false;
+        unzFile archiveFile = archive.getUnzFile();
+        if (unzGoToFilePos64(archiveFile, &entry.position) != UNZ_OK or
+                unzOpenCurrentFile(archiveFile) != UNZ_OK) {
+            return QByteArray();
+        }
+
+        qint64 expectedSize = (maximumSize >= 0) ?
+                    qMin(maximumSize, entry.size) : entry.size;
+        QByteArray data;
+        data.resize((int) expectedSize);
+
+        qint64 totalRead = 0;
+        while (totalRead < expectedSize) {
+            int bytesRead = unzReadCurrentFile(
+                        archiveFile, data.data() + totalRead,
+                        (unsigned) qMin(expectedSize - totalRead,
+                                        (qint64) inflateChunkSize));
+            if (bytesRead <= 0) {
+                break;
+            }
+            totalRead += bytesRead;
+        }
+
+        int closeResult = unzCloseCurrentFile(archiveFile);
+        ok = (totalRead == expectedSize and closeResult == UNZ_OK);
+        data.resize((int) totalRead);
+
+        return data;
+    }
+
+    bool extractEntry(QString key)
+    {
+        ZipPackageEntry entry = entries.value(key);
+        if (entry.extracted == true) {
+            return true;
+        }
+
+        bool inflated;
+        QByteArray data = inflate(entry, inflated, -1);
+        if (inflated == false) {
+            qDebug() << "ZIP package entry could not be inflated:" << key;
+            return false;
+        }
+
+        QString filePath = mountDirectory + entry.name;
+        QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+        // Other sessions using the same generation never see
+        // a partially written file:
+        QFile file(filePath + ".part-"
+                   + QString::number(QCoreApplication::applicationPid()));
+        if (!file.open(QIODevice::WriteOnly) or
+                file.write(data) != data.size()) {
+            qDebug() << "ZIP package entry could not be extracted:" << key;
+            file.close();
+            file.remove();
+            return false;
+        }
+        file.close();
+
+        if (entry.permissions != 0) {
+            file.setPermissions(entry.permissions);
+        }
+
+        QFile::remove(filePath);
+        if (!file.rename(filePath)) {
+            qDebug() << "ZIP package entry could not be extracted:" << key;
+            file.remove();
+            return false;
+        }
+
+        markExtracted(key);
+
+        return true;
+    }
+
+    void markExtracted(QString key)
+    {
+        entries[key].extracted = true;
+        entries[key].modified =
+                modificationTime(mountDirectory + entries.value(key).name);
+        extractedEntries++;
+
+        manifestFile.write(manifestLine(entries.value(key)));
+        manifestFile.flush();
+    }
+
+    // One line for every extracted entry:
+    // CRC, size, modification time of the extracted file and name.
+    static QByteArray manifestLine(const ZipPackageEntry &entry)
+    {
+        return QByteArray::number(entry.crc, 16) + " "
+                + QByteArray::number(entry.size) + " "
+                + QByteArray::number(entry.modified) + " "
+                + entry.name.toUtf8() + "\n";
+    }
+
+    static qint64 modificationTime(QString filePath)
+    {
+        return QFileInfo(filePath).lastModified().toMSecsSinceEpoch();
+    }
+
+    // Marks all entries of a generation folder, which are unchanged in
+    // the package and still on disk with their recorded size and
+    // modification time, as extracted.
+    // Entries of a previous generation are linked or copied
+    // into the current one.
+    // Lines of manifests written without modification times are
+    // never trusted and their entries are extracted again.
+    int takeEntries(QString generationDirectory, bool copyEntries)
+    {
+        QFile manifest(generationDirectory + manifestName);
+        if (!manifest.open(QIODevice::ReadOnly)) {
+            return 0;
+        }
+
+        int takenEntries = 0;
+        while (!manifest.atEnd()) {
+            QByteArray line = manifest.readLine();
+            if (line.endsWith('\n')) {
+                line.chop(1);
+            }
+
+            int crcEnd = line.indexOf(' ');
+            int sizeEnd = line.indexOf(' ', crcEnd + 1);
+            int modifiedEnd = line.indexOf(' ', sizeEnd + 1);
+            if (crcEnd < 0 or sizeEnd < 0 or modifiedEnd < 0) {
+                continue;
+            }
+
+            bool crcValid;
+            bool sizeValid;
+            bool modifiedValid;
+            quint32 crc = line.left(crcEnd).toUInt(&crcValid, 16);
+            qint64 size = line.mid(crcEnd + 1, sizeEnd - crcEnd - 1)
+                    .toLongLong(&sizeValid);
+            qint64 modified = line.mid(sizeEnd + 1,
+                                       modifiedEnd - sizeEnd - 1)
+                    .toLongLong(&modifiedValid);
+            QString name = QString::fromUtf8(line.mid(modifiedEnd + 1));
+
+            QString key = foldCase(name);
+            if (crcValid == false or sizeValid == false or
+                    modifiedValid == false or !entries.contains(key)) {
+                continue;
+            }
+
+            ZipPackageEntry entry = entries.value(key);
+            if (entry.directory == true or entry.extracted == true or
+                    entry.crc != crc or entry.size != size) {
+                continue;
+            }
+
+            // Files removed or changed since they were extracted
+            // are extracted again:
+            QFileInfo extractedFileInfo(generationDirectory + name);
+            if (!extractedFileInfo.isFile() or
+                    extractedFileInfo.size() != size or
+                    extractedFileInfo.lastModified().toMSecsSinceEpoch()
+                    != modified) {
+                continue;
+            }
+
+            if (copyEntries == true) {
+                QString filePath = mountDirectory + entry.name;
+                QDir().mkpath(QFileInfo(filePath).absolutePath());
+                if (!linkOrCopy(generationDirectory + name, filePath,
+                                entry.permissions)) {
+                    continue;
+                }
+                modified = modificationTime(filePath);
+            }
+
+            entries[key].extracted = true;
+            entries[key].modified = modified;
+            takenEntries++;
+        }
+
+        return takenEntries;
+    }
+
+    // Hard links cost no space and no time, but
+    // they are not available on all file systems.
+    // A file scripts can write is always copied, because
+    // a linked file would be changed in both generations.
+    // Entries without permissions in the package are writable:
+    static bool linkOrCopy(QString sourceFilePath, QString targetFilePath,
+                           QFile::Permissions permissions)
+    {
+        QFile::remove(targetFilePath);
+#ifndef Q_OS_WIN
+        QFile::Permissions writePermissions =
+                QFile::WriteOwner | QFile::WriteUser
+                | QFile::WriteGroup | QFile::WriteOther;
+        if (permissions != 0 and (permissions & writePermissions) == 0 and
+                ::link(QFile::encodeName(sourceFilePath).constData(),
+                       QFile::encodeName(targetFilePath).constData()) == 0) {
+            return true;
+        }
+#else
+        Q_UNUSED(permissions);
+#endif
+        return QFile::copy(sourceFilePath, targetFilePath);
+    }
+
+    // The last used other generation of the package:
+    QString previousGenerationDirectory()
+    {
+        QString previousDirectory;
+        QDateTime previousUse;
+
+        QDir directory(packageDirectory);
+        foreach (QString generationName,
+                 directory.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            if (generationName == generation) {
+                continue;
+            }
+            QString generationDirectory =
+                    packageDirectory + "/" + generationName + "/";
+            QFileInfo manifestInfo(generationDirectory + manifestName);
+            if (manifestInfo.exists() and
+                    (previousUse.isNull() or
+                     manifestInfo.lastModified() > previousUse)) {
+                previousUse = manifestInfo.lastModified();
+                previousDirectory = generationDirectory;
+            }
+        }
+
+        return previousDirectory;
+    }
+
+    static const int maximumShebangSize = 256;
+    static const int inflateChunkSize = 65536;
+    static const int lockTimeout = 5000;
+
+    QuaZip archive;
+    QString packageDirectory;
+    QString generation;
+    QString mountDirectory;
+    QString manifestName;
+    QFile manifestFile;
+    bool mounted;
+    QHash<QString, ZipPackageEntry> entries;
+    QSet<QString> preparedFolders;
+    QStringList pendingFolders;
+    QList<PackageWaiter> waiters;
+    PackageExtractor *extractor;
+    QElapsedTimer extractionTimer;
+#if QT_VERSION >= 0x050100
+    QLockFile *sessionLock;
+#endif
+    QHash<QString, QString> shebangTypes;
+};
+#endif
+
+// ==============================
+// ROOT INDEX SCANNER CLASS DEFINITION:
+// ==============================
+// Entry of the root index.
+// 'fileType' is a directory, a file detector type or 'perl'.
+struct RootIndexEntry {
+    bool directory;
+    qint64 size;
+    QDateTime modified;
+    QString fileType;
+};
+
+// Builds the root index in a background thread at startup.
+// Results are taken by the index only after the thread has finished.
+class RootIndexScanner : public QThread
+{
+    Q_OBJECT
+
+public:
+    RootIndexScanner(QString rootDirectory);
+
+    // Keys are paths relative to the root directory with '/' separators,
+    // the root directory itself being the empty key:
+    static void scanDirectory(QString rootDirectory,
+                              QString directoryKey,
+                              bool recursive,
+                              QHash<QString, RootIndexEntry> &entries,
+                              QHash<QString, QStringList> &directoryChildren)
+    {
+        QDir directory(rootDirectory + directoryKey);
+        QFileInfoList fileInfoList =
+                directory.entryInfoList(QDir::AllEntries | QDir::Hidden
+                                        | QDir::System | QDir::NoDotAndDotDot);
+
+        QStringList childKeys;
+        foreach (QFileInfo fileInfo, fileInfoList) {
+            QString childKey = directoryKey.length() > 0 ?
+                        directoryKey + "/" + fileInfo.fileName() :
+                        fileInfo.fileName();
+#ifdef Q_OS_WIN
+            childKey = childKey.toLower();
+#endif
+
+            RootIndexEntry entry = fileEntry(fileInfo);
+            entries.insert(childKey, entry);
+            childKeys.append(childKey);
+
+            // Symbolic links to directories are not followed,
+            // so that loops can not make the scan endless:
+            if (entry.directory == true and recursive == true and
+                    !fileInfo.isSymLink()) {
+                scanDirectory(rootDirectory, childKey, true,
+                              entries, directoryChildren);
+            }
+        }
+
+        directoryChildren.insert(directoryKey, childKeys);
+    }
+
+    static RootIndexEntry fileEntry(QFileInfo fileInfo)
+    {
+        RootIndexEntry entry;
+        entry.directory = fileInfo.isDir();
+        entry.size = fileInfo.size();
+        entry.modified = fileInfo.lastModified();
+
+        if (entry.directory == true) {
+            entry.fileType = "directory";
+        } else {
+            QString fileExtension = FileDetector::extension(fileInfo.fileName());
+            if (fileExtension.length() > 0) {
+                entry.fileType = FileDetector::instance()
+                        ->extensionType(fileExtension);
+            } else {
+                entry.fileType =
+                        FileDetector::hasPerlShebang(
+                            fileInfo.absoluteFilePath()) ?
+                            "perl" : "undefined";
+            }
+        }
+
+        return entry;
+    }
+
+    // Files without an extension are typed by their first line,
+    // so their contents are watched too:
+    static bool typedByShebang(QString key, RootIndexEntry entry)
+    {
+        return (entry.directory == false and
+                FileDetector::extension(key).length() == 0);
+    }
+
+    QHash<QString, RootIndexEntry> entries;
+    QHash<QString, QStringList> directoryChildren;
+
+protected:
+    void run()
+    {
+        scanDirectory(rootDirectory, "", true, entries, directoryChildren);
+    }
+
+private:
+    QString rootDirectory;
+};
+
+// ==============================
+// ROOT INDEX CLASS DEFINITION:
+// ==============================
+// All files and folders of the browser root directory.
+// Local requests are answered from this index without touching
+// the file system, which is slow on USB sticks.
+// The index is kept current by a file system watcher on every folder
+// and on every file typed by its shebang line.
+// Until the scan at startup is finished and for paths outside of
+// the root directory, the file system is used as before.
+class RootIndex : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void scanFinishedSlot()
+    {
+        entries = scanner->entries;
+        directoryChildren = scanner->directoryChildren;
+        scanner->deleteLater();
+        scanner = 0;
+
+        // The root directory is watched as the empty key:
+        foreach (QString directoryKey, directoryChildren.keys()) {
+            watcher.addPath(rootDirectory + directoryKey);
+        }
+        foreach (QString key, entries.keys()) {
+            if (RootIndexScanner::typedByShebang(key, entries.value(key))) {
+                watcher.addPath(rootDirectory + key);
+            }
+        }
+        ready = true;
+
+        // Changes made while the scan was running were not seen by
+        // the watcher, so folders and watched files modified since
+        // the start of the scan are read again.
+        // Two seconds are for the modification times of FAT file systems:
+        QDateTime changedSince = scanStarted.addSecs(-2);
+        QStringList changedDirectories;
+        foreach (QString directoryKey, directoryChildren.keys()) {
+            QFileInfo directoryInfo(rootDirectory + directoryKey);
+            if (!directoryInfo.exists() or
+                    directoryInfo.lastModified() >= changedSince) {
+                changedDirectories.append(rootDirectory + directoryKey);
+            }
+        }
+        foreach (QString changedFile, watcher.files()) {
+            QString key = indexKey(changedFile);
+            if (QFileInfo(changedFile).lastModified() !=
+                    entries.value(key).modified) {
+                fileChangedSlot(changedFile);
+            }
+        }
+        foreach (QString changedDirectory, changedDirectories) {
+            directoryChangedSlot(changedDirectory);
+        }
+
+        qDebug() << "Root index:" << entries.size() << "entries in"
+                 << scanTimer.elapsed() << "msecs";
+        qDebug() << "===============";
+    }
+
+    // A watched file was changed - its type is detected again:
+    void fileChangedSlot(QString changedFile)
+    {
+        FileDetector::instance()->forget(changedFile);
+
+        QString key = indexKey(changedFile);
+        if (key.isNull() or !entries.contains(key)) {
+            return;
+        }
+
+        // Files removed or renamed are handled by the folder watcher:
+        QFileInfo fileInfo(changedFile);
+        if (!fileInfo.exists()) {
+            return;
+        }
+
+        entries.insert(key, RootIndexScanner::fileEntry(fileInfo));
+
+        // Files replaced by editors saving a new copy are not watched anymore:
+        if (!watcher.files().contains(changedFile)) {
+            watcher.addPath(changedFile);
+        }
+    }
+
+    // A folder was changed - only its own entries are scanned again,
+    // new subfolders are scanned completely:
+    void directoryChangedSlot(QString changedDirectory)
+    {
+        QString directoryKey = indexKey(changedDirectory);
+        if (directoryKey.isNull()) {
+            return;
+        }
+
+        QStringList oldChildKeys = directoryChildren.value(directoryKey);
+        foreach (QString childKey, oldChildKeys) {
+            if (RootIndexScanner::typedByShebang(childKey,
+                                                 entries.value(childKey))) {
+                watcher.removePath(rootDirectory + childKey);
+                FileDetector::instance()->forget(rootDirectory + childKey);
+            }
+            entries.remove(childKey);
+        }
+
+        if (!QDir(changedDirectory).exists()) {
+            removeDirectory(directoryKey);
+            return;
+        }
+
+        QHash<QString, RootIndexEntry> changedEntries;
+        QHash<QString, QStringList> changedChildren;
+        RootIndexScanner::scanDirectory(rootDirectory, directoryKey, false,
+                                        changedEntries, changedChildren);
+
+        QStringList newChildKeys = changedChildren.value(directoryKey);
+        foreach (QString childKey, oldChildKeys) {
+            if (directoryChildren.contains(childKey) and
+                    !newChildKeys.contains(childKey)) {
+                removeDirectory(childKey);
+            }
+        }
+
+        entries.unite(changedEntries);
+        directoryChildren.insert(directoryKey, newChildKeys);
+
+        foreach (QString childKey, newChildKeys) {
+            if (RootIndexScanner::typedByShebang(childKey,
+                                                 changedEntries.value(childKey))) {
+                watcher.addPath(rootDirectory + childKey);
+            }
+        }
+
+        foreach (QString childKey, newChildKeys) {
+            if (changedEntries.value(childKey).directory == true and
+                    !directoryChildren.contains(childKey)) {
+                QHash<QString, QStringList> newDirectories;
+                RootIndexScanner::scanDirectory(rootDirectory, childKey, true,
+                                                entries, newDirectories);
+                directoryChildren.unite(newDirectories);
+                foreach (QString newDirectoryKey, newDirectories.keys()) {
+                    watcher.addPath(rootDirectory + newDirectoryKey);
+                    foreach (QString newKey,
+                             newDirectories.value(newDirectoryKey)) {
+                        if (RootIndexScanner::typedByShebang(
+                                    newKey, entries.value(newKey))) {
+                            watcher.addPath(rootDirectory + newKey);
+                        }
+                    }
+                }
+            }
+        }
+
+        qDebug() << "Root index updated:" << changedDirectory;
+        qDebug() << "===============";
+    }
+
+public:
+    RootIndex();
+
+    static RootIndex *instance()
+    {
+        static RootIndex *rootIndex = new RootIndex();
+        return rootIndex;
+    }
+
+    void startScan()
+    {
+        if (scanner != 0 or ready == true) {
+            return;
+        }
+
+        // The file detector is created in the GUI thread before the scan:
+        FileDetector::instance();
+
+        scanTimer.start();
+        scanStarted = QDateTime::currentDateTime();
+        scanner = new RootIndexScanner(rootDirectory);
+        QObject::connect(scanner, SIGNAL(finished()),
+                         this, SLOT(scanFinishedSlot()));
+        scanner->start(QThread::LowPriority);
+    }
+
+    bool isReady()
+    {
+        return ready;
+    }
+
+    bool exists(QString fullFilePath)
+    {
+#if ZIP_SUPPORT == 1
+        if (ZipPackage::instance()->contains(fullFilePath)) {
+            return true;
+        }
+#endif
+        QString key = indexKey(fullFilePath);
+        if (ready == false or key.isNull()) {
+            return QFile::exists(fullFilePath);
+        }
+        return (key.length() == 0 or entries.contains(key));
+    }
+
+    // Same results as the file detector:
+    QString fileType(QString fullFilePath)
+    {
+#if ZIP_SUPPORT == 1
+        // Entries of the ZIP package are typed without extracting them:
+        if (ZipPackage::instance()->contains(fullFilePath)) {
+            return detectorType(ZipPackage::instance()->fileType(fullFilePath));
+        }
+#endif
+        QString key = indexKey(fullFilePath);
+        if (ready == false or key.isNull()) {
+            return FileDetector::instance()->lookup(fullFilePath);
+        }
+
+        if (entries.contains(key)) {
+            return detectorType(entries.value(key).fileType);
+        }
+
+        // Missing files are typed only by their extension:
+        return detectorType(FileDetector::instance()->extensionType(
+                                FileDetector::extension(fullFilePath)));
+    }
+
+private:
+    static QString detectorType(QString type)
+    {
+        if (type == "perl") {
+            return (qApp->property("perlInterpreter").toString());
+        }
+        if (type == "directory") {
+            return QString("undefined");
+        }
+        return type;
+    }
+
+    // Null string for paths outside of the root directory:
+    QString indexKey(QString fullFilePath)
+    {
+        QString path = QDir::cleanPath(QDir::fromNativeSeparators(fullFilePath));
+        QString root = QDir::cleanPath(rootDirectory);
+
+#ifdef Q_OS_WIN
+        Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive;
+#else
+        Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive;
+#endif
+        if (path.compare(root, caseSensitivity) == 0) {
+            return QString("");
+        }
+        if (!path.startsWith(root + "/", caseSensitivity)) {
+            return QString();
+        }
+
+        QString key = path.mid(root.length() + 1);
+#ifdef Q_OS_WIN
+        key = key.toLower();
+#endif
+        return key;
+    }
+
+    void removeDirectory(QString directoryKey)
+    {
+        foreach (QString childKey, directoryChildren.value(directoryKey)) {
+            if (RootIndexScanner::typedByShebang(childKey,
+                                                 entries.value(childKey))) {
+                watcher.removePath(rootDirectory + childKey);
+            }
+            entries.remove(childKey);
+            if (directoryChildren.contains(childKey)) {
+                removeDirectory(childKey);
+            }
+        }
+        directoryChildren.remove(directoryKey);
+        entries.remove(directoryKey);
+        watcher.removePath(rootDirectory + directoryKey);
+    }
+
+    QString rootDirectory;
+    RootIndexScanner *scanner;
+    QElapsedTimer scanTimer;
+    QDateTime scanStarted;
+    bool ready;
+    QHash<QString, RootIndexEntry> entries;
+    QHash<QString, QStringList> directoryChildren;
+    QFileSystemWatcher watcher;
+};
+
+// ==============================
+// SYSTEM TRAY ICON CLASS DEFINITION:
+// ==============================
+class TrayIcon : public QSystemTrayIcon
+{
+    Q_OBJECT
+
+public slots:
+    void trayIconActivatedSlot(QSystemTrayIcon::ActivationReason reason)
+    {
+        if (reason == QSystemTrayIcon::DoubleClick) {
+
+            if ((qApp->property("systrayIconDoubleClickAction")
+                 .toString()) == "quit") {
+                QMessageBox confirmExitMessageBox;
+                confirmExitMessageBox.setWindowModality(Qt::WindowModal);
+                confirmExitMessageBox.setWindowTitle(tr("Quit"));
+                confirmExitMessageBox
+                        .setIconPixmap((qApp->property("icon").toString()));
+                confirmExitMessageBox
+                        .setText(tr("You are going to quit the program.<br>")
+                                 + tr("Are you sure?"));
+                confirmExitMessageBox
+                        .setStandardButtons(QMessageBox::Yes
+                                            | QMessageBox::No);
+                confirmExitMessageBox.setButtonText(QMessageBox::Yes,
+                                                    tr("Yes"));
+                confirmExitMessageBox.setButtonText(QMessageBox::No,
+                                                    tr("No"));
+                confirmExitMessageBox.setDefaultButton(QMessageBox::No);
+                if (confirmExitMessageBox.exec() == QMessageBox::Yes) {
+                    QApplication::quit();
+                }
+            }
+
+            if ((qApp->property("systrayIconDoubleClickAction")
+                 .toString()) == "minimize_all_windows") {
+                foreach (QWidget *window, QApplication::topLevelWidgets()) {
+                    if (window->isVisible()) {
+                        window->showMinimized();
+                    }
+                }
+            }
+
+        }
+    }
+
+    void trayIconHideSlot()
+    {
+        trayIcon->hide();
+    }
+
+public:
+    TrayIcon();
+
+    QAction *quitAction;
+    QAction *aboutAction;
+    QAction *aboutQtAction;
+
+private:
+    QSystemTrayIcon *trayIcon;
+    QMenu *trayIconMenu;
+};
+
+// ==============================
+// UTF-8 STREAM DECODER CLASS DEFINITION:
+// ==============================
+// Decodes UTF-8 output of one script chunk by chunk.
+// Sequences split between two chunks are carried over to the next chunk,
+// invalid sequences become U+FFFD.
+// Runs of ASCII characters are found 16 bytes at a time with SSE2 or
+// 8 bytes at a time otherwise and are converted without validation.
+class Utf8StreamDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    Utf8StreamDecoder();
+
+    QString decode(QByteArray chunk)
+    {
+        if (carriedBytes.size() > 0) {
+            chunk.prepend(carriedBytes);
+            carriedBytes.clear();
+        }
+
+        const unsigned char *data =
+                reinterpret_cast<const unsigned char *>(chunk.constData());
+        int size = chunk.size();
+
+        QString text;
+        text.reserve(size);
+
+        int position = 0;
+        while (position < size) {
+            int asciiEnd = asciiRunEnd(data, position, size);
+            if (asciiEnd > position) {
+                text.append(QString::fromLatin1(
+                                reinterpret_cast<const char *>(data + position),
+                                asciiEnd - position));
+                position = asciiEnd;
+                continue;
+            }
+
+            int sequenceLength = 0;
+            uint codePoint = 0;
+            unsigned char lead = data[position];
+
+            if (lead >= 0xC2 and lead <= 0xDF) {
+                sequenceLength = 2;
+                codePoint = lead & 0x1F;
+            } else if (lead >= 0xE0 and lead <= 0xEF) {
+                sequenceLength = 3;
+                codePoint = lead & 0x0F;
+            } else if (lead >= 0xF0 and lead <= 0xF4) {
+                sequenceLength = 4;
+                codePoint = lead & 0x07;
+            } else {
+                text.append(QChar(QChar::ReplacementCharacter));
+                position++;
+                continue;
+            }
+
+            // A sequence cut at the end of the chunk waits for the next one:
+            int available = qMin(sequenceLength, size - position);
+            bool valid = true;
+            int index = 1;
+            for (; index < available; index++) {
+                unsigned char continuation = data[position + index];
+                if ((continuation & 0xC0) != 0x80) {
+                    valid = false;
+                    break;
+                }
+                codePoint = (codePoint << 6) | (continuation & 0x3F);
+            }
+
+            if (valid == true and available < sequenceLength) {
+                carriedBytes = QByteArray(
+                            reinterpret_cast<const char *>(data + position),
+                            available);
+                break;
+            }
+
+            // Overlong forms, surrogates and values above U+10FFFF:
+            if (valid == true and
+                    ((sequenceLength == 3 and codePoint < 0x800) or
+                     (sequenceLength == 4 and codePoint < 0x10000) or
+                     (codePoint >= 0xD800 and codePoint <= 0xDFFF) or
+                     codePoint > 0x10FFFF)) {
+                valid = false;
+                index = sequenceLength;
+            }
+
+            if (valid == false) {
+                text.append(QChar(QChar::ReplacementCharacter));
+                position += index;
+                continue;
+            }
+
+            if (codePoint >= 0x10000) {
+                codePoint -= 0x10000;
+                text.append(QChar(ushort(0xD800 + (codePoint >> 10))));
+                text.append(QChar(ushort(0xDC00 + (codePoint & 0x3FF))));
+            } else {
+                text.append(QChar(ushort(codePoint)));
+            }
+            position += sequenceLength;
+        }
+
+        return text;
+    }
+
+    // Bytes of an incomplete sequence at the end of the output:
+    QString finish()
+    {
+        QString text;
+        if (carriedBytes.size() > 0) {
+            text.append(QChar(QChar::ReplacementCharacter));
+            carriedBytes.clear();
+        }
+        return text;
+    }
+
+private:
+    static int asciiRunEnd(const unsigned char *data, int position, int size)
+    {
+#ifdef __SSE2__
+        while (position + 16 <= size) {
+            __m128i block = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i *>(data + position));
+            int nonAsciiMask = _mm_movemask_epi8(block);
+            if (nonAsciiMask != 0) {
+                return position + countTrailingZeros(nonAsciiMask);
+            }
+            position += 16;
+        }
+#endif
+        while (position + 8 <= size) {
+            quint64 block;
+            memcpy(&block, data + position, 8);
+            if ((block & Q_UINT64_C(0x8080808080808080)) != 0) {
+                break;
+            }
+            position += 8;
+        }
+
+        while (position < size and data[position] < 0x80) {
+            position++;
+        }
+
+        return position;
+    }
+
+#ifdef __SSE2__
+    static int countTrailingZeros(int mask)
+    {
+        int count = 0;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            count++;
+        }
+        return count;
+    }
+#endif
+
+    QByteArray carriedBytes;
+};
+
+// ==============================
+// CGI RESPONSE PARSER CLASS DEFINITION:
+// ==============================
+// Incremental parser for CGI/1.1 responses.
+// Output is fed in as it arrives and only the header block is buffered.
+// The body is returned as raw bytes and
+// is decoded to text by the script worker only when needed.
+class CgiResponseParser : public QObject
+{
+    Q_OBJECT
+
+public:
+    CgiResponseParser();
+
+    // Returns the part of the output that belongs to the body:
+    QByteArray parse(QByteArray outputData)
+    {
+        if (headersComplete == true) {
+            return outputData;
+        }
+
+        headerBuffer.append(outputData);
+
+        // Output not starting with a header field name has no header block:
+        if (headerBuffer.size() > 0 and
+                !isTokenCharacter(headerBuffer.at(0)) and
+                headerBuffer.at(0) != '\r' and headerBuffer.at(0) != '\n') {
+            return completeHeaders(0);
+        }
+
+        while (true) {
+            int lineEnd = headerBuffer.indexOf('\n', lineStart);
+            if (lineEnd < 0) {
+                break;
+            }
+
+            QByteArray line = headerBuffer.mid(lineStart, lineEnd - lineStart);
+            if (line.endsWith('\r')) {
+                line.chop(1);
+            }
+
+            if (line.isEmpty()) {
+                return completeHeaders(lineEnd + 1);
+            }
+
+            if (!parseHeaderLine(line)) {
+                // Not a header block at all - the whole output is the body:
+                resetHeaders();
+                return completeHeaders(0);
+            }
+
+            lineStart = lineEnd + 1;
+        }
+
+        // Endless header blocks are not waited for:
+        if (headerBuffer.size() > maximumHeaderSize) {
+            resetHeaders();
+            return completeHeaders(0);
+        }
+
+        return QByteArray();
+    }
+
+    // Returns output still held back when the script ends
+    // without completing its header block:
+    QByteArray finish()
+    {
+        if (headersComplete == true) {
+            return QByteArray();
+        }
+
+        bool headerBlock = true;
+        if (lineStart < headerBuffer.size()) {
+            QByteArray line = headerBuffer.mid(lineStart);
+            if (line.endsWith('\r')) {
+                line.chop(1);
+            }
+            headerBlock = parseHeaderLine(line);
+        }
+
+        // Lines looking like headers are taken as a header block
+        // only if they contain at least one CGI header:
+        if (headerBlock == false or
+                (statusSet == false and contentTypeSet == false and
+                 location.isEmpty())) {
+            resetHeaders();
+            return completeHeaders(0);
+        }
+
+        return completeHeaders(headerBuffer.size());
+    }
+
+    QByteArray mimeType()
+    {
+        return contentType.split(';').first().trimmed().toLower();
+    }
+
+    QByteArray charset()
+    {
+        foreach (QByteArray parameter, contentType.split(';')) {
+            parameter = parameter.trimmed();
+            if (parameter.toLower().startsWith("charset=")) {
+                return parameter.mid(8).replace("\"", "").trimmed();
+            }
+        }
+        return QByteArray("utf-8");
+    }
+
+    bool isHtml()
+    {
+        return (mimeType() == "text/html" or
+                mimeType() == "application/xhtml+xml");
+    }
+
+    bool isText()
+    {
+        QByteArray type = mimeType();
+        return (type.startsWith("text/") or
+                type == "application/json" or
+                type == "application/javascript" or
+                type == "application/xml" or
+                type.endsWith("+xml"));
+    }
+
+    bool isAttachment()
+    {
+        return contentDisposition.trimmed().toLower().startsWith("attachment");
+    }
+
+    QString attachmentFileName()
+    {
+        QRegExp fileNameRegExp("filename\\s*=\\s*\"?([^\";]+)\"?");
+        fileNameRegExp.setCaseSensitivity(Qt::CaseInsensitive);
+        if (fileNameRegExp.indexIn(QString::fromUtf8(contentDisposition)) >= 0) {
+            // Only the file name is taken, never a path:
+            return QFileInfo(fileNameRegExp.cap(1).trimmed()).fileName();
+        }
+        return QString();
+    }
+
+    bool isUtf8()
+    {
+        QByteArray name = charset().toLower();
+        return (name == "utf-8" or name == "utf8");
+    }
+
+    // Header fields of a parser, which has completed them
+    // in the I/O thread. They are not changed there after that:
+    void copyHeaders(CgiResponseParser *parser)
+    {
+        headersComplete = parser->headersComplete;
+        statusCode = parser->statusCode;
+        reasonPhrase = parser->reasonPhrase;
+        contentType = parser->contentType;
+        location = parser->location;
+        contentDisposition = parser->contentDisposition;
+        rawHeaders = parser->rawHeaders;
+    }
+
+    // Value of the first header with this name, in any letter case:
+    QByteArray header(QByteArray name)
+    {
+        name = name.toLower();
+        for (int index = 0; index < rawHeaders.size(); index++) {
+            if (rawHeaders.at(index).first.toLower() == name) {
+                return rawHeaders.at(index).second;
+            }
+        }
+        return QByteArray();
+    }
+
+    bool headersComplete;
+    int statusCode;
+    QByteArray reasonPhrase;
+    QByteArray contentType;
+    QByteArray location;
+    QByteArray contentDisposition;
+    QList<QPair<QByteArray, QByteArray> > rawHeaders;
+
+private:
+    static bool isTokenCharacter(char character)
+    {
+        return ((character >= 'a' and character <= 'z') or
+                (character >= 'A' and character <= 'Z') or
+                (character >= '0' and character <= '9') or
+                character == '-' or character == '_');
+    }
+
+    bool parseHeaderLine(QByteArray line)
+    {
+        int colon = line.indexOf(':');
+        if (colon <= 0) {
+            return false;
+        }
+
+        QByteArray name = line.left(colon);
+        for (int index = 0; index < name.size(); index++) {
+            if (!isTokenCharacter(name.at(index))) {
+                return false;
+            }
+        }
+        QByteArray value = line.mid(colon + 1).trimmed();
+        QByteArray lowerName = name.toLower();
+
+        if (lowerName == "status") {
+            int space = value.indexOf(' ');
+            statusCode = value.left(space).toInt();
+            reasonPhrase = (space > 0) ? value.mid(space + 1) : QByteArray();
+            statusSet = true;
+        } else if (lowerName == "content-type") {
+            contentType = value;
+            contentTypeSet = true;
+        } else if (lowerName == "location") {
+            location = value;
+        } else {
+            if (lowerName == "content-disposition") {
+                contentDisposition = value;
+            }
+            rawHeaders.append(qMakePair(name, value));
+        }
+
+        return true;
+    }
+
+    QByteArray completeHeaders(int bodyStart)
+    {
+        headersComplete = true;
+
+        // Local and client redirects are both answered as a redirection,
+        // local paths being resolved in the pseudo-domain:
+        if (location.size() > 0 and statusSet == false) {
+            statusCode = 302;
+            reasonPhrase = "Found";
+        }
+        if (location.startsWith('/')) {
+            location = QByteArray(PSEUDO_DOMAIN) + location.mid(1);
+        }
+
+        QByteArray body = headerBuffer.mid(bodyStart);
+        headerBuffer.clear();
+        return body;
+    }
+
+    void resetHeaders()
+    {
+        statusCode = 200;
+        reasonPhrase = "OK";
+        contentType = "text/html; charset=utf-8";
+        location.clear();
+        contentDisposition.clear();
+        rawHeaders.clear();
+        statusSet = false;
+        contentTypeSet = false;
+    }
+
+    static const int maximumHeaderSize = 65536;
+
+    QByteArray headerBuffer;
+    int lineStart;
+    bool statusSet;
+    bool contentTypeSet;
+};
+
+// ==============================
+// RENDER SCHEDULER CLASS DEFINITION:
+// ==============================
+// Coalesces updates of one output target.
+// Updates are committed at most once per display frame and
+// never from inside the call requesting them.
+// Output arriving between two frames is either merged into the next commit
+// (coalesced) or replaced by newer output (dropped).
+// The frame rate is the 'perl_output_frame_rate' setting.
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void renderSignal();
+
+public slots:
+    void commitSlot()
+    {
+        commitTimer.stop();
+
+        if (updatePending == true) {
+            updatePending = false;
+            committedUpdates++;
+            lastCommitTimer.start();
+            emit renderSignal();
+        }
+    }
+
+public:
+    RenderScheduler();
+
+    // 'replacesPending' is true for output replacing the whole document:
+    void requestUpdate(bool replacesPending)
+    {
+        if (updatePending == true) {
+            if (replacesPending == true) {
+                droppedUpdates++;
+            } else {
+                coalescedUpdates++;
+            }
+            return;
+        }
+
+        updatePending = true;
+
+        qint64 wait = 0;
+        if (lastCommitTimer.isValid()) {
+            wait = qMax((qint64) 0,
+                        frameInterval - (qint64) lastCommitTimer.elapsed());
+        }
+        commitTimer.start(wait);
+    }
+
+    // Commits any pending update immediately, for example on process exit:
+    void flush()
+    {
+        commitSlot();
+    }
+
+    // Commits on the next turn of the event loop, even without new output:
+    void flushSoon()
+    {
+        updatePending = true;
+        commitTimer.start(0);
+    }
+
+    qint64 committedUpdates;
+    qint64 coalescedUpdates;
+    qint64 droppedUpdates;
+
+private:
+    QTimer commitTimer;
+    QElapsedTimer lastCommitTimer;
+    qint64 frameInterval;
+    bool updatePending;
+};
+
+// ==============================
+// SCRIPT SPOOL CLASS DEFINITION:
+// ==============================
+// Byte queue for very large script output.
+// The first megabytes are kept in memory as shared segments and
+// everything beyond 'perl_output_memory_limit' is spilled to a file in
+// the output directory of the browser session.
+// Spilled output is read back through a memory-mapped window and
+// the spool file is removed as soon as it is read or the spool is destroyed.
+class ScriptSpool : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScriptSpool();
+
+    ~ScriptSpool()
+    {
+        removeSpoolFile();
+    }
+
+    void append(QByteArray data)
+    {
+        if (data.size() == 0) {
+            return;
+        }
+
+        // Once spilling has started, all output goes to the file,
+        // so that the order of the output is kept:
+        if (spoolFile.isOpen() or memoryBytes + data.size() > memoryLimit) {
+            if (spoolFile.isOpen() or openSpoolFile()) {
+                spoolFile.write(data);
+                spoolFile.flush();
+                spooledBytes += data.size();
+                availableBytes += data.size();
+                return;
+            }
+        }
+
+        segments.append(data);
+        memoryBytes += data.size();
+        availableBytes += data.size();
+    }
+
+    qint64 read(char *data, qint64 maxSize)
+    {
+        qint64 bytesRead = 0;
+
+        // Output in memory is always older than spilled output:
+        while (bytesRead < maxSize and !segments.isEmpty()) {
+            const QByteArray &segment = segments.first();
+            qint64 length = qMin(maxSize - bytesRead,
+                                 (qint64) (segment.size() - segmentOffset));
+
+            memcpy(data + bytesRead, segment.constData() + segmentOffset, length);
+            bytesRead += length;
+            segmentOffset += length;
+
+            if (segmentOffset == segment.size()) {
+                memoryBytes -= segment.size();
+                segments.removeFirst();
+                segmentOffset = 0;
+            }
+        }
+
+        while (bytesRead < maxSize and spoolReadOffset < spooledBytes) {
+            qint64 length = qMin(maxSize - bytesRead,
+                                 spooledBytes - spoolReadOffset);
+
+            const uchar *mapped = mappedBytes(spoolReadOffset, length);
+            if (mapped != 0) {
+                memcpy(data + bytesRead, mapped, length);
+            } else {
+                spoolFile.seek(spoolReadOffset);
+                length = spoolFile.read(data + bytesRead, length);
+                spoolFile.seek(spoolFile.size());
+                if (length <= 0) {
+                    break;
+                }
+            }
+
+            bytesRead += length;
+            spoolReadOffset += length;
+        }
+
+        availableBytes -= bytesRead;
+
+        // Output fitting in memory again is not spilled any more:
+        if (spoolFile.isOpen() and spoolReadOffset == spooledBytes) {
+            removeSpoolFile();
+        }
+
+        return bytesRead;
+    }
+
+    // Unread output not spilled to disk, which is left in the spool:
+    QByteArray memoryContents()
+    {
+        QByteArray contents;
+        for (int index = 0; index < segments.size(); index++) {
+            contents.append(index == 0 ?
+                                segments.at(index).mid(segmentOffset) :
+                                segments.at(index));
+        }
+        return contents;
+    }
+
+    // Moves all unread output to a file, which outlives the spool:
+    bool saveAs(QString filePath)
+    {
+        QFile outputFile(filePath);
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+
+        QByteArray block(1048576, char(0));
+        qint64 length;
+        while ((length = read(block.data(), block.size())) > 0) {
+            outputFile.write(block.constData(), length);
+        }
+        outputFile.close();
+        return true;
+    }
+
+    // Copies all unread output to a device and leaves it in the spool:
+    bool copyTo(QIODevice *device)
+    {
+        for (int index = 0; index < segments.size(); index++) {
+            QByteArray segment = (index == 0 ?
+                                      segments.at(index).mid(segmentOffset) :
+                                      segments.at(index));
+            if (device->write(segment) != segment.size()) {
+                return false;
+            }
+        }
+
+        qint64 offset = spoolReadOffset;
+        while (offset < spooledBytes) {
+            qint64 length = qMin((qint64) mappedWindowSize,
+                                 spooledBytes - offset);
+
+            const uchar *mapped = mappedBytes(offset, length);
+            QByteArray block;
+            if (mapped != 0) {
+                block = QByteArray::fromRawData((const char *) mapped, length);
+            } else {
+                spoolFile.seek(offset);
+                block = spoolFile.read(length);
+                spoolFile.seek(spoolFile.size());
+                if (block.size() == 0) {
+                    return false;
+                }
+            }
+
+            if (device->write(block) != block.size()) {
+                return false;
+            }
+            offset += block.size();
+        }
+
+        return true;
+    }
+
+    void clear()
+    {
+        removeSpoolFile();
+        segments.clear();
+        segmentOffset = 0;
+        memoryBytes = 0;
+        availableBytes = 0;
+    }
+
+    qint64 size() const
+    {
+        return availableBytes;
+    }
+
+    bool isSpilled() const
+    {
+        return spoolFile.isOpen();
+    }
+
+private:
+    bool openSpoolFile()
+    {
+        static int spoolCounter = 0;
+        spoolCounter++;
+
+        spoolFile.setFileName(
+                    QDir::toNativeSeparators(
+                        (qApp->property("applicationOutputDirectory").toString())
+                        + QDir::separator() + "spool-"
+                        + QString::number(spoolCounter) + ".out"));
+
+        if (!spoolFile.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+            qDebug() << "Output spool could not be created:"
+                     << spoolFile.fileName();
+            qDebug() << "===============";
+            return false;
+        }
+
+        qDebug() << "Script output spilled to:" << spoolFile.fileName();
+        qDebug() << "===============";
+
+        spooledBytes = 0;
+        spoolReadOffset = 0;
+        return true;
+    }
+
+    // Spilled output is mapped in windows of several megabytes,
+    // which are replaced only when reading leaves them:
+    const uchar *mappedBytes(qint64 offset, qint64 length)
+    {
+        if (mappedWindow == 0 or offset < mappedOffset or
+                offset + length > mappedOffset + mappedSize) {
+            if (mappedWindow != 0) {
+                spoolFile.unmap(mappedWindow);
+                mappedWindow = 0;
+            }
+
+            mappedOffset = offset;
+            mappedSize = qMax(length, qMin((qint64) mappedWindowSize,
+                                           spooledBytes - offset));
+            mappedWindow = spoolFile.map(mappedOffset, mappedSize);
+            if (mappedWindow == 0) {
+                return 0;
+            }
+        }
+
+        return mappedWindow + (offset - mappedOffset);
+    }
+
+    void removeSpoolFile()
+    {
+        if (mappedWindow != 0) {
+            spoolFile.unmap(mappedWindow);
+            mappedWindow = 0;
+        }
+
+        if (spoolFile.isOpen()) {
+            spoolFile.close();
+            spoolFile.remove();
+        }
+
+        spooledBytes = 0;
+        spoolReadOffset = 0;
+    }
+
+    static const int mappedWindowSize = 4194304;
+
+    QList<QByteArray> segments;
+    qint64 segmentOffset;
+    qint64 memoryBytes;
+    qint64 memoryLimit;
+    qint64 availableBytes;
+    QFile spoolFile;
+    qint64 spooledBytes;
+    qint64 spoolReadOffset;
+    uchar *mappedWindow;
+    qint64 mappedOffset;
+    qint64 mappedSize;
+};
+
+// ==============================
+// SCRIPT OUTPUT BUFFER CLASS DEFINITION:
+// ==============================
+// Output of one script waiting to be read by WebKit.
+// Chunks are queued in a spool of implicitly shared segments, so
+// appending and reading never copy or move earlier output and
+// output WebKit can not keep up with is spilled to disk.
+// The theme stylesheet is inserted only once, at the head of
+// HTML documents, and all later output is only appended.
+class ScriptOutputBuffer : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScriptOutputBuffer();
+
+    void setThemeLink(QByteArray link)
+    {
+        themeLink = link;
+        themeLinkPending = (link.size() > 0);
+    }
+
+    void append(QByteArray outputData)
+    {
+        totalBytes += outputData.size();
+
+        // The document head is held back only until its title is complete:
+        if (themeLinkPending == true) {
+            pendingHead.append(outputData);
+
+            int titleEnd = pendingHead.indexOf("</title>");
+            if (titleEnd >= 0 and !pendingHead.contains("current.css")) {
+                pendingHead.insert(titleEnd + 8, "\n" + themeLink);
+            }
+
+            if (titleEnd >= 0 or pendingHead.contains("<body") or
+                    pendingHead.size() > maximumHeadSize) {
+                themeLinkPending = false;
+                outputData = pendingHead;
+                pendingHead.clear();
+            } else {
+                return;
+            }
+        }
+
+        appendSegment(outputData);
+    }
+
+    // Releases a document head still held back:
+    void flush()
+    {
+        if (themeLinkPending == true) {
+            themeLinkPending = false;
+            appendSegment(pendingHead);
+            pendingHead.clear();
+        }
+    }
+
+    qint64 size() const
+    {
+        return spool.size();
+    }
+
+    qint64 read(char *data, qint64 maxSize)
+    {
+        return spool.read(data, maxSize);
+    }
+
+    qint64 totalBytes;
+
+private:
+    void appendSegment(QByteArray segment)
+    {
+        spool.append(segment);
+    }
+
+    static const int maximumHeadSize = 4096;
+
+    ScriptSpool spool;
+    QByteArray themeLink;
+    QByteArray pendingHead;
+    bool themeLinkPending;
+};
+
+// ==============================
+// SCRIPT RESPONSE CACHE CLASS DEFINITION:
+// ==============================
+// Responses of GET scripts declaring them cacheable.
+// Entries are keyed by script path and query string and are valid only
+// while the script and the files listed in its 'X-PEB-Depends' header
+// keep their modification times.
+// 'Cache-Control: max-age' makes a response fresh and fresh responses are
+// displayed without starting the script. Stale responses having 'ETag' or
+// 'Last-Modified' are revalidated by the script, which gets
+// HTTP_IF_NONE_MATCH and HTTP_IF_MODIFIED_SINCE and may answer with 304.
+// Least recently used entries are evicted beyond the memory budget and
+// persisted entries are read back from the temporary folder of the session.
+class ScriptResponseCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct CachedResponse {
+        int statusCode;
+        QByteArray reasonPhrase;
+        QByteArray contentType;
+        QByteArray location;
+        QList<QPair<QByteArray, QByteArray> > rawHeaders;
+        QByteArray body;
+        QByteArray entityTag;
+        QByteArray lastModified;
+        QDateTime expires;
+        // Modification times of the script and its dependencies:
+        QHash<QString, QDateTime> dependencies;
+    };
+
+    enum Freshness {
+        Missing,
+        Fresh,
+        Stale
+    };
+
+    ScriptResponseCache();
+
+    static ScriptResponseCache *instance()
+    {
+        static ScriptResponseCache *scriptResponseCache =
+                new ScriptResponseCache();
+        return scriptResponseCache;
+    }
+
+    static QString cacheKey(QString scriptFullFilePath, QString queryString)
+    {
+        return scriptFullFilePath + "?" + queryString;
+    }
+
+    bool isEnabled()
+    {
+        return enabled;
+    }
+
+    // Larger responses are not collected at all:
+    int maximumEntrySize()
+    {
+        return entries.maxCost();
+    }
+
+    Freshness lookup(QString key, CachedResponse &response)
+    {
+        CachedResponse *entry = entries.object(key);
+        if (entry == 0 and persistent == true) {
+            entry = loadEntry(key);
+        }
+        if (entry == 0) {
+            return Missing;
+        }
+
+        QHashIterator<QString, QDateTime> dependency(entry->dependencies);
+        while (dependency.hasNext()) {
+            dependency.next();
+            if (QFileInfo(dependency.key()).lastModified() !=
+                    dependency.value()) {
+                qDebug() << "Cached response outdated by:" << dependency.key();
+                removeEntry(key);
+                return Missing;
+            }
+        }
+
+        response = *entry;
+
+        if (QDateTime::currentDateTime().toUTC() < entry->expires) {
+            return Fresh;
+        }
+
+        if (entry->entityTag.size() > 0 or entry->lastModified.size() > 0) {
+            return Stale;
+        }
+
+        removeEntry(key);
+        return Missing;
+    }
+
+    void store(QString scriptFullFilePath,
+               QString key,
+               CgiResponseParser *responseParser,
+               QByteArray body)
+    {
+        QByteArray cacheControl =
+                responseParser->header("Cache-Control").toLower();
+
+        if (responseParser->statusCode != 200 or
+                cacheControl.contains("no-store")) {
+            return;
+        }
+
+        // A response larger than the whole budget would be rejected by
+        // the cache, so an older response of the same key is dropped too:
+        int cost = qMax(1, body.size());
+        if (cost > entries.maxCost()) {
+            removeEntry(key);
+            return;
+        }
+
+        CachedResponse *entry = new CachedResponse;
+        entry->statusCode = responseParser->statusCode;
+        entry->reasonPhrase = responseParser->reasonPhrase;
+        entry->contentType = responseParser->contentType;
+        entry->location = responseParser->location;
+        entry->rawHeaders = responseParser->rawHeaders;
+        entry->body = body;
+        entry->entityTag = responseParser->header("ETag");
+        entry->lastModified = responseParser->header("Last-Modified");
+
+        // Scripts not declaring their responses cacheable are never cached:
+        int maximumAge = cacheMaximumAge(cacheControl);
+        if (maximumAge < 0 and entry->entityTag.size() == 0 and
+                entry->lastModified.size() == 0) {
+            delete entry;
+            return;
+        }
+        entry->expires = QDateTime::currentDateTime().toUTC()
+                .addSecs(qMax(0, maximumAge));
+
+        entry->dependencies.insert(scriptFullFilePath,
+                                   QFileInfo(scriptFullFilePath)
+                                   .lastModified());
+        foreach (QByteArray dependency,
+                 responseParser->header("X-PEB-Depends").split(',')) {
+            QString dependencyPath = QString::fromUtf8(dependency.trimmed());
+            if (dependencyPath.length() == 0) {
+                continue;
+            }
+            if (QFileInfo(dependencyPath).isRelative()) {
+                dependencyPath = QDir::toNativeSeparators(
+                            (qApp->property("rootDirName").toString())
+                            + dependencyPath);
+            }
+            entry->dependencies.insert(dependencyPath,
+                                       QFileInfo(dependencyPath)
+                                       .lastModified());
+        }
+
+        // Only entries accepted by the cache are saved.
+        // QCache deletes a rejected entry itself:
+        if (!entries.insert(key, entry, cost)) {
+            removeEntry(key);
+            return;
+        }
+
+        if (persistent == true) {
+            saveEntry(key, entry);
+        }
+
+        qDebug() << "Script response cached:" << key;
+        qDebug() << "Cached response expires:" << entry->expires.toString();
+        qDebug() << "===============";
+    }
+
+    // A '304 Not Modified' answer makes the entry fresh again:
+    void refresh(QString key, CgiResponseParser *responseParser)
+    {
+        CachedResponse *entry = entries.object(key);
+        if (entry == 0 and persistent == true) {
+            entry = loadEntry(key);
+        }
+        if (entry == 0) {
+            return;
+        }
+
+        int maximumAge = cacheMaximumAge(
+                    responseParser->header("Cache-Control").toLower());
+        if (maximumAge > 0) {
+            entry->expires = QDateTime::currentDateTime().toUTC()
+                    .addSecs(maximumAge);
+        }
+        if (responseParser->header("ETag").size() > 0) {
+            entry->entityTag = responseParser->header("ETag");
+        }
+
+        if (persistent == true) {
+            saveEntry(key, entry);
+        }
+
+        qDebug() << "Cached response revalidated:" << key;
+        qDebug() << "===============";
+    }
+
+private:
+    static int cacheMaximumAge(QByteArray cacheControl)
+    {
+        if (cacheControl.contains("no-cache")) {
+            return 0;
+        }
+
+        QRegExp maximumAgeRegExp("max-age\\s*=\\s*(\\d+)");
+        if (maximumAgeRegExp.indexIn(QString::fromLatin1(cacheControl)) >= 0) {
+            return maximumAgeRegExp.cap(1).toInt();
+        }
+        return -1;
+    }
+
+    QString entryFileName(QString key)
+    {
+        return QDir::toNativeSeparators(
+                    cacheDirectory + QDir::separator()
+                    + QString(QCryptographicHash::hash(
+                                  key.toUtf8(), QCryptographicHash::Sha1)
+                              .toHex())
+                    + ".cache");
+    }
+
+    void saveEntry(QString key, CachedResponse *entry)
+    {
+        QFile entryFile(entryFileName(key));
+        if (!entryFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return;
+        }
+
+        QDataStream entryStream(&entryFile);
+        entryStream << key << entry->statusCode << entry->reasonPhrase
+                    << entry->contentType << entry->location
+                    << entry->rawHeaders << entry->body << entry->entityTag
+                    << entry->lastModified << entry->expires
+                    << entry->dependencies;
+    }
+
+    CachedResponse *loadEntry(QString key)
+    {
+        QFile entryFile(entryFileName(key));
+        if (!entryFile.open(QIODevice::ReadOnly)) {
+            return 0;
+        }
+
+        QDataStream entryStream(&entryFile);
+        QString savedKey;
+        entryStream >> savedKey;
+        if (savedKey != key) {
+            return 0;
+        }
+
+        CachedResponse *entry = new CachedResponse;
+        entryStream >> entry->statusCode >> entry->reasonPhrase
+                    >> entry->contentType >> entry->location
+                    >> entry->rawHeaders >> entry->body >> entry->entityTag
+                    >> entry->lastModified >> entry->expires
+                    >> entry->dependencies;
+
+        if (entryStream.status() != QDataStream::Ok) {
+            delete entry;
+            return 0;
+        }
+
+        entries.insert(key, entry, qMax(1, entry->body.size()));
+        return entries.object(key);
+    }
+
+    void removeEntry(QString key)
+    {
+        entries.remove(key);
+        if (persistent == true) {
+            QFile::remove(entryFileName(key));
+        }
+    }
+
+    QCache<QString, CachedResponse> entries;
+    bool enabled;
+    bool persistent;
+    QString cacheDirectory;
+};
+
+// ==============================
+// SCRIPT REPLY CLASS DEFINITION:
+// ==============================
+// Network reply for requests to local scripts.
+// Script output is fed in as it arrives, so WebKit parses and
+// lays out the document progressively, like from a real server, and
+// XMLHttpRequest calls to local scripts receive real responses.
+// Signals are always delivered from the event loop by a render scheduler,
+// so the reply can be written to before WebKit has connected to it.
+class ScriptReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public slots:
+    // Raw body bytes; the CGI header block is already parsed:
+    void writeBodySlot(QByteArray bodyData)
+    {
+        if (isFinished() or replyClosing == true) {
+            return;
+        }
+
+        if (bodyStarted == false) {
+            bodyStarted = true;
+            if (header(QNetworkRequest::ContentTypeHeader)
+                    .toString().contains("text/html")) {
+                outputBuffer.setThemeLink(themeLink);
+            }
+        }
+
+        outputBuffer.append(bodyData);
+
+        if (outputBuffer.size() > 0) {
+            scheduleDelivery();
+        }
+    }
+
+    void finishSlot()
+    {
+        if (isFinished() or replyClosing == true) {
+            return;
+        }
+
+        outputBuffer.flush();
+
+        // The end of the output is delivered without waiting for a frame:
+        replyClosing = true;
+        renderScheduler.flushSoon();
+    }
+
+    // Used when the request is answered without a document,
+    // for example after a kill request:
+    void cancelSlot()
+    {
+        if (isFinished() or replyClosing == true) {
+            return;
+        }
+
+        setError(QNetworkReply::OperationCanceledError,
+                 "Script request cancelled.");
+        replyClosing = true;
+        renderScheduler.flushSoon();
+    }
+
+    void deliverSlot()
+    {
+        if (isFinished()) {
+            return;
+        }
+
+        if (metaDataAnnounced == false and
+                (replyClosing == true or outputBuffer.size() > 0)) {
+            metaDataAnnounced = true;
+            emit metaDataChanged();
+        }
+
+        if (outputBuffer.size() > 0) {
+            emit readyRead();
+        }
+
+        if (replyClosing == true) {
+            setFinished(true);
+            if (error() != QNetworkReply::NoError) {
+                emit error(error());
+            }
+            emit finished();
+        }
+    }
+
+public:
+    ScriptReply(QObject *parent,
+                QNetworkAccessManager::Operation operation,
+                const QNetworkRequest &request);
+
+    // Status, content type, redirection and all other headers
+    // of the script are passed to WebKit:
+    void setResponse(CgiResponseParser *responseParser)
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute,
+                     responseParser->statusCode);
+        setAttribute(QNetworkRequest::HttpReasonPhraseAttribute,
+                     responseParser->reasonPhrase);
+        setHeader(QNetworkRequest::ContentTypeHeader,
+                  responseParser->contentType);
+
+        if (responseParser->location.size() > 0) {
+            setRawHeader("Location", responseParser->location);
+            setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+                         QUrl::fromEncoded(responseParser->location));
+        }
+
+        for (int index = 0; index < responseParser->rawHeaders.size(); index++) {
+            setRawHeader(responseParser->rawHeaders.at(index).first,
+                         responseParser->rawHeaders.at(index).second);
+        }
+    }
+
+    void setCachedResponse(const ScriptResponseCache::CachedResponse &response)
+    {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute,
+                     response.statusCode);
+        setAttribute(QNetworkRequest::HttpReasonPhraseAttribute,
+                     response.reasonPhrase);
+        setHeader(QNetworkRequest::ContentTypeHeader, response.contentType);
+
+        for (int index = 0; index < response.rawHeaders.size(); index++) {
+            setRawHeader(response.rawHeaders.at(index).first,
+                         response.rawHeaders.at(index).second);
+        }
+    }
+
+    // Called by WebKit when the document is no longer needed.
+    // The script itself is not stopped - it is bound by its own deadline.
+    void abort()
+    {
+        if (isFinished()) {
+            return;
+        }
+
+        setError(QNetworkReply::OperationCanceledError,
+                 "Script request aborted.");
+        setFinished(true);
+        emit error(QNetworkReply::OperationCanceledError);
+        emit finished();
+    }
+
+    bool isSequential() const
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return outputBuffer.size() + QIODevice::bytesAvailable();
+    }
+
+    bool isClosing()
+    {
+        return (isFinished() or replyClosing == true);
+    }
+
+    // The request body stays in the device given by WebKit,
+    // which is valid until the reply is finished, and
+    // is streamed to the script instead of being read at once:
+    void setUpload(QIODevice *device, const QNetworkRequest &request)
+    {
+        uploadDevice = device;
+        uploadType = request.header(QNetworkRequest::ContentTypeHeader)
+                .toString();
+
+        if (!request.header(QNetworkRequest::ContentLengthHeader).isNull()) {
+            uploadSize = request.header(QNetworkRequest::ContentLengthHeader)
+                    .toLongLong();
+        } else if (!device->isSequential()) {
+            uploadSize = device->size();
+        } else {
+            uploadSize = -1;
+        }
+    }
+
+    bool hasUpload()
+    {
+        return !uploadDevice.isNull();
+    }
+
+    // Beginning of the request body, which is not consumed:
+    QByteArray uploadPrefix()
+    {
+        if (uploadDevice.isNull()) {
+            return QByteArray();
+        }
+        return uploadDevice->peek(maximumUploadPrefixSize);
+    }
+
+    // Only for scripts receiving their whole input in one message:
+    QByteArray readUpload()
+    {
+        if (uploadDevice.isNull()) {
+            return QByteArray();
+        }
+        return uploadDevice->readAll();
+    }
+
+    QPointer<QIODevice> uploadDevice;
+    QString uploadType;
+    qint64 uploadSize;
+
+    // Stylesheet link inserted after the title of HTML documents:
+    QByteArray themeLink;
+
+    // WebKit is given new output at most once per display frame:
+    RenderScheduler renderScheduler;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        if (outputBuffer.size() == 0) {
+            return (isFinished() or replyClosing == true) ? -1 : 0;
+        }
+
+        return outputBuffer.read(data, maxSize);
+    }
+
+private:
+    static const int maximumUploadPrefixSize = 4096;
+
+    void scheduleDelivery()
+    {
+        renderScheduler.requestUpdate(false);
+    }
+
+    ScriptOutputBuffer outputBuffer;
+    bool bodyStarted;
+    bool metaDataAnnounced;
+    bool replyClosing;
+};
+
+#if ZIP_SUPPORT == 1
+// ==============================
+// PACKAGE REPLY CLASS DEFINITION:
+// ==============================
+// Browser file served from the ZIP package without extracting it.
+// The entry is inflated only when the event loop is reached again,
+// so that WebKit can connect to the reply first.
+class PackageReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public slots:
+    void inflateSlot()
+    {
+        if (isFinished()) {
+            return;
+        }
+
+        bool inflated;
+        fileContents = ZipPackage::instance()->read(fullFilePath, inflated);
+
+        if (inflated == false) {
+            fileContents.clear();
+            setError(QNetworkReply::ContentNotFoundError,
+                     "ZIP package entry could not be inflated.");
+        } else {
+            setHeader(QNetworkRequest::ContentTypeHeader,
+                      contentType(fullFilePath));
+            setHeader(QNetworkRequest::ContentLengthHeader,
+                      fileContents.size());
+        }
+
+        emit metaDataChanged();
+        if (fileContents.size() > 0) {
+            emit readyRead();
+        }
+
+        setFinished(true);
+        if (error() != QNetworkReply::NoError) {
+            emit error(error());
+        }
+        emit finished();
+    }
+
+public:
+    PackageReply(QObject *parent,
+                 const QNetworkRequest &request,
+                 QString packagedFilePath);
+
+    void abort()
+    {
+        if (isFinished()) {
+            return;
+        }
+
+        setError(QNetworkReply::OperationCanceledError,
+                 "Package request aborted.");
+        setFinished(true);
+        emit error(QNetworkReply::OperationCanceledError);
+        emit finished();
+    }
+
+    bool isSequential() const
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return (fileContents.size() - readPosition)
+                + QIODevice::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        if (readPosition >= fileContents.size()) {
+            return isFinished() ? -1 : 0;
+        }
+
+        qint64 bytesToRead = qMin(maxSize,
+                                  (qint64) (fileContents.size()
+                                            - readPosition));
+        memcpy(data, fileContents.constData() + readPosition, bytesToRead);
+        readPosition += bytesToRead;
+
+        return bytesToRead;
+    }
+
+private:
+    static QString contentType(QString filepath)
+    {
+        return FileDetector::instance()->mimeType(
+                    FileDetector::extension(filepath));
+    }
+
+    QString fullFilePath;
+    QByteArray fileContents;
+    qint64 readPosition;
+};
+#endif
+
+// ==============================
+// NETWORK ACCESS MANAGER CLASS DEFINITION:
+// ==============================
+class ModifiedNetworkAccessManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+signals:
+    void startScriptSignal(QUrl url, ScriptReply *reply);
+    void startPerlDebuggerSignal(QUrl debuggerUrl);
+
+protected:
+    virtual QNetworkReply *createRequest(Operation operation,
+                                         const QNetworkRequest &request,
+                                         QIODevice *outgoingData = 0)
+    {
+        // GET requests to local content:
+        if (operation == GetOperation and
+                (QUrl(PSEUDO_DOMAIN)).isParentOf(request.url())) {
+
+            QString filepath = request.url()
+                    .toString(QUrl::RemoveScheme
+                              | QUrl::RemoveAuthority
+                              | QUrl::RemoveQuery
+                              | QUrl::RemoveFragment);
+
+            QString fullFilePath = QDir::toNativeSeparators
+                    ((qApp->property("rootDirName").toString())
+                     + filepath);
+
+            QString fileType = RootIndex::instance()->fileType(fullFilePath);
+
+            // Local HTML, CSS, JS or supported image files:
+            if (fileType.contains("browser")) {
+
+#if ZIP_SUPPORT == 1
+                // Files of the ZIP package, which are not extracted:
+                if (ZipPackage::instance()->isPackaged(fullFilePath)) {
+                    return new PackageReply(this, request, fullFilePath);
+                }
+#endif
+
+                QNetworkRequest networkRequest;
+                networkRequest.setUrl
+                        (QUrl::fromLocalFile
+                         (QDir::toNativeSeparators(
+                              (qApp->property("rootDirName").toString())
+                              + request.url().toString(
+                                  QUrl::RemoveScheme
+                                  | QUrl::RemoveAuthority))));
+
+                return QNetworkAccessManager::createRequest
+                        (QNetworkAccessManager::GetOperation,
+                         QNetworkRequest(networkRequest));
+            }
+
+            // Local Perl scripts:
+            if ((!fileType.contains("undefined")) and
+                    (!fileType.contains("browser"))) {
+
+                ScriptReply *reply = new ScriptReply(this, operation, request);
+                emit startScriptSignal(request.url(), reply);
+                return reply;
+            }
+
+            // Local files without recognized file type:
+            if (fileType.contains("undefined")) {
+
+                qDebug() << "File type not recognized!";
+                qDebug() << "===============";
+
+                QNetworkRequest networkRequest;
+                networkRequest.setUrl
+                        (QUrl::fromLocalFile
+                         ((qApp->property("helpDirectory").toString())
+                          + QDir::separator()
+                          + "notrecognized.htm"));
+
+                return QNetworkAccessManager::createRequest
+                        (QNetworkAccessManager::GetOperation,
+                         QNetworkRequest(networkRequest));
+            }
+        }
+
+        // Take data from a local form using CGI POST method and
+        // execute associated local script:
+        if (operation == PostOperation and
+                (QUrl(PSEUDO_DOMAIN)).isParentOf(request.url())) {
+
+            if (outgoingData) {
+                ScriptReply *reply = new ScriptReply(this, operation, request);
+                reply->setUpload(outgoingData, request);
+                emit startScriptSignal(request.url(), reply);
+                return reply;
+            }
+        }
+
+        if (PERL_DEBUGGER_INTERACTION == 1) {
+            // Perl debugger interaction.
+            // Implementation of an idea proposed by Valcho Nedelchev.
+            // Transmit requests to Perl debugger
+            // in case debugger is started in a new window:
+            if (operation == GetOperation and
+                    request.url().scheme().contains("file") and
+                    request.url().hasQuery()) {
+
+                emit startPerlDebuggerSignal(request.url());
+
+            }
+        }
+
+        // GET, POST and PUT requests to network resources.
+        // Domain filtering happens here:
+        if ((operation == GetOperation or
+             operation == PostOperation or
+             operation == PutOperation) and
+                ((request.url().scheme().contains("file")) or
+                 (request.url().toString().contains(PSEUDO_DOMAIN)) or
+                 ((qApp->property("allowedDomainsList").toStringList())
+                  .contains(request.url().authority())))) {
+
+            qDebug() << "Allowed link:" << request.url().toString();
+            qDebug() << "===============";
+
+#if ZIP_SUPPORT == 1
+            // Local files of the ZIP package loaded by their file path:
+            if (operation == GetOperation and
+                    request.url().scheme() == "file" and
+                    ZipPackage::instance()->isPackaged(
+                        request.url().toLocalFile())) {
+                return new PackageReply(this, request,
+                                        request.url().toLocalFile());
+            }
+#endif
+
+            QNetworkRequest networkRequest;
+            networkRequest.setUrl(request.url());
+
+            return QNetworkAccessManager::createRequest
+                    (QNetworkAccessManager::GetOperation,
+                     QNetworkRequest(networkRequest));
+        } else {
+            qDebug() << "Not allowed link:" << request.url().toString();
+            qDebug() << "===============";
+
+            QNetworkRequest networkRequest;
+            networkRequest.setUrl
+                    (QUrl::fromLocalFile
+                     ((qApp->property("helpDirectory").toString())
+                      + QDir::separator()
+                      + "forbidden.htm"));
+
+            return QNetworkAccessManager::createRequest
+                    (QNetworkAccessManager::GetOperation,
+                     QNetworkRequest(networkRequest));
+        }
+
+        return QNetworkAccessManager::createRequest(operation, request);
+    }
+};
+
+// ==============================
+// CENSOR VERDICT CACHE CLASS DEFINITION:
+// ==============================
+// Verdicts of the script censor for already approved scripts.
+// Every entry is keyed by script path, size, modification time and
+// content hash, so a changed script is censored again.
+// Entries are persisted in the temporary folder of the browser session.
+// Rejected scripts are not cached and are censored on every run.
+class CensorVerdictCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    CensorVerdictCache();
+
+    static CensorVerdictCache *instance()
+    {
+        static CensorVerdictCache *censorVerdictCache =
+                new CensorVerdictCache();
+        return censorVerdictCache;
+    }
+
+    bool isApproved(QString scriptFullFilePath, QByteArray scriptContents)
+    {
+        if (!verdicts.contains(scriptFullFilePath)) {
+            return false;
+        }
+
+        CensorVerdict cachedVerdict = verdicts.value(scriptFullFilePath);
+        QFileInfo scriptFileInfo(scriptFullFilePath);
+
+        // Size and modification time are checked before
+        // the more expensive content hash:
+        if (cachedVerdict.size != scriptContents.size() or
+                cachedVerdict.modified !=
+                scriptFileInfo.lastModified().toTime_t() or
+                cachedVerdict.hash != contentHash(scriptContents)) {
+            removeVerdict(scriptFullFilePath);
+            return false;
+        }
+
+        qDebug() << "Cached censor verdict found:" << scriptFullFilePath;
+
+        return true;
+    }
+
+    void recordApproval(QString scriptFullFilePath, QByteArray scriptContents)
+    {
+        QFileInfo scriptFileInfo(scriptFullFilePath);
+
+        CensorVerdict approvedVerdict;
+        approvedVerdict.size = scriptContents.size();
+        approvedVerdict.modified = scriptFileInfo.lastModified().toTime_t();
+        approvedVerdict.hash = contentHash(scriptContents);
+
+        verdicts.insert(scriptFullFilePath, approvedVerdict);
+
+        QSettings verdictSettings(verdictFileName, QSettings::IniFormat);
+        verdictSettings.beginGroup(QString(QCryptographicHash::hash(
+                                               scriptFullFilePath.toUtf8(),
+                                               QCryptographicHash::Sha1)
+                                           .toHex()));
+        verdictSettings.setValue("path", scriptFullFilePath);
+        verdictSettings.setValue("size", approvedVerdict.size);
+        verdictSettings.setValue("modified", approvedVerdict.modified);
+        verdictSettings.setValue("hash", approvedVerdict.hash);
+        verdictSettings.endGroup();
+
+        qDebug() << "Censor verdict cached:" << scriptFullFilePath;
+    }
+
+private:
+    struct CensorVerdict {
+        qint64 size;
+        uint modified;
+        QByteArray hash;
+    };
+
+    QHash<QString, CensorVerdict> verdicts;
+    QString verdictFileName;
+
+    QByteArray contentHash(QByteArray scriptContents)
+    {
+        return QCryptographicHash::hash(scriptContents,
+                                        QCryptographicHash::Sha1).toHex();
+    }
+
+    void removeVerdict(QString scriptFullFilePath)
+    {
+        verdicts.remove(scriptFullFilePath);
+
+        QSettings verdictSettings(verdictFileName, QSettings::IniFormat);
+        verdictSettings.remove(QString(QCryptographicHash::hash(
+                                           scriptFullFilePath.toUtf8(),
+                                           QCryptographicHash::Sha1)
+                                       .toHex()));
+    }
+};
+
+// ==============================
+// SCRIPT CENSOR CLASS DEFINITION:
+// ==============================
+// Security check of local Perl scripts done before they are started.
+// The source is split into Perl tokens, so comments and POD are never
+// mistaken for code. Code is checked for 'use' statements outside of
+// the allowed pragmas and modules, manipulation of the environment variables
+// set by the browser, calls of 'open' and of the prohibited core functions and
+// string 'eval'. Code run from strings - replacements of 's///e' and
+// blocks interpolated in strings and regular expressions - is checked
+// the same way. The contents of all strings and here-documents are also
+// checked for 'use', 'open' and environment assignments written as code,
+// like the line-based censor.pl did.
+// Approved scripts are started with the prohibited core functions
+// masked by the 'ops' pragma, see opsCommandLineArgument().
+class ScriptCensor : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void censorScript(QString filepath)
+    {
+        approved = false;
+        violations.clear();
+        codeBlocks.clear();
+        stringContents.clear();
+
+        QFile scriptFile(filepath);
+        if (!scriptFile.open(QIODevice::ReadOnly)) {
+            violations.append(qMakePair(0, tr("Script could not be read!")));
+            return;
+        }
+        QByteArray scriptContents = scriptFile.readAll();
+        scriptFile.close();
+
+        if (CensorVerdictCache::instance()
+                ->isApproved(filepath, scriptContents)) {
+            approved = true;
+            return;
+        }
+
+        QString source = QString::fromUtf8(scriptContents);
+        sourceLines = source.split("\n");
+
+        tokenize(source, 1);
+        checkTokens();
+
+        // Checking code blocks can find more nested code and strings:
+        while (!codeBlocks.isEmpty()) {
+            QPair<int, QString> codeBlock = codeBlocks.takeFirst();
+            tokenize(codeBlock.second, codeBlock.first);
+            checkTokens();
+        }
+        checkStrings();
+
+        approved = violations.isEmpty();
+
+        qDebug() << "Script censored:" << filepath;
+        qDebug() << "===============";
+
+        tokens.clear();
+        stringContents.clear();
+
+        if (approved == true) {
+            CensorVerdictCache::instance()
+                    ->recordApproval(filepath, scriptContents);
+        }
+    }
+
+public:
+    ScriptCensor();
+
+    bool approved;
+
+    // Scripts listed as FastCGI responders may also use
+    // the modules of the FastCGI protocol.
+    // Must be called before censorScript():
+    void allowResponderModules()
+    {
+        allowedModules << responderModules;
+    }
+
+    // The prohibited core functions are masked for the whole interpreter,
+    // including modules loaded at runtime and strings given to 'eval':
+    QString opsCommandLineArgument()
+    {
+        return "-M-ops=" + prohibitedCoreFunctions.join(",");
+    }
+
+    QString prohibitedCoreFunctionList()
+    {
+        return prohibitedCoreFunctions.join(",");
+    }
+
+    QString violationsHtml()
+    {
+        QString html;
+        html.append("<html>\n\n<head>\n");
+        html.append("<title>Perl Executing Browser - Errors</title>\n");
+        html.append("<meta http-equiv='Content-Type' ");
+        html.append("content='text/html; charset=utf-8'>\n");
+        html.append("<style type='text/css'>body {text-align: left}</style>\n");
+        html.append("</head>\n\n<body>\n");
+        html.append("<p align='center'><font size='5' face='SansSerif'>");
+        html.append(tr("Script execution was not attempted due to security violations:"));
+        html.append("</font></p>\n");
+
+        for (int index = 0; index < violations.size(); index++) {
+            int lineNumber = violations.at(index).first;
+            html.append("<pre>");
+            if (lineNumber > 0 and lineNumber <= sourceLines.size()) {
+                QString line = sourceLines.at(lineNumber - 1);
+                line.replace("&", "&amp;");
+                line.replace("<", "&lt;");
+                line.replace(">", "&gt;");
+                html.append(tr("Line ") + QString::number(lineNumber) + ": ");
+                html.append(line + "\n");
+            }
+            html.append(violations.at(index).second);
+            html.append("</pre>\n");
+        }
+
+        html.append("</body>\n\n</html>\n");
+
+        return html;
+    }
+
+private:
+    enum TokenType {
+        WordToken,
+        VariableToken,
+        StringToken,
+        NumberToken,
+        OperatorToken
+    };
+
+    struct PerlToken {
+        TokenType type;
+        QString text;
+        int line;
+    };
+
+    QStringList allowedUsePragmas;
+    QStringList allowedModules;
+    QStringList responderModules;
+    QStringList prohibitedCoreFunctions;
+    QStringList protectedEnvironmentVariables;
+    QStringList quoteLikeOperators;
+    QStringList multiCharacterOperators;
+
+    QList<PerlToken> tokens;
+    QStringList sourceLines;
+    QList<QPair<int, QString> > violations;
+
+    // Line and contents of code found in strings and of all strings:
+    QList<QPair<int, QString> > codeBlocks;
+    QList<QPair<int, QString> > stringContents;
+
+    void tokenize(const QString &source, int firstLine)
+    {
+        tokens.clear();
+
+        int length = source.length();
+        int position = 0;
+        int line = firstLine;
+        bool lineStart = true;
+        bool expectTerm = true;
+        QStringList pendingHeredocs;
+        QList<bool> pendingHeredocsIndented;
+        QList<bool> pendingHeredocsInterpolating;
+        QString heredocBody;
+        int heredocLine = line;
+
+        while (position < length) {
+            if (lineStart == true) {
+                lineStart = false;
+
+                // Bodies of here-documents started on the previous line:
+                while (!pendingHeredocs.isEmpty() and position < length) {
+                    int lineEnd = source.indexOf('\n', position);
+                    if (lineEnd < 0) {
+                        lineEnd = length;
+                    }
+                    QString bodyLine =
+                            source.mid(position, lineEnd - position);
+                    if (bodyLine.endsWith('\r')) {
+                        bodyLine.chop(1);
+                    }
+                    if (heredocBody.isEmpty()) {
+                        heredocLine = line;
+                    }
+                    position = lineEnd + 1;
+                    line++;
+                    if ((pendingHeredocsIndented.first() == true ?
+                         bodyLine.trimmed() : bodyLine)
+                            == pendingHeredocs.first()) {
+                        addStringContents(heredocLine, heredocBody,
+                                          pendingHeredocsInterpolating.first());
+                        heredocBody.clear();
+                        pendingHeredocs.removeFirst();
+                        pendingHeredocsIndented.removeFirst();
+                        pendingHeredocsInterpolating.removeFirst();
+                    } else {
+                        heredocBody.append(bodyLine + "\n");
+                    }
+                }
+
+                if (position >= length) {
+                    break;
+                }
+
+                // POD is skipped up to and including the '=cut' line:
+                if (source.at(position) == '=' and position + 1 < length and
+                        source.at(position + 1).isLetter()) {
+                    while (position < length) {
+                        int lineEnd = source.indexOf('\n', position);
+                        if (lineEnd < 0) {
+                            lineEnd = length;
+                        }
+                        bool podEnd = (source.midRef(position, 4)
+                                       == QLatin1String("=cut"));
+                        position = lineEnd + 1;
+                        line++;
+                        if (podEnd == true) {
+                            break;
+                        }
+                    }
+                    lineStart = true;
+                    continue;
+                }
+            }
+
+            QChar character = source.at(position);
+
+            if (character == '\n') {
+                position++;
+                line++;
+                lineStart = true;
+                continue;
+            }
+
+            if (character.isSpace()) {
+                position++;
+                continue;
+            }
+
+            if (character == '#') {
+                while (position < length and source.at(position) != '\n') {
+                    position++;
+                }
+                continue;
+            }
+
+            PerlToken token;
+            token.line = line;
+            int tokenStart = position;
+
+            if (character.isLetter() or character == '_') {
+                position = wordEnd(source, position);
+                token.type = WordToken;
+                token.text = source.mid(tokenStart, position - tokenStart);
+
+                if (token.text == "__END__" or token.text == "__DATA__") {
+                    break;
+                }
+
+                if (quoteLikeOperators.contains(token.text) and
+                        quoteLikeFollows(source, position)) {
+                    QString quoteLikeOperator = token.text;
+
+                    position = skipSpace(source, position, line);
+                    QChar delimiter = source.at(position);
+                    int contentLine = line;
+                    token.type = StringToken;
+                    token.text = readDelimited(source, position, line);
+
+                    // Substitution and transliteration have two parts:
+                    QString replacement;
+                    int replacementLine = line;
+                    if (quoteLikeOperator == "s" or
+                            quoteLikeOperator == "tr" or
+                            quoteLikeOperator == "y") {
+                        if (delimiter == '(' or delimiter == '[' or
+                                delimiter == '{' or delimiter == '<') {
+                            position = skipSpace(source, position, line);
+                        } else {
+                            position--;
+                        }
+                        if (position < length) {
+                            replacementLine = line;
+                            replacement = readDelimited(source, position, line);
+                        }
+                    }
+
+                    int modifiersStart = position;
+                    while (position < length and
+                           source.at(position).isLetter()) {
+                        position++;
+                    }
+                    QString modifiers =
+                            source.mid(modifiersStart, position - modifiersStart);
+
+                    if (quoteLikeOperator != "qw" and
+                            quoteLikeOperator != "tr" and
+                            quoteLikeOperator != "y") {
+                        addStringContents(contentLine, token.text,
+                                          (quoteLikeOperator != "q" and
+                                           delimiter != '\''));
+                    }
+
+                    // The replacement of 's///e' is code and
+                    // 's///ee' evaluates the result of that code as a string:
+                    if (quoteLikeOperator == "s") {
+                        if (modifiers.count('e') > 1) {
+                            addViolation(replacementLine,
+                                         tr("Forbidden string 'eval' detected!"));
+                        } else if (modifiers.count('e') == 1) {
+                            codeBlocks.append(qMakePair(replacementLine,
+                                                        replacement));
+                        } else {
+                            addStringContents(replacementLine, replacement,
+                                              delimiter != '\'');
+                        }
+                    }
+                }
+            } else if (character.isDigit()) {
+                while (position < length and
+                       (source.at(position).isLetterOrNumber() or
+                        source.at(position) == '_' or
+                        (source.at(position) == '.' and
+                         position + 1 < length and
+                         source.at(position + 1).isDigit()))) {
+                    position++;
+                }
+                token.type = NumberToken;
+                token.text = source.mid(tokenStart, position - tokenStart);
+            } else if (character == '$' or character == '@' or
+                       ((character == '%' or character == '&') and
+                        expectTerm == true and position + 1 < length and
+                        (source.at(position + 1).isLetter() or
+                         source.at(position + 1) == '_' or
+                         source.at(position + 1) == '$' or
+                         source.at(position + 1) == '{' or
+                         source.at(position + 1) == ':'))) {
+                position++;
+                if (character == '$' and position < length and
+                        source.at(position) == '#') {
+                    position++;
+                }
+                if (position < length) {
+                    QChar nameStart = source.at(position);
+                    if (nameStart.isLetter() or nameStart == '_' or
+                            nameStart == ':') {
+                        position = wordEnd(source, position);
+                    } else if (nameStart.isDigit()) {
+                        while (position < length and
+                               source.at(position).isDigit()) {
+                            position++;
+                        }
+                    } else if (character == '$' and !nameStart.isSpace() and
+                               nameStart != '{') {
+                        // Punctuation variables like '$$', '$@' or '$/':
+                        position++;
+                    }
+                }
+                token.type = VariableToken;
+                token.text = source.mid(tokenStart, position - tokenStart);
+            } else if (character == '\'' or character == '"' or
+                       character == '`' or
+                       (character == '/' and expectTerm == true)) {
+                token.type = StringToken;
+                token.text = readDelimited(source, position, line);
+                addStringContents(token.line, token.text, character != '\'');
+                if (character == '/') {
+                    while (position < length and
+                           source.at(position).isLetter()) {
+                        position++;
+                    }
+                }
+            } else if (character == '<' and expectTerm == true and
+                       heredocFollows(source, position)) {
+                position += 2;
+                bool indented = false;
+                if (source.at(position) == '~') {
+                    indented = true;
+                    position++;
+                }
+                QString terminator;
+                bool interpolating = (source.at(position) != '\'');
+                if (source.at(position) == '"' or source.at(position) == '\'') {
+                    terminator = readDelimited(source, position, line);
+                } else {
+                    int terminatorStart = position;
+                    position = wordEnd(source, position);
+                    terminator = source.mid(terminatorStart,
+                                            position - terminatorStart);
+                }
+                pendingHeredocs.append(terminator);
+                pendingHeredocsIndented.append(indented);
+                pendingHeredocsInterpolating.append(interpolating);
+                token.type = StringToken;
+            } else if (character == '<' and expectTerm == true and
+                       QRegExp("<\\$?\\w*>").indexIn(
+                           source.mid(position, 256)) == 0) {
+                // Reading from a filehandle like '<STDIN>' or '<$input>':
+                position = source.indexOf('>', position) + 1;
+                token.type = StringToken;
+                token.text = source.mid(tokenStart, position - tokenStart);
+            } else {
+                token.type = OperatorToken;
+                token.text = character;
+                foreach (QString perlOperator, multiCharacterOperators) {
+                    if (source.midRef(position, perlOperator.length())
+                            == perlOperator) {
+                        token.text = perlOperator;
+                        break;
+                    }
+                }
+                position += token.text.length();
+            }
+
+            tokens.append(token);
+
+            // A slash after a term is a division, otherwise
+            // it starts a regular expression:
+            if (token.type == OperatorToken) {
+                expectTerm = !(token.text == ")" or token.text == "]" or
+                               token.text == "}");
+            } else {
+                expectTerm = (token.type == WordToken);
+            }
+        }
+    }
+
+    void checkTokens()
+    {
+        for (int index = 0; index < tokens.size(); index++) {
+            PerlToken token = tokens.at(index);
+
+            if (token.type == VariableToken and token.text == "$ENV") {
+                if (index + 4 < tokens.size() and
+                        tokenIs(index + 1, OperatorToken, "{") and
+                        (tokens.at(index + 2).type == StringToken or
+                         tokens.at(index + 2).type == WordToken) and
+                        protectedEnvironmentVariables
+                        .contains(tokens.at(index + 2).text) and
+                        tokenIs(index + 3, OperatorToken, "}") and
+                        assignmentOperator(tokens.at(index + 4))) {
+                    addViolation(token.line,
+                                 tr("Forbidden manipulation of '%1' environment variable detected!")
+                                 .arg(tokens.at(index + 2).text));
+                }
+                continue;
+            }
+
+            if (token.type != WordToken or !functionCall(index)) {
+                continue;
+            }
+
+            QString name = token.text;
+            if (name.startsWith("CORE::")) {
+                name = name.mid(6);
+            }
+
+            // Only the block form of 'eval' is allowed:
+            if (name == "eval") {
+                if (!tokenIs(index + 1, OperatorToken, "{")) {
+                    addViolation(token.line,
+                                 tr("Forbidden string 'eval' detected!"));
+                }
+                continue;
+            }
+
+            if (name == "use") {
+                if (index + 1 >= tokens.size()) {
+                    continue;
+                }
+                PerlToken moduleToken = tokens.at(index + 1);
+                if (moduleToken.type == NumberToken or
+                        (moduleToken.type == WordToken and
+                         QRegExp("v\\d+").exactMatch(moduleToken.text))) {
+                    continue;
+                }
+                if (moduleToken.type == WordToken and
+                        (allowedUsePragmas.contains(moduleToken.text) or
+                         allowedModules.contains(moduleToken.text))) {
+                    continue;
+                }
+                addViolation(token.line,
+                             tr("Forbidden 'use' pragma or unauthorized module detected!"));
+                continue;
+            }
+
+            if (name == "open") {
+                if (!documentRootOpen(index)) {
+                    addViolation(token.line,
+                                 tr("Forbidden use of 'open' function detected!"));
+                }
+                continue;
+            }
+
+            if (prohibitedCoreFunctions.contains(name)) {
+                addViolation(token.line,
+                             tr("Forbidden use of '%1' function detected!")
+                             .arg(name));
+            }
+        }
+    }
+
+    // Strings are checked for 'use' and 'open' statements and
+    // environment assignments as censor.pl checked every line.
+    // Only text written like code is reported, so that
+    // messages like "Could not open the file" are still allowed:
+    void checkStrings()
+    {
+        QRegExp useExpression("\\buse\\s+([A-Za-z_][\\w:]*)\\s*(;|\\(|qw\\b)");
+        QRegExp openExpression("\\bopen\\s*\\(?\\s*"
+                               "(my\\b|our\\b|local\\b|[$*]|[A-Z_][A-Z0-9_]*\\s*,)");
+        QRegExp documentRootOpenExpression(
+                    "\\bopen\\s*\\(?\\s*my \\$\\w+\\s*,\\s*'<'\\s*,\\s*"
+                    "\"\\$ENV\\{'DOCUMENT_ROOT'\\}");
+        QRegExp environmentExpression(
+                    "\\$ENV\\{\\s*['\"]?(" + protectedEnvironmentVariables.join("|")
+                    + ")['\"]?\\s*\\}\\s*([.x|&^+*/%-]|\\*\\*|\\|\\||&&|//|<<|>>)?=(?![=~])");
+
+        for (int index = 0; index < stringContents.size(); index++) {
+            int line = stringContents.at(index).first;
+            QString contents = stringContents.at(index).second;
+
+            int position = 0;
+            while ((position = useExpression.indexIn(contents, position)) >= 0) {
+                QString moduleName = useExpression.cap(1);
+                if (!allowedUsePragmas.contains(moduleName) and
+                        !allowedModules.contains(moduleName)) {
+                    addViolation(line + contents.left(position).count('\n'),
+                                 tr("Forbidden 'use' pragma or unauthorized module detected!"));
+                }
+                position += useExpression.matchedLength();
+            }
+
+            position = 0;
+            while ((position = openExpression.indexIn(contents, position)) >= 0) {
+                if (documentRootOpenExpression.indexIn(contents, position)
+                        != position) {
+                    addViolation(line + contents.left(position).count('\n'),
+                                 tr("Forbidden use of 'open' function detected!"));
+                }
+                position += openExpression.matchedLength();
+            }
+
+            position = 0;
+            while ((position = environmentExpression.indexIn(contents, position))
+                   >= 0) {
+                addViolation(line + contents.left(position).count('\n'),
+                             tr("Forbidden manipulation of '%1' environment variable detected!")
+                             .arg(environmentExpression.cap(1)));
+                position += environmentExpression.matchedLength();
+            }
+        }
+    }
+
+    // Interpolation runs code in blocks like '@{[ ... ]}' or '${\ ... }',
+    // in subscripts of interpolated variables and
+    // in regular expression blocks like '(?{ ... })':
+    void addStringContents(int line, QString contents, bool interpolating)
+    {
+        stringContents.append(qMakePair(line, contents));
+
+        if (interpolating == false) {
+            return;
+        }
+
+        int length = contents.length();
+        int position = 0;
+        int blockLine = line;
+        while (position < length) {
+            QChar character = contents.at(position);
+
+            if (character == '\\') {
+                if (position + 1 < length and contents.at(position + 1) == '\n') {
+                    blockLine++;
+                }
+                position += 2;
+                continue;
+            }
+
+            if (character == '\n') {
+                blockLine++;
+                position++;
+                continue;
+            }
+
+            if (contents.midRef(position, 3) == QLatin1String("(?{") or
+                    contents.midRef(position, 4) == QLatin1String("(??{")) {
+                position = contents.indexOf('{', position);
+                addCodeBlock(contents, position, blockLine);
+                continue;
+            }
+
+            if ((character == '$' or character == '@') and
+                    position + 1 < length) {
+                position++;
+                if (contents.at(position) == '{') {
+                    addCodeBlock(contents, position, blockLine);
+                } else {
+                    position = wordEnd(contents, position);
+                }
+
+                // Chained subscripts like '$data{...}[...]' or '$data->{...}':
+                while (position < length) {
+                    if (contents.midRef(position, 2) == QLatin1String("->") and
+                            position + 2 < length and
+                            (contents.at(position + 2) == '{' or
+                             contents.at(position + 2) == '[')) {
+                        position += 2;
+                    }
+                    if (contents.at(position) != '{' and
+                            contents.at(position) != '[') {
+                        break;
+                    }
+                    addCodeBlock(contents, position, blockLine);
+                }
+                continue;
+            }
+
+            position++;
+        }
+    }
+
+    // The block is kept with its brackets, so that
+    // hash keys are still recognized as hash keys:
+    void addCodeBlock(const QString &contents, int &position, int &line)
+    {
+        int blockStart = position;
+        int blockLine = line;
+        readDelimited(contents, position, line);
+        codeBlocks.append(qMakePair(blockLine,
+                                    contents.mid(blockStart,
+                                                 position - blockStart)));
+    }
+
+    // Method calls, hash keys, names of subroutines and
+    // arguments of 'use' or 'no' are not calls of core functions:
+    bool functionCall(int index)
+    {
+        if (index > 0) {
+            PerlToken previousToken = tokens.at(index - 1);
+            if (previousToken.type == OperatorToken and
+                    previousToken.text == "->") {
+                return false;
+            }
+            if (previousToken.type == WordToken and
+                    (previousToken.text == "sub" or
+                     previousToken.text == "use" or
+                     previousToken.text == "no")) {
+                return false;
+            }
+            if (tokenIs(index - 1, OperatorToken, "{") and
+                    tokenIs(index + 1, OperatorToken, "}")) {
+                return false;
+            }
+        }
+
+        if (tokenIs(index + 1, OperatorToken, "=>")) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // The only allowed 'open' is reading a file from the document root:
+    // open my $filehandle, '<', "$ENV{'DOCUMENT_ROOT'}$relative_filepath"
+    bool documentRootOpen(int index)
+    {
+        int next = index + 1;
+        if (tokenIs(next, OperatorToken, "(")) {
+            next++;
+        }
+
+        return (tokenIs(next, WordToken, "my") and
+                next + 5 < tokens.size() and
+                tokens.at(next + 1).type == VariableToken and
+                tokenIs(next + 2, OperatorToken, ",") and
+                tokenIs(next + 3, StringToken, "<") and
+                tokenIs(next + 4, OperatorToken, ",") and
+                tokens.at(next + 5).type == StringToken and
+                tokens.at(next + 5).text
+                .startsWith("$ENV{'DOCUMENT_ROOT'}"));
+    }
+
+    bool tokenIs(int index, TokenType type, QString text)
+    {
+        return (index >= 0 and index < tokens.size() and
+                tokens.at(index).type == type and
+                tokens.at(index).text == text);
+    }
+
+    bool assignmentOperator(PerlToken token)
+    {
+        return (token.type == OperatorToken and token.text.endsWith("=") and
+                token.text != "==" and token.text != "!=" and
+                token.text != "<=" and token.text != ">=");
+    }
+
+    void addViolation(int line, QString explanation)
+    {
+        QPair<int, QString> violation = qMakePair(line, explanation);
+        if (!violations.contains(violation)) {
+            violations.append(violation);
+        }
+    }
+
+    int wordEnd(const QString &source, int position)
+    {
+        while (position < source.length()) {
+            QChar character = source.at(position);
+            if (character.isLetterOrNumber() or character == '_') {
+                position++;
+            } else if (character == ':' and position + 1 < source.length()
+                       and source.at(position + 1) == ':') {
+                position += 2;
+            } else {
+                break;
+            }
+        }
+        return position;
+    }
+
+    int skipSpace(const QString &source, int position, int &line)
+    {
+        while (position < source.length() and source.at(position).isSpace()) {
+            if (source.at(position) == '\n') {
+                line++;
+            }
+            position++;
+        }
+        return position;
+    }
+
+    // Hash keys, fat commas, method names and file tests like '-s'
+    // are not quote-like operators:
+    bool quoteLikeFollows(const QString &source, int position)
+    {
+        if (!tokens.isEmpty() and tokens.last().type == OperatorToken and
+                (tokens.last().text == "->" or tokens.last().text == "-")) {
+            return false;
+        }
+
+        bool spaceSkipped = false;
+        while (position < source.length() and source.at(position).isSpace()) {
+            position++;
+            spaceSkipped = true;
+        }
+
+        if (position >= source.length()) {
+            return false;
+        }
+
+        QChar delimiter = source.at(position);
+        if (delimiter.isLetterOrNumber() or delimiter == '_' or
+                delimiter == ',' or delimiter == ';' or delimiter == ')' or
+                delimiter == '}' or delimiter == '=') {
+            return false;
+        }
+        if (delimiter == '#' and spaceSkipped == true) {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool heredocFollows(const QString &source, int position)
+    {
+        if (source.midRef(position, 2) != QLatin1String("<<")) {
+            return false;
+        }
+        position += 2;
+        if (position < source.length() and source.at(position) == '~') {
+            position++;
+        }
+        if (position >= source.length()) {
+            return false;
+        }
+        QChar terminatorStart = source.at(position);
+        return (terminatorStart == '"' or terminatorStart == '\'' or
+                terminatorStart.isLetter() or terminatorStart == '_');
+    }
+
+    // Returns the contents between the delimiter at the current position and
+    // its closing pair and leaves the position after the closing delimiter:
+    QString readDelimited(const QString &source, int &position, int &line)
+    {
+        QChar openingDelimiter = source.at(position);
+        QChar closingDelimiter = openingDelimiter;
+        if (openingDelimiter == '(') {
+            closingDelimiter = ')';
+        } else if (openingDelimiter == '[') {
+            closingDelimiter = ']';
+        } else if (openingDelimiter == '{') {
+            closingDelimiter = '}';
+        } else if (openingDelimiter == '<') {
+            closingDelimiter = '>';
+        }
+
+        int depth = 1;
+        position++;
+        int contentStart = position;
+
+        while (position < source.length()) {
+            QChar character = source.at(position);
+            if (character == '\\') {
+                if (position + 1 < source.length() and
+                        source.at(position + 1) == '\n') {
+                    line++;
+                }
+                position += 2;
+                continue;
+            }
+            if (character == '\n') {
+                line++;
+            }
+            if (openingDelimiter != closingDelimiter and
+                    character == openingDelimiter) {
+                depth++;
+            } else if (character == closingDelimiter) {
+                depth--;
+                if (depth == 0) {
+                    break;
+                }
+            }
+            position++;
+        }
+
+        QString content = source.mid(contentStart, position - contentStart);
+        position++;
+
+        return content;
+    }
+};
+
+// ==============================
+// SINGLE-PRODUCER/SINGLE-CONSUMER RING BUFFER DEFINITION:
+// ==============================
+// Lock-free hand-off between exactly one producer thread and
+// exactly one consumer thread. Capacity must be a power of two.
+// Indexes only grow and are masked, so a full and an empty buffer
+// are never confused. Ordered atomic operations are used
+// for loads and stores alike, so the buffer works with Qt4 and Qt5.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(int capacity)
+        : entries(capacity), mask(capacity - 1)
+    {
+    }
+
+    // Producer thread only:
+    bool push(const T &entry)
+    {
+        unsigned int write = (unsigned int) writeIndex.fetchAndAddOrdered(0);
+        unsigned int read = (unsigned int) readIndex.fetchAndAddOrdered(0);
+        if (write - read > (unsigned int) mask) {
+            return false;
+        }
+
+        entries[write & mask] = entry;
+        writeIndex.fetchAndStoreOrdered((int) (write + 1));
+        return true;
+    }
+
+    // Consumer thread only:
+    bool pop(T &entry)
+    {
+        unsigned int read = (unsigned int) readIndex.fetchAndAddOrdered(0);
+        unsigned int write = (unsigned int) writeIndex.fetchAndAddOrdered(0);
+        if (read == write) {
+            return false;
+        }
+
+        entry = entries[read & mask];
+        // Shared data is released by the consumer:
+        entries[read & mask] = T();
+        readIndex.fetchAndStoreOrdered((int) (read + 1));
+        return true;
+    }
+
+    // Producer thread only.
+    // The consumer may free more slots at any time:
+    int freeSlots()
+    {
+        unsigned int write = (unsigned int) writeIndex.fetchAndAddOrdered(0);
+        unsigned int read = (unsigned int) readIndex.fetchAndAddOrdered(0);
+        return (int) ((unsigned int) mask + 1 - (write - read));
+    }
+
+private:
+    QVector<T> entries;
+    int mask;
+    QAtomicInt writeIndex;
+    QAtomicInt readIndex;
+};
+
+// ==============================
+// SCRIPT PIPE CHUNK DEFINITION:
+// ==============================
+struct ScriptPipeChunk
+{
+    enum Channel {
+        OutputChannel,
+        ErrorChannel,
+        FinishedChannel
+    };
+
+    ScriptPipeChunk()
+    {
+        channel = OutputChannel;
+        headersComplete = false;
+    }
+
+    ScriptPipeChunk(Channel channel, QByteArray data)
+    {
+        this->channel = channel;
+        this->data = data;
+        headersComplete = false;
+    }
+
+    Channel channel;
+
+    // Raw output - only the body of the response for standard output:
+    QByteArray data;
+
+    // Output decoded for display or for the log:
+    QString text;
+
+    // The header block of the response ends before this chunk:
+    bool headersComplete;
+};
+
+// ==============================
+// SCRIPT I/O THREAD CLASS DEFINITION:
+// ==============================
+// Background thread servicing the pipes of all script processes and
+// the sockets of all script requests.
+// Its event loop is the native event dispatcher of Qt -
+// poll() based on Linux and Mac OS X - and the GUI thread only
+// receives finished chunks of output.
+class ScriptIoThread : public QThread
+{
+    Q_OBJECT
+
+public slots:
+    void stopSlot()
+    {
+        quit();
+        wait();
+    }
+
+public:
+    ScriptIoThread();
+
+    static ScriptIoThread *instance()
+    {
+        static ScriptIoThread *scriptIoThread = new ScriptIoThread();
+        return scriptIoThread;
+    }
+};
+
+// ==============================
+// SCRIPT PIPE WORKER CLASS DEFINITION:
+// ==============================
+// Base of all objects reading the output of one script inside
+// the I/O thread - script processes and script requests alike.
+// The CGI header block is parsed and text is decoded here too, so
+// output is handed to the consumer in the GUI thread ready for use
+// through a ring buffer. The consumer is notified by a single queued call
+// of its 'drainSlot()' only when it is not already due to drain the buffer.
+// A worker filling the buffer up to its reserved slots pauses:
+// it stops reading its pipes or socket, so unread output stays in
+// the kernel and a script writing faster than it is displayed
+// is blocked in write(). The consumer resumes the worker
+// when it has drained the buffer.
+// The reserved slots take the few chunks a paused worker
+// may still hand over: an error message, output held back
+// by the header parser and the end of the script.
+class ScriptPipeWorker : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    virtual void startSlot() = 0;
+    virtual void abortSlot() = 0;
+
+    // One chunk of STDIN at a time, acknowledged by a queued call of
+    // 'uploadWrittenSlot()' of the consumer, when it is written:
+    virtual void writeInputSlot(QByteArray inputData) = 0;
+    virtual void closeInputSlot() = 0;
+
+    void resumeSlot()
+    {
+        if (pauseState.fetchAndStoreOrdered(Reading) != Reading) {
+            resumeReading();
+        }
+    }
+
+public:
+    ScriptPipeWorker(QObject *consumer);
+
+    // Consumer thread only.
+    // Must be called before the consumer drains the ring buffer:
+    void acknowledgeNotification()
+    {
+        notificationPending.fetchAndStoreOrdered(0);
+    }
+
+    // Consumer thread only.
+    // Called after the ring buffer is drained, true once for every pause:
+    bool takeResumeRequest()
+    {
+        return pauseState.testAndSetOrdered(Paused, ResumeRequested);
+    }
+
+    SpscRingBuffer<ScriptPipeChunk> ringBuffer;
+
+    // Set by the consumer before the worker is started:
+    // HTML bodies are decoded only for the 'latest' output mode.
+    bool htmlTextOutput;
+
+    // Used by the worker until a chunk with complete headers
+    // is handed over and only read by the consumer after that:
+    CgiResponseParser responseParser;
+
+protected:
+    // Reading starts again after a pause:
+    virtual void resumeReading() = 0;
+
+    bool isPaused()
+    {
+        return (pauseState.fetchAndAddOrdered(0) != Reading);
+    }
+
+    // Output without a complete header block is flushed
+    // before the end of the script:
+    void handOver(ScriptPipeChunk chunk)
+    {
+        if (chunk.channel == ScriptPipeChunk::OutputChannel) {
+            if (chunk.data.length() == 0) {
+                return;
+            }
+            outputReceived = true;
+            push(outputChunk(responseParser.parse(chunk.data)));
+        } else if (chunk.channel == ScriptPipeChunk::ErrorChannel) {
+            if (chunk.data.length() == 0) {
+                return;
+            }
+            chunk.text = errorDecoder.decode(chunk.data);
+            push(chunk);
+        } else {
+            if (outputReceived == true and headersHandedOver == false) {
+                push(outputChunk(responseParser.finish()));
+            }
+            push(chunk);
+        }
+    }
+
+    void notifyConsumer()
+    {
+        if (notificationPending.testAndSetOrdered(0, 1)) {
+            QMetaObject::invokeMethod(consumer, "drainSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    QObject *consumer;
+
+    // Largest piece of output read at once:
+    static const int readChunkSize = 65536;
+
+private:
+    enum PauseState {
+        Reading,
+        Paused,
+        ResumeRequested
+    };
+
+    // Chunks with nothing in them are not handed over, but
+    // the chunk completing the headers always is:
+    ScriptPipeChunk outputChunk(QByteArray body)
+    {
+        ScriptPipeChunk chunk(ScriptPipeChunk::OutputChannel, body);
+        if (responseParser.headersComplete == true and
+                headersHandedOver == false) {
+            headersHandedOver = true;
+            chunk.headersComplete = true;
+        }
+        if (htmlTextOutput == true and body.length() > 0 and
+                responseParser.isHtml()) {
+            chunk.text = decodeOutput(body);
+        }
+        return chunk;
+    }
+
+    // Output in other character sets is decoded by Qt,
+    // with the state also carried between chunks:
+    QString decodeOutput(QByteArray body)
+    {
+        if (responseParser.isUtf8()) {
+            return outputDecoder.decode(body);
+        }
+
+        if (charsetDecoder.isNull()) {
+            QTextCodec *codec =
+                    QTextCodec::codecForName(responseParser.charset());
+            if (codec == 0) {
+                return outputDecoder.decode(body);
+            }
+            charsetDecoder.reset(codec->makeDecoder());
+        }
+        return charsetDecoder->toUnicode(body);
+    }
+
+    void push(ScriptPipeChunk chunk)
+    {
+        if (chunk.channel == ScriptPipeChunk::OutputChannel and
+                chunk.data.length() == 0 and chunk.headersComplete == false) {
+            return;
+        }
+
+        // The pause is visible before the chunk, so
+        // the drain this chunk is pushed for sees it:
+        if (ringBuffer.freeSlots() <= reservedSlots + 1) {
+            pauseState.testAndSetOrdered(Reading, Paused);
+        }
+
+        if (ringBuffer.push(chunk)) {
+            notifyConsumer();
+        } else {
+            qDebug() << "Script output lost, the ring buffer is full.";
+            qDebug() << "===============";
+        }
+    }
+
+    Utf8StreamDecoder outputDecoder;
+    Utf8StreamDecoder errorDecoder;
+    QScopedPointer<QTextDecoder> charsetDecoder;
+    bool outputReceived;
+    bool headersHandedOver;
+    QAtomicInt notificationPending;
+    QAtomicInt pauseState;
+
+    static const int reservedSlots = 4;
+};
+
+// ==============================
+// SCRIPT REQUEST CLASS DEFINITION:
+// ==============================
+// Common interface of scripts served by resident Perl processes
+// (FastCGI responders and the fork-server) instead of a new QProcess.
+// Requests are moved to the I/O thread before they are started, so
+// their sockets are read and their records are parsed there.
+// A finished request stays until its consumer deletes it.
+class ScriptRequest : public ScriptPipeWorker
+{
+    Q_OBJECT
+
+public:
+    ScriptRequest(QObject *consumer);
+
+    QString executionMode;
+};
+
+// ==============================
+// FASTCGI REQUEST CLASS DEFINITION:
+// ==============================
+// One request to a persistent FastCGI responder.
+// Every request has its own local socket connection and request ID,
+// so several requests can be in flight to the same responder.
+// The perl FCGI library accepts connections one after another, and
+// requests that arrive while the responder is busy wait in the queue
+// of the listening socket.
+class FastCgiRequest : public ScriptRequest
+{
+    Q_OBJECT
+
+public slots:
+    void startSlot()
+    {
+        connectSlot();
+    }
+
+    void connectSlot()
+    {
+        connectionAttempts++;
+        socket->connectToServer(socketName);
+    }
+
+    void connectedSlot()
+    {
+        connectedOnce = true;
+
+        // FCGI_BEGIN_REQUEST:
+        // responder role, flags are zero, so
+        // the connection is closed after the request.
+        QByteArray beginRequestBody;
+        beginRequestBody.append(char(0));
+        beginRequestBody.append(char(ResponderRole));
+        beginRequestBody.append(QByteArray(6, char(0)));
+        writeRecord(BeginRequestRecord, beginRequestBody);
+
+        QByteArray paramsBody;
+        foreach (QString name, params.keys()) {
+            appendNameValuePair(paramsBody,
+                                name.toUtf8(),
+                                params.value(name).toUtf8());
+        }
+        writeStream(ParamsRecord, paramsBody);
+        writeRecord(ParamsRecord, QByteArray());
+
+        writeStream(StdinRecord, pendingInput);
+        pendingInput.clear();
+        if (inputClosing == true) {
+            writeRecord(StdinRecord, QByteArray());
+        }
+    }
+
+    // One chunk of the request body at a time;
+    // the next one is requested only when this one is written
+    // to the socket, which the responder reads only as fast as
+    // the script reads its STDIN:
+    void writeInputSlot(QByteArray inputData)
+    {
+        if (requestFinished == true) {
+            return;
+        }
+        inputRequested = true;
+        if (connectedOnce == true) {
+            writeStream(StdinRecord, inputData);
+        } else {
+            pendingInput.append(inputData);
+        }
+    }
+
+    void closeInputSlot()
+    {
+        if (requestFinished == true or inputClosing == true) {
+            return;
+        }
+        inputClosing = true;
+        if (connectedOnce == true) {
+            writeRecord(StdinRecord, QByteArray());
+        }
+    }
+
+    void inputWrittenSlot()
+    {
+        if (socket->bytesToWrite() > 0) {
+            return;
+        }
+
+        if (inputRequested == true) {
+            inputRequested = false;
+            QMetaObject::invokeMethod(consumer, "uploadWrittenSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    // A paused request leaves the records in its socket,
+    // which stops reading when its read buffer is full:
+    void readyReadSlot()
+    {
+        if (isPaused()) {
+            return;
+        }
+        receivedData.append(socket->readAll());
+        readRecords();
+    }
+
+    void socketErrorSlot(QLocalSocket::LocalSocketError socketError)
+    {
+        if (requestFinished == true) {
+            return;
+        }
+
+        // The responder may still be starting and
+        // not listening on its socket yet:
+        if (connectedOnce == false and
+                (socketError == QLocalSocket::ServerNotFoundError or
+                 socketError == QLocalSocket::ConnectionRefusedError) and
+                connectionAttempts < maximumConnectionAttempts) {
+            socket->abort();
+            QTimer::singleShot(connectionRetryMilliseconds,
+                               this, SLOT(connectSlot()));
+            return;
+        }
+
+        if (socketError != QLocalSocket::PeerClosedError) {
+            qDebug() << "FastCGI request" << requestId << "failed:"
+                     << socket->errorString();
+            qDebug() << "===============";
+
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     QByteArray("FastCGI responder is not ")
+                                     + "available: "
+                                     + socket->errorString().toUtf8()));
+            finishRequest();
+        }
+    }
+
+    void disconnectedSlot()
+    {
+        if (requestFinished == false) {
+            // Read any records received together with the disconnection:
+            receivedData.append(socket->readAll());
+            readRecords();
+        }
+
+        // Records left by a paused request are read, when it resumes:
+        if (requestFinished == false and isPaused()) {
+            disconnectionPending = true;
+            return;
+        }
+
+        if (requestFinished == false) {
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     QByteArray("FastCGI responder closed ")
+                                     + "the connection before "
+                                     + "the end of the request."));
+            finishRequest();
+        }
+    }
+
+    void abortSlot()
+    {
+        if (requestFinished == false) {
+            if (socket->state() == QLocalSocket::ConnectedState) {
+                writeRecord(AbortRequestRecord, QByteArray());
+                socket->flush();
+            }
+            socket->abort();
+            finishRequest();
+        }
+    }
+
+public:
+    FastCgiRequest(QObject *consumer, QString socketName, quint16 requestId,
+                   QProcessEnvironment params, QByteArray stdinData);
+
+    quint16 requestId;
+
+protected:
+    void resumeReading()
+    {
+        if (disconnectionPending == true) {
+            disconnectionPending = false;
+            disconnectedSlot();
+        } else {
+            readyReadSlot();
+        }
+    }
+
+private:
+    enum RecordType {
+        BeginRequestRecord = 1,
+        AbortRequestRecord = 2,
+        EndRequestRecord = 3,
+        ParamsRecord = 4,
+        StdinRecord = 5,
+        StdoutRecord = 6,
+        StderrRecord = 7
+    };
+
+    enum Role {
+        ResponderRole = 1
+    };
+
+    void finishRequest()
+    {
+        requestFinished = true;
+        socket->disconnectFromServer();
+        handOver(ScriptPipeChunk(ScriptPipeChunk::FinishedChannel,
+                                 QByteArray()));
+    }
+
+    // Record header: version, type, request ID (2 bytes),
+    // content length (2 bytes), padding length, reserved byte.
+    void readRecords()
+    {
+        while (receivedData.size() >= 8 and !isPaused()) {
+            int type = (unsigned char) receivedData.at(1);
+            int contentLength =
+                    ((unsigned char) receivedData.at(4) << 8)
+                    | (unsigned char) receivedData.at(5);
+            int paddingLength = (unsigned char) receivedData.at(6);
+
+            if (receivedData.size() < 8 + contentLength + paddingLength) {
+                break;
+            }
+
+            QByteArray content = receivedData.mid(8, contentLength);
+            receivedData.remove(0, 8 + contentLength + paddingLength);
+
+            if (type == StdoutRecord and content.length() > 0) {
+                handOver(ScriptPipeChunk(ScriptPipeChunk::OutputChannel,
+                                         content));
+            }
+
+            if (type == StderrRecord and content.length() > 0) {
+                handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                         content));
+            }
+
+            if (type == EndRequestRecord) {
+                finishRequest();
+                return;
+            }
+        }
+    }
+
+    void writeRecord(int type, QByteArray content)
+    {
+        int paddingLength = (8 - (content.length() % 8)) % 8;
+
+        QByteArray record;
+        record.append(char(1));
+        record.append(char(type));
+        record.append(char((requestId >> 8) & 0xFF));
+        record.append(char(requestId & 0xFF));
+        record.append(char((content.length() >> 8) & 0xFF));
+        record.append(char(content.length() & 0xFF));
+        record.append(char(paddingLength));
+        record.append(char(0));
+        record.append(content);
+        record.append(QByteArray(paddingLength, char(0)));
+
+        socket->write(record);
+    }
+
+    // Stream records are split in chunks and
+    // closed later by an empty record of the same type, so
+    // empty content is not written at all:
+    void writeStream(int type, QByteArray content)
+    {
+        int position = 0;
+        while (position < content.length()) {
+            writeRecord(type, content.mid(position, maximumRecordContent));
+            position = position + maximumRecordContent;
+        }
+    }
+
+    void appendLength(QByteArray &body, int length)
+    {
+        if (length < 128) {
+            body.append(char(length));
+        } else {
+            body.append(char(((length >> 24) & 0x7F) | 0x80));
+            body.append(char((length >> 16) & 0xFF));
+            body.append(char((length >> 8) & 0xFF));
+            body.append(char(length & 0xFF));
+        }
+    }
+
+    void appendNameValuePair(QByteArray &body, QByteArray name, QByteArray value)
+    {
+        appendLength(body, name.length());
+        appendLength(body, value.length());
+        body.append(name);
+        body.append(value);
+    }
+
+    QLocalSocket *socket;
+    QString socketName;
+    QProcessEnvironment params;
+    QByteArray pendingInput;
+    QByteArray receivedData;
+    bool connectedOnce;
+    bool inputRequested;
+    bool inputClosing;
+    bool requestFinished;
+    bool disconnectionPending;
+    int connectionAttempts;
+
+    static const int maximumRecordContent = 32768;
+    static const int maximumConnectionAttempts = 100;
+    static const int connectionRetryMilliseconds = 50;
+};
+
+// ==============================
+// GOVERNED PROCESS CLASS DEFINITION:
+// ==============================
+// Script process started in a process group of its own and
+// with the resource limits set in the [perl] section of peb.ini.
+// Stopping the script stops the whole group, so programs started by
+// the script with system() or backticks do not outlive it.
+// A script with output pipes is started by a small reporter process,
+// the process QProcess sees, which waits for the script and
+// reports the resources it used over a pipe.
+// QProcess reaps its process itself, so this is the only way
+// the usage of one script is separated from other scripts.
+class GovernedProcess : public QProcess
+{
+    Q_OBJECT
+
+public slots:
+    void killGroupSlot()
+    {
+#ifndef Q_OS_WIN
+        if (processGroup > 0) {
+            ::kill(-processGroup, SIGKILL);
+            return;
+        }
+#endif
+        kill();
+    }
+
+private slots:
+    void processStartedSlot()
+    {
+#ifndef Q_OS_WIN
+        processGroup = pid();
+        // Set in both processes, so the group exists whichever runs first:
+        setpgid(processGroup, processGroup);
+#endif
+    }
+
+public:
+    GovernedProcess(QObject *parent);
+
+    ~GovernedProcess()
+    {
+        if (state() != QProcess::NotRunning or terminationRequested == true) {
+            killGroupSlot();
+        }
+#ifndef Q_OS_WIN
+        closeDescriptor(outputPipe[0]);
+        closeDescriptor(outputPipe[1]);
+        closeDescriptor(errorPipe[0]);
+        closeDescriptor(errorPipe[1]);
+        closeDescriptor(usagePipe[0]);
+        closeDescriptor(usagePipe[1]);
+#endif
+    }
+
+    // STDOUT and STDERR of the script are pipes read by the owner
+    // instead of QProcess, which empties its pipes whenever they have data.
+    // Output not read yet stays in the kernel, so a script
+    // writing faster than its output is read is blocked.
+    // Must be called before start():
+    bool openOutputPipes()
+    {
+#ifndef Q_OS_WIN
+        if (::pipe(outputPipe) != 0) {
+            outputPipe[0] = -1;
+            outputPipe[1] = -1;
+            return false;
+        }
+        if (::pipe(errorPipe) != 0) {
+            errorPipe[0] = -1;
+            errorPipe[1] = -1;
+            return false;
+        }
+
+        // Scripts are started without the reporter process,
+        // if its pipe can not be created:
+        if (::pipe(usagePipe) != 0) {
+            usagePipe[0] = -1;
+            usagePipe[1] = -1;
+        }
+
+        // Only the copies made in the child survive exec():
+        int descriptors[6] = {outputPipe[0], outputPipe[1],
+                              errorPipe[0], errorPipe[1],
+                              usagePipe[0], usagePipe[1]};
+        for (int index = 0; index < 6; index++) {
+            if (descriptors[index] >= 0) {
+                fcntl(descriptors[index], F_SETFD, FD_CLOEXEC);
+            }
+        }
+        fcntl(outputPipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(errorPipe[0], F_SETFL, O_NONBLOCK);
+        if (usagePipe[0] >= 0) {
+            fcntl(usagePipe[0], F_SETFL, O_NONBLOCK);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Called after start(). The write ends belong to the script only,
+    // so reading returns end of file, when the script and
+    // all programs started by it have closed them:
+    void closeChildEnds()
+    {
+#ifndef Q_OS_WIN
+        closeDescriptor(outputPipe[1]);
+        closeDescriptor(errorPipe[1]);
+        closeDescriptor(usagePipe[1]);
+#endif
+    }
+
+    // Read ends of the pipes, -1 without them:
+    int outputDescriptor()
+    {
+#ifndef Q_OS_WIN
+        return outputPipe[0];
+#else
+        return -1;
+#endif
+    }
+
+    int errorDescriptor()
+    {
+#ifndef Q_OS_WIN
+        return errorPipe[0];
+#else
+        return -1;
+#endif
+    }
+
+    // Resident processes are not limited in CPU time,
+    // which adds up over all their requests.
+    // Must be called before start():
+    void removeCpuTimeLimit()
+    {
+#ifndef Q_OS_WIN
+        cpuTimeLimit = 0;
+#endif
+    }
+
+    // SIGTERM to the group first and SIGKILL after the grace period:
+    void terminateGroup()
+    {
+        terminationRequested = true;
+#ifndef Q_OS_WIN
+        if (processGroup > 0) {
+            ::kill(-processGroup, SIGTERM);
+            QTimer::singleShot(terminationGracePeriod,
+                               this, SLOT(killGroupSlot()));
+            return;
+        }
+#endif
+        kill();
+    }
+
+    // Resources used by the script and the programs it waited for,
+    // as reported by the reporter process when the script ended.
+    // Nothing is reported, if the reporter was stopped too:
+    QString resourceUsage()
+    {
+#ifndef Q_OS_WIN
+        struct rusage usage;
+        if (usagePipe[0] >= 0 and
+                ::read(usagePipe[0], &usage, sizeof(usage))
+                == (ssize_t) sizeof(usage)) {
+            return QString("%1 msecs user CPU, %2 msecs system CPU, "
+                           "%3 major page faults")
+                    .arg(milliseconds(usage.ru_utime))
+                    .arg(milliseconds(usage.ru_stime))
+                    .arg(usage.ru_majflt);
+        }
+#endif
+        return QString("not available");
+    }
+
+protected:
+    // Runs in the child process between fork() and exec(),
+    // so only plain system calls are used here:
+    void setupChildProcess()
+    {
+#ifndef Q_OS_WIN
+        setpgid(0, 0);
+
+        if (outputPipe[1] >= 0 and errorPipe[1] >= 0) {
+            dup2(outputPipe[1], STDOUT_FILENO);
+            dup2(errorPipe[1], STDERR_FILENO);
+        }
+
+        // The hard CPU limit is one second later and ends the script,
+        // if SIGXCPU at the soft limit is ignored:
+        setLimit(RLIMIT_CPU, cpuTimeLimit, cpuTimeLimit + 1);
+        setLimit(RLIMIT_AS, addressSpaceLimit, addressSpaceLimit);
+        setLimit(RLIMIT_NOFILE, openFilesLimit, openFilesLimit);
+
+        if (niceLevel != 0) {
+            setpriority(PRIO_PROCESS, 0, niceLevel);
+        }
+
+        // The script is the child of the reporter process and
+        // returns to QProcess, which executes it.
+        // Without a reporter the script is executed directly:
+        if (usagePipe[1] >= 0) {
+            struct sigaction action;
+            memset(&action, 0, sizeof(action));
+            action.sa_handler = SIG_DFL;
+            sigaction(SIGCHLD, &action, 0);
+
+            pid_t scriptPid = fork();
+            if (scriptPid > 0) {
+                reportUsage(scriptPid);
+            }
+        }
+#endif
+    }
+
+private:
+#ifndef Q_OS_WIN
+    static void setLimit(int resource, rlim_t softLimit, rlim_t hardLimit)
+    {
+        if (softLimit > 0) {
+            struct rlimit limit;
+            limit.rlim_cur = softLimit;
+            limit.rlim_max = hardLimit;
+            setrlimit(resource, &limit);
+        }
+    }
+
+    static qint64 milliseconds(struct timeval time)
+    {
+        return (qint64) time.tv_sec * 1000 + time.tv_usec / 1000;
+    }
+
+    // Runs in the reporter process and never returns.
+    // All descriptors except the usage pipe are closed, so
+    // the output pipes and the start notification of QProcess
+    // are held open only by the script.
+    // The termination of the group is survived to report it and
+    // the end of the script is passed on to QProcess:
+    void reportUsage(pid_t scriptPid)
+    {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = SIG_IGN;
+        sigaction(SIGTERM, &action, 0);
+
+        int usageDescriptor = usagePipe[1];
+        struct rlimit openFiles;
+        rlim_t lastDescriptor = 65536;
+        if (getrlimit(RLIMIT_NOFILE, &openFiles) == 0 and
+                openFiles.rlim_cur < lastDescriptor) {
+            lastDescriptor = openFiles.rlim_cur;
+        }
+        for (rlim_t descriptor = 0; descriptor < lastDescriptor;
+             descriptor++) {
+            if ((int) descriptor != usageDescriptor) {
+                ::close((int) descriptor);
+            }
+        }
+
+        int status = 0;
+        struct rusage usage;
+        while (wait4(scriptPid, &status, 0, &usage) < 0) {
+            if (errno != EINTR) {
+                _exit(255);
+            }
+        }
+        ssize_t written = ::write(usageDescriptor, &usage, sizeof(usage));
+        Q_UNUSED(written);
+
+        if (WIFSIGNALED(status)) {
+            int signalNumber = WTERMSIG(status);
+            action.sa_handler = SIG_DFL;
+            sigaction(signalNumber, &action, 0);
+
+            struct rlimit noCoreFile;
+            noCoreFile.rlim_cur = 0;
+            noCoreFile.rlim_max = 0;
+            setrlimit(RLIMIT_CORE, &noCoreFile);
+
+            sigset_t signals;
+            sigemptyset(&signals);
+            sigaddset(&signals, signalNumber);
+            sigprocmask(SIG_UNBLOCK, &signals, 0);
+            ::kill(getpid(), signalNumber);
+        }
+
+        _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 255);
+    }
+
+    static void closeDescriptor(int &descriptor)
+    {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+            descriptor = -1;
+        }
+    }
+
+    int outputPipe[2];
+    int errorPipe[2];
+    int usagePipe[2];
+    pid_t processGroup;
+    rlim_t cpuTimeLimit;
+    rlim_t addressSpaceLimit;
+    rlim_t openFilesLimit;
+#endif
+    int niceLevel;
+    int terminationGracePeriod;
+    bool terminationRequested;
+};
+
+// ==============================
+// FASTCGI RESPONDER CLASS DEFINITION:
+// ==============================
+// A CGI::Fast or FCGI script started once and kept resident between requests.
+// The responder listens on a local socket in the temporary folder of
+// the browser, which is given to it in the FCGI_SOCKET_PATH variable.
+// A crashed or finished responder is started again on the next request.
+// Responders are governed like all other scripts, only
+// their CPU time is not limited.
+class FastCgiResponder : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void responderOutputSlot()
+    {
+        qDebug() << "FastCGI responder output:"
+                 << responderProcess->readAllStandardOutput();
+    }
+
+    void responderErrorSlot()
+    {
+        qDebug() << "FastCGI responder error:"
+                 << responderProcess->readAllStandardError();
+    }
+
+    void responderFinishedSlot(int exitCode, QProcess::ExitStatus exitStatus)
+    {
+        if (exitStatus == QProcess::CrashExit) {
+            qDebug() << "FastCGI responder crashed:" << scriptFullFilePath;
+        } else {
+            qDebug() << "FastCGI responder finished:" << scriptFullFilePath
+                     << "exit code:" << exitCode;
+        }
+        qDebug() << "It will be started again on the next request.";
+        qDebug() << "===============";
+
+        QFile::remove(socketName);
+    }
+
+public:
+    FastCgiResponder(QString scriptFullFilePath);
+
+    static FastCgiResponder *responderForScript(QString scriptFullFilePath)
+    {
+        static QHash<QString, FastCgiResponder*> responders;
+
+        FastCgiResponder *responder = responders.value(scriptFullFilePath);
+        if (responder == 0) {
+            responder = new FastCgiResponder(scriptFullFilePath);
+            responders.insert(scriptFullFilePath, responder);
+        }
+        return responder;
+    }
+
+    // The request is started by its consumer:
+    FastCgiRequest *startRequest(QObject *consumer,
+                                 QProcessEnvironment environment,
+                                 QByteArray stdinData)
+    {
+        if (responderProcess->state() == QProcess::NotRunning) {
+            startResponder(environment);
+        }
+
+        lastRequestId++;
+        if (lastRequestId == 0) {
+            lastRequestId = 1;
+        }
+
+        QProcessEnvironment params = environment;
+        params.insert("SCRIPT_FILENAME", scriptFullFilePath);
+        params.insert("GATEWAY_INTERFACE", "CGI/1.1");
+        if (!params.contains("REQUEST_METHOD")) {
+            params.insert("REQUEST_METHOD", "GET");
+        }
+
+        FastCgiRequest *request =
+                new FastCgiRequest(consumer, socketName, lastRequestId,
+                                   params, stdinData);
+
+        qDebug() << "FastCGI request" << lastRequestId
+                 << "sent to:" << scriptFullFilePath;
+
+        return request;
+    }
+
+private:
+    // Packaged responders are already extracted by the page:
+    void startResponder(QProcessEnvironment environment)
+    {
+        // Remove a stale socket left from a crashed responder:
+        QFile::remove(socketName);
+
+        // The responder outlives the request that started it -
+        // request variables are sent only as FastCGI parameters:
+        QProcessEnvironment responderEnvironment = environment;
+        foreach (QString requestVariable, requestVariables()) {
+            responderEnvironment.remove(requestVariable);
+        }
+        responderEnvironment.insert("FCGI_SOCKET_PATH", socketName);
+        responderProcess->setProcessEnvironment(responderEnvironment);
+
+        QFileInfo scriptAbsoluteFilePath(scriptFullFilePath);
+        responderProcess
+                ->setWorkingDirectory(scriptAbsoluteFilePath.absolutePath());
+
+        QStringList responderCommandLine;
+        if (SCRIPT_CENSORING == 1) {
+            // Responders are censored by the page before every request and
+            // run with the prohibited core functions masked:
+            ScriptCensor scriptCensor;
+            responderCommandLine << scriptCensor.opsCommandLineArgument();
+        }
+        responderCommandLine << scriptFullFilePath;
+
+        responderProcess->start((qApp->property("perlInterpreter").toString()),
+                                responderCommandLine);
+
+        qDebug() << "FastCGI responder started:" << scriptFullFilePath;
+        qDebug() << "FastCGI socket:" << socketName;
+        qDebug() << "===============";
+    }
+
+    static QStringList requestVariables()
+    {
+        QStringList variables;
+        variables << "REQUEST_METHOD" << "QUERY_STRING"
+                  << "CONTENT_LENGTH" << "CONTENT_TYPE"
+                  << "HTTP_IF_NONE_MATCH" << "HTTP_IF_MODIFIED_SINCE"
+                  << "PEB_SCRIPT_JOB_ID" << "SCRIPT_FILENAME"
+                  << "GATEWAY_INTERFACE" << "FILE_TO_OPEN"
+                  << "FILE_TO_CREATE" << "FOLDER_TO_OPEN";
+        return variables;
+    }
+
+    QString scriptFullFilePath;
+    QString socketName;
+    GovernedProcess *responderProcess;
+    quint16 lastRequestId;
+};
+
+// ==============================
+// ZYGOTE REQUEST CLASS DEFINITION:
+// ==============================
+// One script run by the fork-server using the "PEB-ZYGOTE 2" protocol
+// described in zygote.pl. STDIN, STDOUT and STDERR are streamed as records
+// over the request connection while the script runs.
+// The script leads its own process group, which is signalled on abort.
+class ZygoteRequest : public ScriptRequest
+{
+    Q_OBJECT
+
+public slots:
+    void startSlot()
+    {
+        socket->connectToServer(socketName);
+    }
+
+    void connectedSlot()
+    {
+        QByteArray header;
+        header.append(scriptFullFilePath.toUtf8());
+        header.append(char(0));
+        header.append(workingDirectory.toUtf8());
+        foreach (QString variable, environment.toStringList()) {
+            header.append(char(0));
+            header.append(variable.toUtf8());
+        }
+
+        QByteArray request;
+        request.append("PEB-ZYGOTE 2\n");
+        request.append(QByteArray::number(header.length()));
+        request.append('\n');
+        request.append(header);
+        socket->write(request);
+
+        connected = true;
+        writeInput(pendingInput);
+        pendingInput.clear();
+        if (inputClosing == true) {
+            writeRecord('I', QByteArray());
+        }
+    }
+
+    // One chunk of the request body at a time;
+    // the next one is requested only when this one is written.
+    // The fork-server stops reading the connection while
+    // the script does not read its STDIN, so this is the backpressure:
+    void writeInputSlot(QByteArray inputData)
+    {
+        if (requestFinished == true) {
+            return;
+        }
+        inputRequested = true;
+        if (connected == true) {
+            writeInput(inputData);
+        } else {
+            pendingInput.append(inputData);
+        }
+    }
+
+    void closeInputSlot()
+    {
+        if (requestFinished == true or inputClosing == true) {
+            return;
+        }
+        inputClosing = true;
+        if (connected == true) {
+            writeRecord('I', QByteArray());
+        }
+    }
+
+    void inputWrittenSlot()
+    {
+        if (socket->bytesToWrite() > 0) {
+            return;
+        }
+
+        if (inputRequested == true) {
+            inputRequested = false;
+            QMetaObject::invokeMethod(consumer, "uploadWrittenSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    // A paused request leaves the records in its socket,
+    // which stops reading when its read buffer is full:
+    void readyReadSlot()
+    {
+        if (isPaused()) {
+            return;
+        }
+        receivedData.append(socket->readAll());
+        readRecords();
+    }
+
+    void socketErrorSlot(QLocalSocket::LocalSocketError socketError)
+    {
+        if (socketError != QLocalSocket::PeerClosedError and
+                requestFinished == false) {
+            qDebug() << "Fork-server request failed:" << socket->errorString();
+            qDebug() << "===============";
+
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     QByteArray("Fork-server is not ")
+                                     + "available: "
+                                     + socket->errorString().toUtf8()));
+            finishRequest();
+        }
+    }
+
+    void disconnectedSlot()
+    {
+        if (requestFinished == false) {
+            // Read any records received together with the disconnection:
+            receivedData.append(socket->readAll());
+            readRecords();
+        }
+
+        // Records left by a paused request are read, when it resumes:
+        if (requestFinished == false and isPaused()) {
+            disconnectionPending = true;
+            return;
+        }
+
+        if (requestFinished == false) {
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     QByteArray("Fork-server closed ")
+                                     + "the connection before "
+                                     + "the end of the script."));
+            finishRequest();
+        }
+    }
+
+    void abortSlot()
+    {
+        if (requestFinished == false) {
+#ifndef Q_OS_WIN
+            if (processGroup > 0) {
+                ::kill(-(pid_t) processGroup, SIGTERM);
+            }
+#endif
+            socket->abort();
+            finishRequest();
+        }
+    }
+
+public:
+    ZygoteRequest(QObject *consumer,
+                  QString socketName, QString scriptFullFilePath,
+                  QString workingDirectory, QProcessEnvironment environment,
+                  QByteArray stdinData);
+
+protected:
+    void resumeReading()
+    {
+        if (disconnectionPending == true) {
+            disconnectionPending = false;
+            disconnectedSlot();
+        } else {
+            readyReadSlot();
+        }
+    }
+
+private:
+    void finishRequest()
+    {
+        requestFinished = true;
+        socket->disconnectFromServer();
+        handOver(ScriptPipeChunk(ScriptPipeChunk::FinishedChannel,
+                                 QByteArray()));
+    }
+
+    // Record: type byte, payload length in network order, payload.
+    void readRecords()
+    {
+        int position = 0;
+        while (receivedData.size() - position >= 5 and !isPaused()) {
+            char type = receivedData.at(position);
+            qint64 length =
+                    ((qint64) (unsigned char) receivedData.at(position + 1) << 24)
+                    | ((unsigned char) receivedData.at(position + 2) << 16)
+                    | ((unsigned char) receivedData.at(position + 3) << 8)
+                    | (unsigned char) receivedData.at(position + 4);
+
+            if (receivedData.size() - position < 5 + length) {
+                break;
+            }
+
+            QByteArray payload = receivedData.mid(position + 5, length);
+            position = position + 5 + length;
+
+            if (type == 'P') {
+                processGroup = payload.toLongLong();
+            }
+
+            if (type == 'O' and payload.length() > 0) {
+                handOver(ScriptPipeChunk(ScriptPipeChunk::OutputChannel,
+                                         payload));
+            }
+
+            if (type == 'E' and payload.length() > 0) {
+                handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                         payload));
+            }
+
+            if (type == 'X') {
+                qDebug() << "Fork-server script finished:"
+                         << scriptFullFilePath
+                         << "wait status, user and system CPU msecs:"
+                         << payload;
+                qDebug() << "===============";
+                finishRequest();
+                return;
+            }
+        }
+        receivedData.remove(0, position);
+    }
+
+    // An empty I record would close STDIN, so
+    // empty input is not written at all:
+    void writeInput(QByteArray inputData)
+    {
+        int position = 0;
+        while (position < inputData.length()) {
+            writeRecord('I', inputData.mid(position, maximumRecordContent));
+            position = position + maximumRecordContent;
+        }
+    }
+
+    void writeRecord(char type, QByteArray payload)
+    {
+        QByteArray record;
+        record.append(type);
+        record.append(char((payload.length() >> 24) & 0xFF));
+        record.append(char((payload.length() >> 16) & 0xFF));
+        record.append(char((payload.length() >> 8) & 0xFF));
+        record.append(char(payload.length() & 0xFF));
+        record.append(payload);
+
+        socket->write(record);
+    }
+
+    QLocalSocket *socket;
+    QString socketName;
+    QString scriptFullFilePath;
+    QString workingDirectory;
+    QProcessEnvironment environment;
+    QByteArray pendingInput;
+    QByteArray receivedData;
+    qint64 processGroup;
+    bool connected;
+    bool inputRequested;
+    bool inputClosing;
+    bool requestFinished;
+    bool disconnectionPending;
+
+    static const int maximumRecordContent = 65536;
+};
+
+// ==============================
+// ZYGOTE SERVER CLASS DEFINITION:
+// ==============================
+// Perl fork-server started once with the modules from
+// the 'zygote_preload' setting already loaded.
+// Every request is served by a copy-on-write child, so
+// module loading is paid only once per browser session.
+class ZygoteServer : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void startSlot()
+    {
+#if ZIP_SUPPORT == 1
+        // Started again, when the folders of Perl are extracted:
+        if (!ZipPackage::instance()->prepareScript(QString(), this,
+                                                   "startSlot")) {
+            return;
+        }
+#endif
+
+        QFile zygoteScriptFile(":/scripts/zygote.pl");
+        zygoteScriptFile.open(QIODevice::ReadOnly | QIODevice::Text);
+        QTextStream zygoteStream(&zygoteScriptFile);
+        QString zygoteScriptContents = zygoteStream.readAll();
+        zygoteScriptFile.close();
+
+        // Scripts are censored by the page before they are sent here and
+        // every forked child masks the prohibited core functions itself:
+        QString prohibitedCoreFunctions;
+        if (SCRIPT_CENSORING == 1) {
+            ScriptCensor scriptCensor;
+            prohibitedCoreFunctions = scriptCensor.prohibitedCoreFunctionList();
+        }
+
+        // The resource limits of script processes are applied
+        // by every forked child and the grace period of the governor
+        // is used, when a script is stopped:
+        int terminationGracePeriod =
+                qApp->property("terminationGracePeriod").toInt();
+        if (terminationGracePeriod <= 0) {
+            terminationGracePeriod = 2000;
+        }
+        QString governorSettings = QString("%1,%2,%3,%4,%5")
+                .arg(qApp->property("cpuTimeLimit").toInt())
+                .arg(qApp->property("addressSpaceLimit").toInt())
+                .arg(qApp->property("openFilesLimit").toInt())
+                .arg(qApp->property("niceLevel").toInt())
+                .arg(terminationGracePeriod);
+
+        // Preloaded modules are found using the PERLLIB of all scripts and
+        // the environment of every request is set by the forked child:
+        QProcessEnvironment zygoteEnvironment;
+        zygoteEnvironment.insert("PERLLIB",
+                                 qApp->property("perlLib").toString());
+        zygoteProcess.setProcessEnvironment(zygoteEnvironment);
+
+        zygoteReady = false;
+        zygoteElapsedTimer.start();
+        zygoteProcess.start((qApp->property("perlInterpreter").toString()),
+                            QStringList()
+                            << "-e" << zygoteScriptContents
+                            << "--" << socketName << governorSettings
+                            << prohibitedCoreFunctions
+                            << (qApp->property("zygotePreloadModules")
+                                .toStringList()));
+
+        qDebug() << "Fork-server started with control socket:" << socketName;
+        qDebug() << "===============";
+    }
+
+    void zygoteOutputSlot()
+    {
+        QString output = zygoteProcess.readAllStandardOutput();
+        if (output.contains("READY")) {
+            zygoteReady = true;
+            qDebug() << "Fork-server ready after"
+                     << zygoteElapsedTimer.elapsed()
+                     << "msecs of module preloading.";
+            qDebug() << "===============";
+        }
+    }
+
+    void zygoteErrorSlot()
+    {
+        qDebug() << "Fork-server error:" << zygoteProcess.readAllStandardError();
+    }
+
+    void zygoteFinishedSlot()
+    {
+        zygoteReady = false;
+
+        qDebug() << "Fork-server finished after"
+                 << zygoteElapsedTimer.elapsed() << "msecs.";
+
+        // A fork-server, which worked for a while, is started again.
+        // One, which exits immediately, is left stopped and
+        // all scripts are started as new processes.
+        if (zygoteElapsedTimer.elapsed() > minimumLifetimeMilliseconds) {
+            qDebug() << "Fork-server is going to be started again.";
+            qDebug() << "===============";
+            startSlot();
+        } else {
+            qDebug() << "Scripts will be started as new processes.";
+            qDebug() << "===============";
+        }
+    }
+
+public:
+    ZygoteServer();
+
+    static ZygoteServer *instance()
+    {
+        static ZygoteServer *zygoteServer = new ZygoteServer();
+        return zygoteServer;
+    }
+
+    bool isReady()
+    {
+        return zygoteReady;
+    }
+
+    // The request is started by its consumer:
+    ZygoteRequest *startRequest(QObject *consumer,
+                                QString scriptFullFilePath,
+                                QString workingDirectory,
+                                QProcessEnvironment environment,
+                                QByteArray stdinData)
+    {
+        return new ZygoteRequest(consumer, socketName, scriptFullFilePath,
+                                 workingDirectory, environment, stdinData);
+    }
+
+private:
+    QProcess zygoteProcess;
+    QString socketName;
+    QElapsedTimer zygoteElapsedTimer;
+    bool zygoteReady;
+
+    static const int minimumLifetimeMilliseconds = 5000;
+};
+
+#if EMBEDDED_PERL == 1
+// ==============================
+// EMBEDDED PERL JOB CLASS DEFINITION:
+// ==============================
+// One script run on a worker thread in a fresh clone of
+// the parent interpreter. The result is delivered as a signal,
+// which is queued to the request in the I/O thread.
+class EmbeddedPerlJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+signals:
+    void resultSignal(QByteArray stdoutData, QByteArray stderrData);
+
+public:
+    EmbeddedPerlJob(QMutex *interpreterMutex, QString scriptFullFilePath,
+                    QProcessEnvironment environment, QByteArray stdinData);
+
+    void run()
+    {
+        void *interpreter;
+        interpreterMutex->lock();
+        interpreter = PerlEmbed::cloneInterpreter();
+        interpreterMutex->unlock();
+
+        if (interpreter == 0) {
+            emit resultSignal(QByteArray(),
+                              QByteArray("Embedded Perl is not initialized."));
+            return;
+        }
+
+        std::vector<std::string> environmentList;
+        foreach (QString variable, environment.toStringList()) {
+            environmentList.push_back(variable.toLocal8Bit().constData());
+        }
+
+        std::string stdoutData;
+        std::string stderrData;
+        PerlEmbed::runScript(interpreter,
+                             scriptFullFilePath.toLocal8Bit().constData(),
+                             environmentList,
+                             std::string(stdinData.constData(),
+                                         stdinData.size()),
+                             stdoutData, stderrData);
+
+        interpreterMutex->lock();
+        PerlEmbed::destroyInterpreter(interpreter);
+        interpreterMutex->unlock();
+
+        emit resultSignal(QByteArray(stdoutData.data(), stdoutData.size()),
+                          QByteArray(stderrData.data(), stderrData.size()));
+    }
+
+private:
+    QMutex *interpreterMutex;
+    QString scriptFullFilePath;
+    QProcessEnvironment environment;
+    QByteArray stdinData;
+};
+
+// ==============================
+// EMBEDDED PERL REQUEST CLASS DEFINITION:
+// ==============================
+// One script run by the embedded interpreter pool.
+// A running interpreter can not be interrupted from outside, so
+// an aborted request only stops waiting and drops the late result.
+class EmbeddedPerlRequest : public ScriptRequest
+{
+    Q_OBJECT
+
+public slots:
+    void startSlot()
+    {
+        threadPool->start(job);
+    }
+
+    void resultSlot(QByteArray stdoutData, QByteArray stderrData)
+    {
+        if (requestFinished == false) {
+            handOver(ScriptPipeChunk(ScriptPipeChunk::OutputChannel,
+                                     stdoutData));
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     stderrData));
+        }
+        finishRequest();
+    }
+
+    void abortSlot()
+    {
+        finishRequest();
+    }
+
+    // The interpreter gets the whole request body when it starts:
+    void writeInputSlot(QByteArray inputData)
+    {
+        Q_UNUSED(inputData);
+    }
+
+    void closeInputSlot()
+    {
+    }
+
+public:
+    EmbeddedPerlRequest(QObject *consumer, QThreadPool *threadPool,
+                        EmbeddedPerlJob *job);
+
+protected:
+    // The whole output is handed over at once in at most three chunks,
+    // so there is nothing to read after a pause:
+    void resumeReading()
+    {
+    }
+
+private:
+    void finishRequest()
+    {
+        if (requestFinished == false) {
+            requestFinished = true;
+            handOver(ScriptPipeChunk(ScriptPipeChunk::FinishedChannel,
+                                     QByteArray()));
+        }
+    }
+
+    QThreadPool *threadPool;
+    EmbeddedPerlJob *job;
+    bool requestFinished;
+};
+
+// ==============================
+// EMBEDDED PERL CLASS DEFINITION:
+// ==============================
+// Pool of worker threads running scripts inside the browser process.
+// There is no fork, exec or pipe setup for every script, but
+// all scripts share the process and its working directory, so
+// this mode is meant only for trusted scripts.
+class EmbeddedPerl : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void initializeSlot()
+    {
+        initialize();
+    }
+
+public:
+    EmbeddedPerl();
+
+    static EmbeddedPerl *instance()
+    {
+        static EmbeddedPerl *embeddedPerl = new EmbeddedPerl();
+        return embeddedPerl;
+    }
+
+    bool initialize()
+    {
+#if ZIP_SUPPORT == 1
+        // Initialized again, when the folders of Perl are extracted:
+        if (!ZipPackage::instance()->prepareScript(QString(), this,
+                                                   "initializeSlot")) {
+            return false;
+        }
+#endif
+
+        // The PERLLIB folder of the process-based scripts is added to @INC:
+        std::vector<std::string> includeDirectories;
+        QString perlLib = qApp->property("perlLib").toString();
+        if (perlLib.length() > 0) {
+            includeDirectories.push_back(perlLib.toLocal8Bit().constData());
+        }
+
+        std::vector<std::string> preloadModules;
+        foreach (QString module,
+                 qApp->property("zygotePreloadModules").toStringList()) {
+            preloadModules.push_back(module.toLocal8Bit().constData());
+        }
+
+        std::string prohibitedCoreFunctions;
+        if (SCRIPT_CENSORING == 1) {
+            ScriptCensor scriptCensor;
+            prohibitedCoreFunctions = scriptCensor.prohibitedCoreFunctionList()
+                    .toLocal8Bit().constData();
+        }
+
+        QElapsedTimer initializationElapsedTimer;
+        initializationElapsedTimer.start();
+
+        embeddedPerlReady = PerlEmbed::initialize(includeDirectories,
+                                                  preloadModules,
+                                                  prohibitedCoreFunctions);
+
+        qDebug() << "Embedded Perl initialized:" << embeddedPerlReady
+                 << "in" << initializationElapsedTimer.elapsed() << "msecs.";
+        qDebug() << "Embedded Perl worker threads:"
+                 << threadPool.maxThreadCount();
+        qDebug() << "===============";
+
+        return embeddedPerlReady;
+    }
+
+    bool isReady()
+    {
+        return embeddedPerlReady;
+    }
+
+    // The request is started by its consumer:
+    EmbeddedPerlRequest *startRequest(QObject *consumer,
+                                      QString scriptFullFilePath,
+                                      QProcessEnvironment environment,
+                                      QByteArray stdinData)
+    {
+        EmbeddedPerlJob *job = new EmbeddedPerlJob(&interpreterMutex,
+                                                   scriptFullFilePath,
+                                                   environment, stdinData);
+        EmbeddedPerlRequest *request =
+                new EmbeddedPerlRequest(consumer, &threadPool, job);
+        QObject::connect(job, SIGNAL(resultSignal(QByteArray, QByteArray)),
+                         request, SLOT(resultSlot(QByteArray, QByteArray)),
+                         Qt::QueuedConnection);
+
+        // The job is deleted in the main thread after its result is sent:
+        job->setAutoDelete(false);
+        QObject::connect(job, SIGNAL(resultSignal(QByteArray, QByteArray)),
+                         job, SLOT(deleteLater()));
+
+        return request;
+    }
+
+private:
+    QThreadPool threadPool;
+    QMutex interpreterMutex;
+    bool embeddedPerlReady;
+};
+#endif
+
+// ==============================
+// SCRIPT PROCESS WORKER CLASS DEFINITION:
+// ==============================
+// Owns the QProcess of one script inside the I/O thread.
+// On Unix the output pipes of the script are read here and
+// are not watched while the worker is paused.
+// On Windows QProcess reads them itself, so there
+// a pause leaves the output in the buffers of QProcess.
+class ScriptProcessWorker : public ScriptPipeWorker
+{
+    Q_OBJECT
+
+public slots:
+    void startSlot()
+    {
+        process->setProcessEnvironment(environment);
+        process->setWorkingDirectory(workingDirectory);
+
+#ifndef Q_OS_WIN
+        if (!process->openOutputPipes()) {
+            processFinished = true;
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     QByteArray("Output pipes of the script ")
+                                     + "could not be created."));
+            handOver(ScriptPipeChunk(ScriptPipeChunk::FinishedChannel,
+                                     QByteArray()));
+            return;
+        }
+#endif
+
+        process->start(program, arguments,
+                       QProcess::Unbuffered | QProcess::ReadWrite);
+
+#ifndef Q_OS_WIN
+        process->closeChildEnds();
+        if (processFinished == false) {
+            outputNotifier = new QSocketNotifier(process->outputDescriptor(),
+                                                 QSocketNotifier::Read, this);
+            errorNotifier = new QSocketNotifier(process->errorDescriptor(),
+                                                QSocketNotifier::Read, this);
+            QObject::connect(outputNotifier, SIGNAL(activated(int)),
+                             this, SLOT(readOutputSlot()));
+            QObject::connect(errorNotifier, SIGNAL(activated(int)),
+                             this, SLOT(readErrorSlot()));
+        }
+#endif
+
+        if (stdinData.length() > 0) {
+            process->write(stdinData);
+            stdinData.clear();
+        }
+    }
+
+    void abortSlot()
+    {
+        if (processFinished == false) {
+            process->terminateGroup();
+        }
+    }
+
+    void readOutputSlot()
+    {
+#ifndef Q_OS_WIN
+        readPipe(outputNotifier, ScriptPipeChunk::OutputChannel);
+#else
+        if (processFinished == false and !isPaused()) {
+            handOver(ScriptPipeChunk(ScriptPipeChunk::OutputChannel,
+                                     process->readAllStandardOutput()));
+        }
+#endif
+    }
+
+    void readErrorSlot()
+    {
+#ifndef Q_OS_WIN
+        readPipe(errorNotifier, ScriptPipeChunk::ErrorChannel);
+#else
+        if (processFinished == false and !isPaused()) {
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     process->readAllStandardError()));
+        }
+#endif
+    }
+
+    void processFinishedSlot()
+    {
+        processExited = true;
+        finishProcess();
+    }
+
+    void processErrorSlot(QProcess::ProcessError error)
+    {
+        if (error == QProcess::FailedToStart and processFinished == false) {
+            processFinished = true;
+            stopReading();
+            handOver(ScriptPipeChunk(ScriptPipeChunk::ErrorChannel,
+                                     process->errorString().toUtf8()));
+            handOver(ScriptPipeChunk(ScriptPipeChunk::FinishedChannel,
+                                     QByteArray()));
+        }
+    }
+
+    // One chunk of the request body at a time;
+    // the next one is requested only when this one is written:
+    void writeInputSlot(QByteArray inputData)
+    {
+        if (processFinished == true) {
+            return;
+        }
+        inputRequested = true;
+        process->write(inputData);
+    }
+
+    void closeInputSlot()
+    {
+        if (process->bytesToWrite() > 0) {
+            inputClosing = true;
+        } else {
+            process->closeWriteChannel();
+        }
+    }
+
+    void inputWrittenSlot()
+    {
+        if (process->bytesToWrite() > 0) {
+            return;
+        }
+
+        if (inputClosing == true) {
+            inputClosing = false;
+            process->closeWriteChannel();
+        }
+
+        if (inputRequested == true) {
+            inputRequested = false;
+            QMetaObject::invokeMethod(consumer, "uploadWrittenSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+public:
+    ScriptProcessWorker(QObject *consumer,
+                        QString program,
+                        QStringList arguments,
+                        QProcessEnvironment environment,
+                        QString workingDirectory,
+                        QByteArray stdinData);
+
+protected:
+    void resumeReading()
+    {
+#ifndef Q_OS_WIN
+        if (outputNotifier != 0) {
+            outputNotifier->setEnabled(true);
+        }
+        if (errorNotifier != 0) {
+            errorNotifier->setEnabled(true);
+        }
+#endif
+
+        if (processExited == true) {
+            finishProcess();
+        } else {
+#ifdef Q_OS_WIN
+            readOutputSlot();
+            readErrorSlot();
+#endif
+        }
+    }
+
+private:
+    // Output left in the pipes is read first, so
+    // a worker paused by it finishes when it is resumed:
+    void finishProcess()
+    {
+        if (processFinished == true) {
+            return;
+        }
+
+        readOutputSlot();
+        readErrorSlot();
+        if (isPaused()) {
+            return;
+        }
+
+        processFinished = true;
+        stopReading();
+
+        qDebug() << "Resources used by" << arguments.join(" ") + ":"
+                 << process->resourceUsage();
+        qDebug() << "===============";
+
+        handOver(ScriptPipeChunk(ScriptPipeChunk::FinishedChannel,
+                                 QByteArray()));
+    }
+
+#ifndef Q_OS_WIN
+    // Reads until the pipe is empty or the worker is paused.
+    // The notifiers do not watch the pipes of a paused worker, so
+    // the rest of the output stays in the kernel until it is resumed:
+    void readPipe(QSocketNotifier *&notifier, ScriptPipeChunk::Channel channel)
+    {
+        if (notifier == 0 or processFinished == true) {
+            return;
+        }
+
+        while (notifier != 0 and !isPaused()) {
+            QByteArray data(readChunkSize, char(0));
+            ssize_t bytesRead =
+                    ::read((int) notifier->socket(), data.data(), readChunkSize);
+
+            if (bytesRead > 0) {
+                data.resize((int) bytesRead);
+                handOver(ScriptPipeChunk(channel, data));
+            } else if (bytesRead < 0 and errno == EINTR) {
+                continue;
+            } else if (bytesRead < 0 and
+                       (errno == EAGAIN or errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                // End of file or a broken pipe:
+                notifier->setEnabled(false);
+                notifier->deleteLater();
+                notifier = 0;
+            }
+        }
+
+        if (isPaused()) {
+            if (outputNotifier != 0) {
+                outputNotifier->setEnabled(false);
+            }
+            if (errorNotifier != 0) {
+                errorNotifier->setEnabled(false);
+            }
+        }
+    }
+#endif
+
+    void stopReading()
+    {
+#ifndef Q_OS_WIN
+        if (outputNotifier != 0) {
+            outputNotifier->setEnabled(false);
+            outputNotifier->deleteLater();
+            outputNotifier = 0;
+        }
+        if (errorNotifier != 0) {
+            errorNotifier->setEnabled(false);
+            errorNotifier->deleteLater();
+            errorNotifier = 0;
+        }
+#endif
+    }
+
+    GovernedProcess *process;
+#ifndef Q_OS_WIN
+    QSocketNotifier *outputNotifier;
+    QSocketNotifier *errorNotifier;
+#endif
+    QString program;
+    QStringList arguments;
+    QProcessEnvironment environment;
+    QString workingDirectory;
+    QByteArray stdinData;
+    bool processExited;
+    bool processFinished;
+    bool inputRequested;
+    bool inputClosing;
+};
+
+// ==============================
+// DEADLINE WHEEL CLASS DEFINITION:
+// ==============================
+// One timer wheel for the deadlines of all script jobs.
+// Every slot of the wheel is one millisecond and deadlines farther
+// than one turn wait the remaining turns in their slot, so
+// arming and cancelling a deadline are single hash operations.
+// The wheel is driven by one timer running only while deadlines are armed.
+// Expired deadlines are reported to 'deadlineExpiredSlot(int)' of their target.
+class DeadlineWheel : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void tickSlot()
+    {
+        QList<QPair<QPointer<QObject>, int> > expiredDeadlines;
+
+        qint64 currentTime = clock.elapsed();
+        while (processedTime < currentTime and deadlineSlots.size() > 0) {
+            processedTime++;
+            QHash<int, DeadlineEntry> &wheelSlot =
+                    wheel[(int) (processedTime % wheelSize)];
+
+            QMutableHashIterator<int, DeadlineEntry> iterator(wheelSlot);
+            while (iterator.hasNext()) {
+                iterator.next();
+                if (iterator.value().turns > 0) {
+                    iterator.value().turns--;
+                } else {
+                    expiredDeadlines.append(
+                                qMakePair(iterator.value().target,
+                                          iterator.value().kind));
+                    deadlineSlots.remove(iterator.key());
+                    iterator.remove();
+                }
+            }
+        }
+        processedTime = currentTime;
+
+        if (deadlineSlots.size() == 0) {
+            tickTimer.stop();
+        }
+
+        // Targets may arm or cancel deadlines while they are notified:
+        for (int index = 0; index < expiredDeadlines.length(); index++) {
+            if (!expiredDeadlines.at(index).first.isNull()) {
+                QMetaObject::invokeMethod(
+                            expiredDeadlines.at(index).first,
+                            "deadlineExpiredSlot",
+                            Qt::DirectConnection,
+                            Q_ARG(int, expiredDeadlines.at(index).second));
+            }
+        }
+    }
+
+public:
+    DeadlineWheel();
+
+    static DeadlineWheel *instance()
+    {
+        static DeadlineWheel *deadlineWheel = new DeadlineWheel();
+        return deadlineWheel;
+    }
+
+    // Returns the ID used to cancel the deadline:
+    int arm(QObject *target, int kind, int milliseconds)
+    {
+        if (deadlineSlots.size() == 0) {
+            processedTime = clock.elapsed();
+            tickTimer.start();
+        }
+
+        qint64 expiryTime = clock.elapsed() + qMax(1, milliseconds);
+
+        DeadlineEntry entry;
+        entry.target = target;
+        entry.kind = kind;
+        entry.turns = (int) ((expiryTime - processedTime - 1) / wheelSize);
+
+        int deadlineId = ++lastDeadlineId;
+        int slotIndex = (int) (expiryTime % wheelSize);
+        wheel[slotIndex].insert(deadlineId, entry);
+        deadlineSlots.insert(deadlineId, slotIndex);
+
+        return deadlineId;
+    }
+
+    void cancel(int deadlineId)
+    {
+        QHash<int, int>::iterator slotIterator =
+                deadlineSlots.find(deadlineId);
+        if (slotIterator != deadlineSlots.end()) {
+            wheel[slotIterator.value()].remove(deadlineId);
+            deadlineSlots.erase(slotIterator);
+        }
+    }
+
+private:
+    struct DeadlineEntry
+    {
+        QPointer<QObject> target;
+        int kind;
+        int turns;
+    };
+
+    static const int wheelSize = 4096;
+    static const int tickInterval = 10;
+
+    QVector<QHash<int, DeadlineEntry> > wheel;
+    QHash<int, int> deadlineSlots;
+    QElapsedTimer clock;
+    qint64 processedTime;
+    QTimer tickTimer;
+    int lastDeadlineId;
+};
+
+// ==============================
+// SCRIPT JOB CLASS DEFINITION:
+// ==============================
+// One running script of a page.
+// Every job owns its process or script request, its output buffers,
+// its target frame, its output mode and its deadline, so
+// several scripts can feed different frames of the same window.
+class ScriptJob : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void outputSignal(QByteArray outputData);
+    void errorSignal(QByteArray errorData);
+    void finishedSignal();
+    void timeoutSignal();
+    void renderSignal();
+
+public slots:
+    // Output of the script process or request read by the I/O thread:
+    void drainSlot()
+    {
+        if (scriptWorker == 0) {
+            return;
+        }
+
+        scriptWorker->acknowledgeNotification();
+
+        ScriptPipeChunk chunk;
+        while (scriptWorker->ringBuffer.pop(chunk)) {
+            if (chunk.channel == ScriptPipeChunk::OutputChannel) {
+                outputArrived(true);
+                outputReceived = true;
+                if (chunk.headersComplete == true) {
+                    responseParser.copyHeaders(&scriptWorker->responseParser);
+                }
+                outputText = chunk.text;
+                emit outputSignal(chunk.data);
+            } else if (chunk.channel == ScriptPipeChunk::ErrorChannel) {
+                outputArrived(false);
+                errorText = chunk.text;
+                emit errorSignal(chunk.data);
+            } else {
+                workerRunning = false;
+                jobFinishedSlot();
+                return;
+            }
+        }
+
+        // A worker stops reading, when the ring buffer is almost full:
+        if (scriptWorker->takeResumeRequest()) {
+            QMetaObject::invokeMethod(scriptWorker, "resumeSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    void jobFinishedSlot()
+    {
+        if (jobFinished == false) {
+            jobFinished = true;
+            cancelDeadlines();
+            emit finishedSignal();
+        }
+    }
+
+    // Processes and script requests are stopped the same way and
+    // both report their end through finishedSignal():
+    void abortSlot()
+    {
+        // Jobs still waiting in the scheduler queue end at once:
+        if (launchPending == true) {
+            launchPending = false;
+            jobFinishedSlot();
+            return;
+        }
+        if (workerRunning == true) {
+            QMetaObject::invokeMethod(scriptWorker, "abortSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    // Scripts reporting errors are left to finish and show them:
+    void deadlineExpiredSlot(int deadline)
+    {
+        if (deadline == FirstByteDeadline) {
+            firstByteDeadlineId = 0;
+        } else if (deadline == IdleOutputDeadline) {
+            idleOutputDeadlineId = 0;
+        } else if (deadline == TotalDeadline) {
+            totalDeadlineId = 0;
+        }
+
+        if (isRunning() and errorSpool.size() == 0 and
+                expiredDeadline == NoDeadline) {
+            expiredDeadline = (Deadline) deadline;
+            cancelDeadlines();
+            abortSlot();
+            emit timeoutSignal();
+        }
+    }
+
+    // Request bodies are read from WebKit only as fast as
+    // the script reads its STDIN, so they are never held in memory:
+    void uploadNextSlot()
+    {
+        if (uploadChunkPending == true) {
+            return;
+        }
+
+        if (uploadDevice.isNull() or workerRunning == false) {
+            finishUpload();
+            return;
+        }
+
+        QByteArray uploadChunk = uploadDevice->read(uploadChunkSize);
+        if (uploadChunk.size() > 0) {
+            uploadChunkPending = true;
+            uploadedBytes += uploadChunk.size();
+            QMetaObject::invokeMethod(scriptWorker, "writeInputSlot",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(QByteArray, uploadChunk));
+            return;
+        }
+
+        if (uploadDevice->atEnd() or uploadDevice->isSequential() == false) {
+            finishUpload();
+        } else {
+            // Sequential devices may have more data later:
+            QObject::connect(uploadDevice, SIGNAL(readyRead()),
+                             this, SLOT(uploadNextSlot()),
+                             Qt::UniqueConnection);
+        }
+    }
+
+    void uploadWrittenSlot()
+    {
+        uploadChunkPending = false;
+        uploadNextSlot();
+    }
+
+    // Called by the script scheduler, when the job may start:
+    void launchSlot()
+    {
+        if (launchPending == false) {
+            return;
+        }
+        launchPending = false;
+
+        if (forkServerLaunch == true) {
+            attachRequest(ZygoteServer::instance()
+                          ->startRequest(this, launchArguments.first(),
+                                         launchWorkingDirectory,
+                                         launchEnvironment,
+                                         launchStdinData));
+        } else {
+            startProcess(launchProgram, launchArguments, launchEnvironment,
+                         launchWorkingDirectory, launchStdinData);
+            if (!uploadDevice.isNull()) {
+                uploadNextSlot();
+            }
+        }
+
+        armDeadlines();
+    }
+
+public:
+    enum Deadline {
+        NoDeadline,
+        FirstByteDeadline,
+        IdleOutputDeadline,
+        TotalDeadline
+    };
+
+    ScriptJob(QObject *page, QString scriptFullFilePath);
+
+    ~ScriptJob()
+    {
+        cancelDeadlines();
+        if (scriptWorker != 0) {
+            scriptWorker->deleteLater();
+        }
+    }
+
+    // Jobs waiting for the scheduler are also counted as running:
+    bool isRunning()
+    {
+        return (jobFinished == false and
+                (launchPending == true or workerRunning == true));
+    }
+
+    // New processes wait for a free slot of the script scheduler:
+    void scheduleProcess(QString program,
+                         QStringList arguments,
+                         QProcessEnvironment environment,
+                         QString workingDirectory,
+                         QByteArray stdinData)
+    {
+        launchProgram = program;
+        launchArguments = arguments;
+        launchEnvironment = environment;
+        launchWorkingDirectory = workingDirectory;
+        launchStdinData = stdinData;
+        forkServerLaunch = false;
+        launchPending = true;
+    }
+
+    void scheduleForkServerRequest(QString scriptFullFilePath,
+                                   QString workingDirectory,
+                                   QProcessEnvironment environment,
+                                   QByteArray stdinData)
+    {
+        launchArguments = QStringList() << scriptFullFilePath;
+        launchEnvironment = environment;
+        launchWorkingDirectory = workingDirectory;
+        launchStdinData = stdinData;
+        forkServerLaunch = true;
+        launchPending = true;
+    }
+
+    bool isLaunchPending()
+    {
+        return launchPending;
+    }
+
+    bool isLongRunning()
+    {
+        return scriptFullFilePath.contains("longrun");
+    }
+
+    // Scripts of windows the user can see are started first:
+    bool isVisible()
+    {
+        QWebPage *webPage = qobject_cast<QWebPage *>(page);
+        if (webPage == 0 or webPage->view() == 0) {
+            return false;
+        }
+        return (webPage->view()->isVisible() and
+                !webPage->view()->window()->isMinimized());
+    }
+
+    // The process is started and read by the I/O thread:
+    void startProcess(QString program,
+                      QStringList arguments,
+                      QProcessEnvironment environment,
+                      QString workingDirectory,
+                      QByteArray stdinData)
+    {
+        startWorker(new ScriptProcessWorker(this, program, arguments,
+                                            environment, workingDirectory,
+                                            stdinData));
+    }
+
+    // Requests created with this job as their consumer
+    // are started and read by the I/O thread too.
+    // The request body is streamed to them like to processes and
+    // their STDIN is closed after it:
+    void attachRequest(ScriptRequest *request)
+    {
+        executionMode = request->executionMode;
+        startWorker(request);
+        uploadNextSlot();
+    }
+
+    // Timeouts in milliseconds, 0 means no deadline.
+    // Time waiting in the scheduler queue is not counted:
+    void setDeadlines(int firstByteTimeout,
+                      int idleOutputTimeout,
+                      int totalTimeout)
+    {
+        this->firstByteTimeout = firstByteTimeout;
+        this->idleOutputTimeout = idleOutputTimeout;
+        this->totalTimeout = totalTimeout;
+        if (launchPending == false) {
+            armDeadlines();
+        }
+    }
+
+    QString jobId;
+    QObject *page;
+    QString scriptFullFilePath;
+    ScriptPipeWorker *scriptWorker;
+    QString executionMode;
+    QPointer<QWebFrame> targetFrame;
+    QPointer<ScriptReply> reply;
+    bool replyOutput;
+    qint64 outputBytes;
+
+    // Headers and text of the last chunk are
+    // parsed and decoded by the I/O thread.
+    // Output carries only the body of the response:
+    CgiResponseParser responseParser;
+    QString outputText;
+    QString errorText;
+    bool responseRouted;
+    RenderScheduler renderScheduler;
+    QByteArray pendingRenderOutput;
+    QString pendingRenderText;
+    QFile attachmentFile;
+    bool outputReceived;
+    QString outputType;
+    bool outputThemeEnabled;
+    ScriptSpool errorSpool;
+    QElapsedTimer elapsedTimer;
+    Deadline expiredDeadline;
+    bool killed;
+    QPointer<QIODevice> uploadDevice;
+    qint64 uploadedBytes;
+
+    // Output collected for the response cache and
+    // the cached response a stale entry is revalidated for:
+    bool responseCacheable;
+    QString responseCacheKey;
+    QByteArray responseCacheBody;
+    bool responseRevalidated;
+    bool responseNotModified;
+    ScriptResponseCache::CachedResponse revalidatedResponse;
+    QElapsedTimer queueTimer;
+
+private:
+    bool jobFinished;
+    bool workerRunning;
+    bool launchPending;
+    bool forkServerLaunch;
+    QString launchProgram;
+    QStringList launchArguments;
+    QProcessEnvironment launchEnvironment;
+    QString launchWorkingDirectory;
+    QByteArray launchStdinData;
+    int firstByteTimeout;
+    int idleOutputTimeout;
+    int totalTimeout;
+    int firstByteDeadlineId;
+    int idleOutputDeadlineId;
+    int totalDeadlineId;
+    bool uploadChunkPending;
+
+    static const int uploadChunkSize = 65536;
+
+    void finishUpload()
+    {
+        if (!uploadDevice.isNull()) {
+            QObject::disconnect(uploadDevice, SIGNAL(readyRead()),
+                                this, SLOT(uploadNextSlot()));
+            uploadDevice = 0;
+        }
+        if (workerRunning == true) {
+            QMetaObject::invokeMethod(scriptWorker, "closeInputSlot",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    void startWorker(ScriptPipeWorker *worker)
+    {
+        scriptWorker = worker;
+        scriptWorker->htmlTextOutput = (replyOutput == false);
+        scriptWorker->moveToThread(ScriptIoThread::instance());
+        workerRunning = true;
+        QMetaObject::invokeMethod(scriptWorker, "startSlot",
+                                  Qt::QueuedConnection);
+    }
+
+    void armDeadlines()
+    {
+        cancelDeadlines();
+        DeadlineWheel *deadlineWheel = DeadlineWheel::instance();
+        if (firstByteTimeout > 0 and outputReceived == false) {
+            firstByteDeadlineId =
+                    deadlineWheel->arm(this, FirstByteDeadline,
+                                       firstByteTimeout);
+        }
+        if (idleOutputTimeout > 0) {
+            idleOutputDeadlineId =
+                    deadlineWheel->arm(this, IdleOutputDeadline,
+                                       idleOutputTimeout);
+        }
+        if (totalTimeout > 0) {
+            totalDeadlineId =
+                    deadlineWheel->arm(this, TotalDeadline, totalTimeout);
+        }
+    }
+
+    void cancelDeadlines()
+    {
+        cancelDeadline(firstByteDeadlineId);
+        cancelDeadline(idleOutputDeadlineId);
+        cancelDeadline(totalDeadlineId);
+    }
+
+    void cancelDeadline(int &deadlineId)
+    {
+        if (deadlineId != 0) {
+            DeadlineWheel::instance()->cancel(deadlineId);
+            deadlineId = 0;
+        }
+    }
+
+    // Output of both channels keeps the script alive,
+    // only its standard output counts as the first byte:
+    void outputArrived(bool standardOutput)
+    {
+        if (standardOutput == true) {
+            cancelDeadline(firstByteDeadlineId);
+        }
+        if (idleOutputDeadlineId != 0) {
+            cancelDeadline(idleOutputDeadlineId);
+            idleOutputDeadlineId =
+                    DeadlineWheel::instance()->arm(this, IdleOutputDeadline,
+                                                   idleOutputTimeout);
+        }
+    }
+};
+
+// ==============================
+// SCRIPT JOB REGISTRY CLASS DEFINITION:
+// ==============================
+// All running script jobs of all windows.
+// Jobs are found by ID, which kill URLs can address, and
+// the indexes by page and by script path replace
+// the lists of running scripts kept before.
+class ScriptJobRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScriptJobRegistry();
+
+    static ScriptJobRegistry *instance()
+    {
+        static ScriptJobRegistry *scriptJobRegistry = new ScriptJobRegistry();
+        return scriptJobRegistry;
+    }
+
+    QString registerJob(ScriptJob *job)
+    {
+        lastJobId++;
+        job->jobId = QString::number(lastJobId);
+
+        jobs.insert(job->jobId, job);
+        jobsByPage.insert(job->page, job);
+        jobsByScript.insert(job->scriptFullFilePath, job);
+
+        return job->jobId;
+    }
+
+    void unregisterJob(ScriptJob *job)
+    {
+        jobs.remove(job->jobId);
+        jobsByPage.remove(job->page, job);
+        jobsByScript.remove(job->scriptFullFilePath, job);
+    }
+
+    ScriptJob *job(QString jobId)
+    {
+        return jobs.value(jobId, 0);
+    }
+
+    QList<ScriptJob *> jobsForPage(QObject *page)
+    {
+        return jobsByPage.values(page);
+    }
+
+    QList<ScriptJob *> jobsForScript(QString scriptFullFilePath)
+    {
+        return jobsByScript.values(scriptFullFilePath);
+    }
+
+    int jobCount()
+    {
+        return jobs.size();
+    }
+
+    int jobCountForPage(QObject *page)
+    {
+        return jobsByPage.count(page);
+    }
+
+private:
+    QHash<QString, ScriptJob *> jobs;
+    QMultiHash<QObject *, ScriptJob *> jobsByPage;
+    QMultiHash<QString, ScriptJob *> jobsByScript;
+    qint64 lastJobId;
+};
+
+// ==============================
+// SCRIPT SCHEDULER CLASS DEFINITION:
+// ==============================
+// Starts the new script processes of all windows.
+// At most 'perl_maximum_running_scripts' jobs run at once and
+// the rest wait in a queue, where interactive scripts go before
+// long-running ones and scripts of visible windows before hidden ones.
+// Long-running scripts never take the last free slot and,
+// where the only slot is taken by one, interactive scripts
+// go one over the limit, so a click always gets an answer.
+class ScriptScheduler : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void jobFinishedSlot()
+    {
+        releaseJob(sender());
+    }
+
+    void jobDestroyedSlot(QObject *job)
+    {
+        releaseJob(job);
+    }
+
+public:
+    ScriptScheduler();
+
+    static ScriptScheduler *instance()
+    {
+        static ScriptScheduler *scriptScheduler = new ScriptScheduler();
+        return scriptScheduler;
+    }
+
+    void submitJob(ScriptJob *job)
+    {
+        QObject::connect(job, SIGNAL(finishedSignal()),
+                         this, SLOT(jobFinishedSlot()));
+        QObject::connect(job, SIGNAL(destroyed(QObject*)),
+                         this, SLOT(jobDestroyedSlot(QObject*)));
+
+        job->queueTimer.start();
+        queuedJobs.append(job);
+
+        dispatchJobs();
+
+        if (queuedJobs.contains(job)) {
+            qDebug() << "Script queued:" << job->scriptFullFilePath;
+            qDebug() << "Script queue depth:" << queuedJobs.length();
+            qDebug() << "===============";
+        }
+    }
+
+private:
+    void dispatchJobs()
+    {
+        while (!queuedJobs.isEmpty()) {
+            bool longRunningSlotFree =
+                    (runningJobs.length() < maximumRunningJobs and
+                     (maximumRunningJobs == 1 or
+                      longRunningJobs.length() < maximumRunningJobs - 1));
+            bool interactiveSlotFree =
+                    (runningJobs.length() - longRunningJobs.length() <
+                     qMax(maximumRunningJobs - longRunningJobs.length(), 1));
+
+            int nextJobIndex = -1;
+            int nextJobClass = 4;
+
+            for (int index = 0; index < queuedJobs.length(); index++) {
+                ScriptJob *job = queuedJobs.at(index);
+
+                if (job->isLongRunning() ? !longRunningSlotFree :
+                        !interactiveSlotFree) {
+                    continue;
+                }
 
-            qDebug() << "Allowed link:" << request.url().toString();
-            qDebug() << "===============";
+                // Older jobs win within the same priority class:
+                int priorityClass = (job->isLongRunning() ? 2 : 0)
+                        + (job->isVisible() ? 0 : 1);
+                if (priorityClass < nextJobClass) {
+                    nextJobClass = priorityClass;
+                    nextJobIndex = index;
+                }
+            }
 
-            QNetworkRequest networkRequest;
-            networkRequest.setUrl(request.url());
+            if (nextJobIndex < 0) {
+                return;
+            }
 
-            return QNetworkAccessManager::createRequest
-                    (QNetworkAccessManager::GetOperation,
-                     QNetworkRequest(networkRequest));
-        } else {
-            qDebug() << "Not allowed link:" << request.url().toString();
-            qDebug() << "===============";
+            ScriptJob *job = queuedJobs.takeAt(nextJobIndex);
+            runningJobs.append(job);
+            if (job->isLongRunning()) {
+                longRunningJobs.append(job);
+            }
 
-            QNetworkRequest networkRequest;
-            networkRequest.setUrl
-                    (QUrl::fromLocalFile
-                     ((qApp->property("helpDirectory").toString())
-                      + QDir::separator()
-                      + "forbidden.htm"));
+            qDebug() << "Script launched:" << job->scriptFullFilePath;
+            qDebug() << "Script queue wait:"
+                     << job->queueTimer.elapsed() << "msecs";
+            qDebug() << "Script queue depth:" << queuedJobs.length();
+            qDebug() << "Running scripts:" << runningJobs.length()
+                     << "of" << maximumRunningJobs;
+            qDebug() << "===============";
 
-            return QNetworkAccessManager::createRequest
-                    (QNetworkAccessManager::GetOperation,
-                     QNetworkRequest(networkRequest));
+            job->launchSlot();
         }
+    }
 
-        return QNetworkAccessManager::createRequest(operation, request);
+    // Queued jobs may also end, when they are killed before their start:
+    void releaseJob(QObject *job)
+    {
+        bool released = (runningJobs.removeAll(job) > 0);
+        longRunningJobs.removeAll(job);
+        queuedJobs.removeAll(static_cast<ScriptJob *>(job));
+
+        if (released == true) {
+            dispatchJobs();
+        }
     }
+
+    int maximumRunningJobs;
+    QList<ScriptJob *> queuedJobs;
+    QList<QObject *> runningJobs;
+    QList<QObject *> longRunningJobs;
 };
 
 // ==============================
@@ -352,11 +7084,7 @@ public slots:
                 (!htmlInput.contains("current.css"))) {
             QString cssLink;
             cssLink.append("</title>\n");
-            cssLink.append("<link rel=\"stylesheet\" type=\"text/css\"");
-            cssLink.append("href=\"");
-            cssLink.append(PSEUDO_DOMAIN);
-            cssLink.append(qApp->property("defaultThemeDirectoryName").toString());
-            cssLink.append("/current.css\" media=\"all\" />");
+            cssLink.append(themeLink());
 
             htmlInput.replace("</title>", cssLink);
 
@@ -366,21 +7094,15 @@ public slots:
         }
     }
 
-    void httpHeaderCleaner(QString input)
+    QString themeLink()
     {
-        httpHeadersCleanedHtml = "";
-
-        if (input.contains("<!DOCTYPE")) {
-            QString htmlContent = input.section("<!DOCTYPE", 1, 1);
-            httpHeadersCleanedHtml = "<!DOCTYPE";
-            httpHeadersCleanedHtml.append(htmlContent);
-        }
-
-        if (input.contains("<html>")) {
-            QString htmlContent = input.section("<html>", 1, 1);
-            httpHeadersCleanedHtml = "<html>";
-            httpHeadersCleanedHtml.append(htmlContent);
-        }
+        QString cssLink;
+        cssLink.append("<link rel=\"stylesheet\" type=\"text/css\"");
+        cssLink.append("href=\"");
+        cssLink.append(PSEUDO_DOMAIN);
+        cssLink.append(qApp->property("defaultThemeDirectoryName").toString());
+        cssLink.append("/current.css\" media=\"all\" />");
+        return cssLink;
     }
 
     void setThemeSlot(QString theme)
@@ -478,13 +7200,38 @@ public slots:
 
     void checkFileExistenceSlot(QString fullFilePath)
     {
-        QFile file(QDir::toNativeSeparators(fullFilePath));
-        if (!file.exists()) {
+        if (!RootIndex::instance()->exists(
+                    QDir::toNativeSeparators(fullFilePath))) {
             missingFileMessageSlot();
         }
     }
 
-    void startScriptSlot(QUrl url, QByteArray postDataArray)
+    // Scripts and debugger sessions waiting for the ZIP package are
+    // started again - those still waiting are queued again:
+    void packageExtractedSlot()
+    {
+#if ZIP_SUPPORT == 1
+        QList<QUrl> scriptUrls = packagedScriptUrls;
+        QList<QPointer<ScriptReply> > scriptReplies = packagedScriptReplies;
+        QList<QUrl> debuggerUrls = packagedDebuggerUrls;
+        packagedScriptUrls.clear();
+        packagedScriptReplies.clear();
+        packagedDebuggerUrls.clear();
+
+        for (int index = 0; index < scriptUrls.size(); index++) {
+            if (!scriptReplies.at(index).isNull() and
+                    !scriptReplies.at(index)->isClosing()) {
+                startScriptSlot(scriptUrls.at(index),
+                                scriptReplies.at(index).data());
+            }
+        }
+        foreach (QUrl debuggerUrl, debuggerUrls) {
+            startPerlDebuggerSlot(debuggerUrl);
+        }
+#endif
+    }
+
+    void startScriptSlot(QUrl url, ScriptReply *reply)
     {
         qDebug() << "Script URL:" << url.toString();
 
@@ -499,23 +7246,52 @@ public slots:
         scriptFullFilePath = QDir::toNativeSeparators
                 ((qApp->property("rootDirName").toString()) + relativeFilePath);
 
+#if ZIP_SUPPORT == 1
+        // Perl must find scripts from the ZIP package on disk.
+        // The script is started again, when its folder is extracted:
+        if (!ZipPackage::instance()->prepareScript(scriptFullFilePath, this,
+                                                   "packageExtractedSlot")) {
+            packagedScriptUrls.append(url);
+            packagedScriptReplies.append(QPointer<ScriptReply>(reply));
+            return;
+        }
+#endif
+
         QString queryString = url.toString(QUrl::RemoveScheme
                                            | QUrl::RemoveAuthority
                                            | QUrl::RemovePath)
                 .replace("?", "")
                 .replace("//", "");
 
-        scriptKilled = false;
-
-        QString postData(postDataArray);
+        // Large request bodies are never read here,
+        // only their beginning is searched for kill requests:
+        QString postData(reply->uploadPrefix());
 
         if (queryString.contains("action=kill") or
                 postData.contains("action=kill")) {
-            if (scriptHandler.isOpen()) {
+            // A single job is addressed by 'job=<ID>',
+            // otherwise all jobs of the script are terminated:
+            QList<ScriptJob *> jobsToKill;
+            // Names like 'myjob' are other parameters:
+            QRegExp jobIdRegExp("(^|&)job=(\\d+)(&|$)");
+            if (jobIdRegExp.indexIn(queryString + "&" + postData) >= 0) {
+                ScriptJob *job = ScriptJobRegistry::instance()
+                        ->job(jobIdRegExp.cap(2));
+                if (job != 0) {
+                    jobsToKill.append(job);
+                }
+            } else {
+                jobsToKill = ScriptJobRegistry::instance()
+                        ->jobsForScript(scriptFullFilePath);
+            }
+
+            if (jobsToKill.length() > 0) {
                 qDebug() << "Script is going to be terminated by user request.";
 
-                scriptHandler.close();
-                scriptKilled = true;
+                foreach (ScriptJob *job, jobsToKill) {
+                    job->killed = true;
+                    job->abortSlot();
+                }
 
                 QMessageBox scriptKilledMessageBox;
                 scriptKilledMessageBox.setWindowModality(Qt::WindowModal);
@@ -528,8 +7304,6 @@ public slots:
                 scriptKilledMessageBox.setDefaultButton(QMessageBox::Ok);
                 scriptKilledMessageBox.exec();
             } else {
-                scriptKilled = true;
-
                 QMessageBox scriptAlreadyFinishedMessageBox;
                 scriptAlreadyFinishedMessageBox
                         .setWindowModality(Qt::WindowModal);
@@ -544,8 +7318,13 @@ public slots:
                 scriptAlreadyFinishedMessageBox.setDefaultButton(QMessageBox::Ok);
                 scriptAlreadyFinishedMessageBox.exec();
             }
+
+            // Kill requests leave the current document in place:
+            reply->cancelSlot();
         } else {
             bool sourceEnabled;
+            bool scriptOutputThemeEnabled;
+            QString scriptOutputType;
 
             if (scriptFullFilePath.contains("longrun")) {
                 // Default values for long-running scripts:
@@ -596,12 +7375,13 @@ public slots:
 
             checkFileExistenceSlot(scriptFullFilePath);
 
-            FileDetector fileDetector;
-            fileDetector.defineInterpreter(scriptFullFilePath);
+            QString fileType =
+                    RootIndex::instance()->fileType(scriptFullFilePath);
 
             qDebug() << "File path:" << scriptFullFilePath;
-            qDebug() << "Extension:" << fileDetector.extension;
-            qDebug() << "Interpreter:" << fileDetector.interpreter;
+            qDebug() << "Extension:"
+                     << FileDetector::extension(scriptFullFilePath);
+            qDebug() << "Interpreter:" << fileType;
 
             if (queryString.length() > 0) {
                 scriptEnvironment.insert("REQUEST_METHOD", "GET");
@@ -609,95 +7389,82 @@ public slots:
                 qDebug() << "Query string:" << queryString;
             }
 
-            if (postData.length() > 0) {
+            if (reply->hasUpload()) {
                 scriptEnvironment.insert("REQUEST_METHOD", "POST");
-                QString postDataSize = QString::number(postData.size());
-                scriptEnvironment.insert("CONTENT_LENGTH", postDataSize);
-                qDebug() << "POST data:" << postData;
+                if (reply->uploadSize >= 0) {
+                    scriptEnvironment.insert(
+                                "CONTENT_LENGTH",
+                                QString::number(reply->uploadSize));
+                }
+                // Multipart bodies carry their boundary here:
+                if (reply->uploadType.length() > 0) {
+                    scriptEnvironment.insert("CONTENT_TYPE",
+                                             reply->uploadType);
+                }
+                qDebug() << "POST data size:" << reply->uploadSize;
+                qDebug() << "POST data type:" << reply->uploadType;
+                qDebug() << "POST data beginning:" << postData.left(256);
             }
 
-            scriptHandler.setProcessEnvironment(scriptEnvironment);
-
             QFileInfo scriptAbsoluteFilePath(
                         QDir::toNativeSeparators(scriptFullFilePath));
             QString scriptDirectory = scriptAbsoluteFilePath.absolutePath();
-            scriptHandler.setWorkingDirectory(scriptDirectory);
             qDebug() << "Working directory:"
                      << QDir::toNativeSeparators(scriptDirectory);
             qDebug() << "===============";
 
-            if (!scriptHandler.isOpen()) {
-                if (sourceEnabled == true) {
-                    QString sourceFilepath =
-                            QDir::toNativeSeparators(scriptFullFilePath);
-
-                    QStringList sourceViewerCommandLine;
-                    sourceViewerCommandLine = sourceViewerMandatoryCommandLine;
-                    sourceViewerCommandLine.append(sourceFilepath);
-
-                    scriptHandler.start((qApp->property("perlInterpreter")
-                                         .toString()),
-                                        sourceViewerCommandLine,
-                                        QProcess::Unbuffered
-                                        | QProcess::ReadWrite);
-
-                    runningScriptsInCurrentWindowList.append(sourceFilepath);
-
-                    QStringList runningScriptsGlobalCurrentList =
-                            qApp->property("runningScriptsGlobalList")
-                            .toStringList();
-                    runningScriptsGlobalCurrentList.append(sourceFilepath);
-                    qApp->setProperty("runningScriptsGlobalList",
-                                      runningScriptsGlobalCurrentList);
-                } else {
-                    if (SCRIPT_CENSORING == 0) {
-                        scriptHandler.start((qApp->property("perlInterpreter")
-                                             .toString()),
-                                            QStringList() <<
-                                            QDir::toNativeSeparators
-                                            (scriptFullFilePath),
-                                            QProcess::Unbuffered
-                                            | QProcess::ReadWrite);
-                    }
+            if (!Page::mainFrame()->childFrames().contains(targetFrame)) {
+                targetFrame = Page::currentFrame();
+            }
 
-                    if (SCRIPT_CENSORING == 1) {
-                        // 'censor.pl' is compiled into the resources of
-                        // the binary file and called from there.
-                        QString censorScriptFileName(":/scripts/censor.pl");
-                        QFile censorScriptFile(censorScriptFileName);
-                        censorScriptFile.open(QIODevice::ReadOnly
-                                              | QIODevice::Text);
-                        QTextStream stream(&censorScriptFile);
-                        QString censorScriptContents = stream.readAll();
-                        censorScriptFile.close();
-
-                        scriptHandler
-                                .start((qApp->property("perlInterpreter")
-                                        .toString()),
-                                       QStringList()
-                                       << "-se"
-                                       << censorScriptContents
-                                       << "--"
-                                       << QDir::toNativeSeparators(
-                                           scriptFullFilePath),
-                                       QProcess::Unbuffered
-                                       | QProcess::ReadWrite);
+            // CGI-like scripts answer their own network replies and
+            // may run concurrently, for example for several AJAX calls.
+            // Long-running scripts and scripts writing directly to a frame
+            // may run in several frames at once, but only once in a frame:
+            bool scriptAlreadyStarted = false;
+            if (scriptFullFilePath.contains("longrun") or
+                    scriptOutputType == "latest") {
+                foreach (ScriptJob *runningJob,
+                         ScriptJobRegistry::instance()
+                         ->jobsForScript(scriptFullFilePath)) {
+                    if (runningJob->page == this and
+                            runningJob->targetFrame == targetFrame) {
+                        scriptAlreadyStarted = true;
                     }
+                }
+            }
 
-                    runningScriptsInCurrentWindowList.append(scriptFullFilePath);
-
-                    QStringList runningScriptsGlobalCurrentList =
-                            qApp->property("runningScriptsGlobalList")
-                            .toStringList();
-                    runningScriptsGlobalCurrentList.append(scriptFullFilePath);
-                    qApp->setProperty("runningScriptsGlobalList",
-                                      runningScriptsGlobalCurrentList);
+            // Fresh cached responses are displayed without
+            // starting the script at all:
+            bool responseCacheable =
+                    (ScriptResponseCache::instance()->isEnabled() and
+                     !reply->hasUpload() and sourceEnabled == false and
+                     scriptOutputType != "latest" and
+                     !scriptFullFilePath.contains("longrun"));
+            QString responseCacheKey;
+            ScriptResponseCache::CachedResponse cachedResponse;
+            ScriptResponseCache::Freshness cachedResponseFreshness =
+                    ScriptResponseCache::Missing;
+            if (responseCacheable == true and scriptAlreadyStarted == false) {
+                responseCacheKey = ScriptResponseCache::cacheKey(
+                            scriptFullFilePath, queryString);
+                cachedResponseFreshness = ScriptResponseCache::instance()
+                        ->lookup(responseCacheKey, cachedResponse);
+            }
 
-                    if (postData.length() > 0) {
-                        scriptHandler.write(postDataArray);
-                    }
+            // Scripts are censored before any process is started:
+            ScriptCensor scriptCensor;
+            if (SCRIPT_CENSORING == 1 and sourceEnabled == false and
+                    scriptAlreadyStarted == false and
+                    cachedResponseFreshness != ScriptResponseCache::Fresh) {
+                if ((qApp->property("fastCgiScripts").toStringList())
+                        .contains(scriptFullFilePath)) {
+                    scriptCensor.allowResponderModules();
                 }
-            } else {
+                scriptCensor.censorScript(scriptFullFilePath);
+            }
+
+            if (scriptAlreadyStarted == true) {
                 qDebug() << "Script already started:" << scriptFullFilePath;
                 qDebug() << "===============";
 
@@ -713,16 +7480,178 @@ public slots:
                                  + scriptFullFilePath);
                 scriptAlreadyStartedMessageBox.setDefaultButton(QMessageBox::Ok);
                 scriptAlreadyStartedMessageBox.exec();
-            }
 
-            scriptTimedOut = false;
+                reply->cancelSlot();
+            } else if (cachedResponseFreshness == ScriptResponseCache::Fresh) {
+                qDebug() << "Script response from cache:" << responseCacheKey;
+                qDebug() << "===============";
+
+                if (scriptOutputThemeEnabled == true) {
+                    reply->themeLink = themeLink().toUtf8();
+                }
+                reply->setCachedResponse(cachedResponse);
+                reply->writeBodySlot(cachedResponse.body);
+                reply->finishSlot();
+            } else if (SCRIPT_CENSORING == 1 and sourceEnabled == false and
+                       scriptCensor.approved == false) {
+                qDebug() << "Script blocked by censor:"
+                         << scriptFullFilePath;
+                qDebug() << "===============";
+
+                themeLinker(scriptCensor.violationsHtml());
+                reply->writeBodySlot(cssLinkedHtml.toUtf8());
+                reply->finishSlot();
+            } else {
+                ScriptJob *job = new ScriptJob(this, scriptFullFilePath);
+                job->targetFrame = targetFrame;
+                job->outputType = scriptOutputType;
+                job->outputThemeEnabled = scriptOutputThemeEnabled;
+
+                // Every new output replaces the whole document
+                // in the 'latest' output mode, which is done with setHtml().
+                // All other output is streamed through the network reply:
+                if (scriptOutputType == "latest") {
+                    reply->cancelSlot();
+                } else {
+                    if (scriptOutputThemeEnabled == true) {
+                        reply->themeLink = themeLink().toUtf8();
+                    }
+                    job->reply = reply;
+                    job->replyOutput = true;
+                }
+
+                // Stale cached responses are revalidated by the script:
+                if (responseCacheable == true) {
+                    job->responseCacheable = true;
+                    job->responseCacheKey = responseCacheKey;
+                    if (cachedResponseFreshness == ScriptResponseCache::Stale) {
+                        job->responseRevalidated = true;
+                        job->revalidatedResponse = cachedResponse;
+                        if (cachedResponse.entityTag.size() > 0) {
+                            scriptEnvironment.insert(
+                                        "HTTP_IF_NONE_MATCH",
+                                        QString::fromLatin1(
+                                            cachedResponse.entityTag));
+                        }
+                        if (cachedResponse.lastModified.size() > 0) {
+                            scriptEnvironment.insert(
+                                        "HTTP_IF_MODIFIED_SINCE",
+                                        QString::fromLatin1(
+                                            cachedResponse.lastModified));
+                        }
+                    }
+                }
+
+                // Scripts can build kill links for their own job:
+                QString jobId = ScriptJobRegistry::instance()->registerJob(job);
+                scriptEnvironment.insert("PEB_SCRIPT_JOB_ID", jobId);
+                qDebug() << "Script job ID:" << jobId;
+
+                QObject::connect(job, SIGNAL(outputSignal(QByteArray)),
+                                 this, SLOT(scriptOutputDataSlot(QByteArray)));
+                QObject::connect(job, SIGNAL(errorSignal(QByteArray)),
+                                 this, SLOT(scriptErrorDataSlot(QByteArray)));
+                QObject::connect(job, SIGNAL(finishedSignal()),
+                                 this, SLOT(scriptFinishedSlot()));
+                QObject::connect(job, SIGNAL(timeoutSignal()),
+                                 this, SLOT(scriptTimeoutSlot()));
+                QObject::connect(job, SIGNAL(renderSignal()),
+                                 this, SLOT(renderJobOutputSlot()));
+
+                job->elapsedTimer.start();
+
+                if (sourceEnabled == true) {
+                    QString sourceFilepath =
+                            QDir::toNativeSeparators(scriptFullFilePath);
+
+                    QStringList sourceViewerCommandLine;
+                    sourceViewerCommandLine = sourceViewerMandatoryCommandLine;
+                    sourceViewerCommandLine.append(sourceFilepath);
+
+                    job->scheduleProcess((qApp->property("perlInterpreter")
+                                          .toString()),
+                                         sourceViewerCommandLine,
+                                         scriptEnvironment,
+                                         scriptDirectory,
+                                         QByteArray());
+                } else if ((qApp->property("fastCgiScripts").toStringList())
+                           .contains(scriptFullFilePath)) {
+                    // Persistent FastCGI responders are fed through
+                    // their local sockets and no new process is started.
+                    // The request body is streamed as STDIN records:
+                    job->uploadDevice = reply->uploadDevice;
+                    job->attachRequest(
+                                FastCgiResponder::responderForScript(
+                                    scriptFullFilePath)
+                                ->startRequest(job, scriptEnvironment,
+                                               QByteArray()));
+#if EMBEDDED_PERL == 1
+                } else if (EmbeddedPerl::instance()->isReady() and
+                           (qApp->property("embeddedScripts").toStringList())
+                           .contains(scriptFullFilePath)) {
+                    // Trusted scripts run inside the browser process and
+                    // take the whole request body at once:
+                    job->attachRequest(
+                                EmbeddedPerl::instance()
+                                ->startRequest(
+                                    job,
+                                    QDir::toNativeSeparators(scriptFullFilePath),
+                                    scriptEnvironment,
+                                    reply->readUpload()));
+#endif
+                } else if (ZygoteServer::instance()->isReady()) {
+                    // Ordinary scripts are forked from the fork-server,
+                    // where the most used modules are already loaded.
+                    // The request body is streamed as I records:
+                    job->scheduleForkServerRequest(
+                                QDir::toNativeSeparators(scriptFullFilePath),
+                                scriptDirectory,
+                                scriptEnvironment,
+                                QByteArray());
+                    job->uploadDevice = reply->uploadDevice;
+                } else {
+                    QStringList scriptCommandLine;
+
+                    if (SCRIPT_CENSORING == 1) {
+                        // Approved scripts are started with
+                        // the prohibited core functions masked:
+                        scriptCommandLine
+                                << scriptCensor.opsCommandLineArgument();
+                    }
+
+                    scriptCommandLine
+                            << QDir::toNativeSeparators(scriptFullFilePath);
+
+                    job->scheduleProcess((qApp->property("perlInterpreter")
+                                          .toString()),
+                                         scriptCommandLine,
+                                         scriptEnvironment,
+                                         scriptDirectory,
+                                         QByteArray());
+
+                    // The request body is streamed to STDIN:
+                    job->uploadDevice = reply->uploadDevice;
+                }
+
+                // New processes are started by the scheduler,
+                // FastCGI and embedded requests are already running:
+                if (job->isLaunchPending()) {
+                    ScriptScheduler::instance()->submitJob(job);
+                }
 
-            if (!scriptFullFilePath.contains("longrun")) {
-                int scriptTimeoutNumeric =
-                        (qApp->property("scriptTimeout").toInt());
-                int maximumTimeMilliseconds = scriptTimeoutNumeric * 1000 ;
-                QTimer::singleShot(maximumTimeMilliseconds,
-                                   this, SLOT(scriptTimeoutSlot()));
+                // Long-running scripts have only the idle output deadline:
+                int firstByteTimeout = 0;
+                int totalTimeout = 0;
+                if (!job->isLongRunning()) {
+                    firstByteTimeout =
+                            (qApp->property("firstByteTimeout").toInt());
+                    totalTimeout =
+                            (int) ((qApp->property("scriptTimeout")
+                                    .toDouble()) * 1000);
+                }
+                job->setDeadlines(firstByteTimeout,
+                                  (qApp->property("idleOutputTimeout").toInt()),
+                                  totalTimeout);
             }
 
             QWebSettings::clearMemoryCaches();
@@ -731,96 +7660,159 @@ public slots:
             scriptEnvironment.remove("FILE_TO_CREATE");
             scriptEnvironment.remove("FOLDER_TO_OPEN");
             scriptEnvironment.remove("REQUEST_METHOD");
+            scriptEnvironment.remove("PEB_SCRIPT_JOB_ID");
+            scriptEnvironment.remove("HTTP_IF_NONE_MATCH");
+            scriptEnvironment.remove("HTTP_IF_MODIFIED_SINCE");
 
             if (queryString.length() > 0) {
                 scriptEnvironment.remove("QUERY_STRING");
             }
 
-            if (postData.length() > 0) {
+            if (reply->hasUpload()) {
                 scriptEnvironment.remove("CONTENT_LENGTH");
+                scriptEnvironment.remove("CONTENT_TYPE");
             }
         }
     }
 
-    void scriptOutputSlot()
+    void scriptOutputDataSlot(QByteArray outputData)
     {
-        qDebug() << QDateTime::currentMSecsSinceEpoch()
-                 << "msecs from epoch: output from" << scriptFullFilePath;
-
-        QString output = scriptHandler.readAllStandardOutput();
-
-        if (scriptOutputType == "accumulation" or scriptOutputType == "final") {
-            scriptAccumulatedOutput.append(output);
-        }
-
-        // Latest output:
-        if (scriptOutputType == "latest") {
-
-            httpHeaderCleaner(output);
-            output = httpHeadersCleanedHtml;
-
-            if (scriptOutputThemeEnabled == true) {
-                themeLinker(output);
-                output = cssLinkedHtml;
-            }
+        ScriptJob *job = qobject_cast<ScriptJob *>(sender());
+        if (job == 0) {
+            return;
         }
 
-        // Accumulated output:
-        if (scriptOutputType == "accumulation" or scriptOutputType == "final") {
-
-            httpHeaderCleaner(scriptAccumulatedOutput);
-            scriptAccumulatedOutput = httpHeadersCleanedHtml;
+        job->outputBytes += outputData.size();
 
-            if (scriptOutputThemeEnabled == true) {
-                themeLinker(scriptAccumulatedOutput);
-                scriptAccumulatedOutput = cssLinkedHtml;
-            }
+        if (job->responseParser.headersComplete == true and
+                job->responseRouted == false) {
+            routeResponse(job);
         }
 
-        if (!Page::mainFrame()->childFrames().contains(targetFrame)) {
-            targetFrame = Page::currentFrame();
-        }
+        writeResponseBody(job, outputData);
+    }
 
-        if (scriptOutputType == "latest") {
-            targetFrame->setHtml(output);
+    // Errors spooled to a file are removed, once a frame has loaded them:
+    void scriptErrorsLoadedSlot()
+    {
+        QWebFrame *frame = qobject_cast<QWebFrame *>(sender());
+        if (frame == 0) {
+            return;
         }
 
-        if (scriptOutputType == "accumulation") {
-            targetFrame->setHtml(scriptAccumulatedOutput);
+        QString loadedFilePath =
+                QDir::toNativeSeparators(frame->url().toLocalFile());
+        if (scriptErrorsFilePaths.contains(loadedFilePath)) {
+            QObject::disconnect(frame, SIGNAL(loadFinished(bool)),
+                                this, SLOT(scriptErrorsLoadedSlot()));
+            QFile::remove(loadedFilePath);
+            scriptErrorsFilePaths.removeOne(loadedFilePath);
         }
     }
 
-    void scriptErrorSlot()
+    void scriptErrorDataSlot(QByteArray errorData)
     {
-        QString error = scriptHandler.readAllStandardError();
-        scriptAccumulatedErrors.append(error);
-        scriptAccumulatedErrors.append("\n");
+        ScriptJob *job = qobject_cast<ScriptJob *>(sender());
+        if (job == 0) {
+            return;
+        }
+
+        // Errors are kept as raw bytes and are decoded only for the log:
+        job->errorSpool.append(errorData);
+        job->errorSpool.append("\n");
 
-        qDebug() << "Script error:" << error;
+        qDebug() << "Script error:" << job->errorText;
         qDebug() << "===============";
     }
 
     void scriptFinishedSlot()
     {
-        if (!Page::mainFrame()->childFrames().contains(targetFrame)) {
-            targetFrame = Page::currentFrame();
+        ScriptJob *job = qobject_cast<ScriptJob *>(sender());
+        if (job == 0) {
+            return;
         }
 
-        if (scriptTimedOut == false) {
-            if (scriptOutputType == "final") {
-                targetFrame->setHtml(scriptAccumulatedOutput);
+        // The latest output is always displayed:
+        job->renderScheduler.flush();
+
+        // Only complete responses of successful runs are cached:
+        if (job->responseCacheable == true and
+                job->responseNotModified == false and
+                job->killed == false and
+                job->expiredDeadline == ScriptJob::NoDeadline and
+                job->errorSpool.size() == 0 and
+                job->responseParser.headersComplete == true) {
+            ScriptResponseCache::instance()->store(job->scriptFullFilePath,
+                                                   job->responseCacheKey,
+                                                   &job->responseParser,
+                                                   job->responseCacheBody);
+        }
+
+        bool replyAvailable = (job->replyOutput == true and
+                               !job->reply.isNull() and
+                               !job->reply->isClosing());
+
+        if (job->attachmentFile.isOpen()) {
+            job->attachmentFile.close();
+            if (job->killed == false and
+                    job->expiredDeadline == ScriptJob::NoDeadline) {
+                saveAttachment(job);
+            } else {
+                job->attachmentFile.remove();
             }
+        }
 
+        if (job->expiredDeadline == ScriptJob::NoDeadline) {
             if ((qApp->property("displayStderr").toString()) == "enable") {
-                if (scriptAccumulatedErrors.length() > 0 and
-                        scriptKilled == false) {
-
-                    themeLinker(scriptAccumulatedErrors);
-                    scriptAccumulatedErrors = cssLinkedHtml;
+                if (job->errorSpool.size() > 0 and
+                        job->killed == false) {
+
+                    // Errors too large for memory are displayed from a file:
+                    QString errorsFilePath;
+                    QString errors;
+                    if (job->errorSpool.isSpilled()) {
+                        errorsFilePath =
+                                QDir::toNativeSeparators(
+                                    (qApp->property("applicationOutputDirectory")
+                                     .toString())
+                                    + QDir::separator() + "script-errors-"
+                                    + job->jobId + ".txt");
+                        if (job->errorSpool.saveAs(errorsFilePath)) {
+                            scriptErrorsFilePaths.append(errorsFilePath);
+                        } else {
+                            errorsFilePath = "";
+                        }
+                    } else {
+                        themeLinker(QString::fromUtf8(
+                                        job->errorSpool.memoryContents()));
+                        errors = cssLinkedHtml;
+                    }
 
-                    if (scriptAccumulatedOutput.length() == 0) {
-                        targetFrame->setHtml(scriptAccumulatedErrors);
+                    if (job->outputReceived == false) {
+                        if (replyAvailable == true and
+                                errorsFilePath.length() == 0) {
+                            job->reply->writeBodySlot(errors.toUtf8());
+                        } else if (errorsFilePath.length() > 0) {
+                            if (replyAvailable == true) {
+                                job->reply->cancelSlot();
+                                replyAvailable = false;
+                            }
+                            // The file is removed, when the frame has loaded it:
+                            QObject::connect(jobFrame(job),
+                                             SIGNAL(loadFinished(bool)),
+                                             this,
+                                             SLOT(scriptErrorsLoadedSlot()),
+                                             Qt::UniqueConnection);
+                            jobFrame(job)->setUrl(
+                                        QUrl::fromLocalFile(errorsFilePath));
+                        } else {
+                            jobFrame(job)->setHtml(errors);
+                        }
                     } else {
+                        if (replyAvailable == true) {
+                            job->reply->finishSlot();
+                        }
+
                         QMessageBox showErrorsMessageBox;
                         showErrorsMessageBox.setWindowModality(Qt::WindowModal);
                         showErrorsMessageBox.setWindowTitle(tr("Errors"));
@@ -839,60 +7831,88 @@ public slots:
                                 .setButtonText(QMessageBox::No, tr("No"));
                         showErrorsMessageBox.setDefaultButton(QMessageBox::Yes);
 
+                        // The errors window removes the file, when it is loaded:
+                        if (errorsFilePath.length() > 0) {
+                            scriptErrorsFilePaths.removeOne(errorsFilePath);
+                        }
+
                         if (showErrorsMessageBox.exec() == QMessageBox::Yes) {
-                            emit displayErrorsSignal(scriptAccumulatedErrors);
+                            emit displayErrorsSignal(
+                                        errorsFilePath.length() > 0 ?
+                                            errorsFilePath : errors);
+                        } else if (errorsFilePath.length() > 0) {
+                            QFile::remove(errorsFilePath);
                         }
                     }
                 }
             }
 
-            scriptHandler.close();
-
-            qDebug() << "Script finished:" << scriptFullFilePath;
+            qDebug() << "Script finished:" << job->scriptFullFilePath;
+            qDebug() << "Script response time:"
+                     << job->elapsedTimer.elapsed()
+                     << "msecs from a" << job->executionMode;
+            // Output throughput has to stay constant for any output size:
+            qDebug() << "Script output:" << job->outputBytes << "bytes,"
+                     << (job->outputBytes * 1000 /
+                         qMax((qint64) 1, (qint64) job->elapsedTimer.elapsed()))
+                     << "bytes per second";
+            RenderScheduler *renderScheduler = &job->renderScheduler;
+            if (job->replyOutput == true and !job->reply.isNull()) {
+                renderScheduler = &job->reply->renderScheduler;
+            }
+            qDebug() << "Output updates:"
+                     << renderScheduler->committedUpdates << "committed,"
+                     << renderScheduler->coalescedUpdates << "coalesced,"
+                     << renderScheduler->droppedUpdates << "dropped";
             qDebug() << "===============";
         }
 
-        runningScriptsInCurrentWindowList.removeOne(scriptFullFilePath);
-
-        QStringList runningScriptsGlobalCurrentList
-                = qApp->property("runningScriptsGlobalList").toStringList();
-        runningScriptsGlobalCurrentList.removeOne(scriptFullFilePath);
-        qApp->setProperty("runningScriptsGlobalList",
-                          runningScriptsGlobalCurrentList);
+        if (replyAvailable == true) {
+            job->reply->finishSlot();
+        }
 
-        scriptAccumulatedOutput = "";
-        scriptAccumulatedErrors = "";
+        ScriptJobRegistry::instance()->unregisterJob(job);
+        job->deleteLater();
     }
 
     void scriptTimeoutSlot()
     {
-        if (scriptHandler.isOpen() and
-                scriptAccumulatedErrors.length() == 0) {
-
-            scriptTimedOut = true;
-            scriptHandler.close();
+        ScriptJob *job = qobject_cast<ScriptJob *>(sender());
+        if (job == 0) {
+            return;
+        }
 
-            runningScriptsInCurrentWindowList.removeOne(scriptFullFilePath);
+        QString timeoutReason;
+        if (job->expiredDeadline == ScriptJob::FirstByteDeadline) {
+            timeoutReason = tr("Your script produced no output in time!<br>");
+        } else if (job->expiredDeadline == ScriptJob::IdleOutputDeadline) {
+            timeoutReason = tr("Your script stopped producing output!<br>");
+        } else {
+            timeoutReason = tr("Your script timed out!<br>");
+        }
 
-            QStringList runningScriptsGlobalCurrentList =
-                    qApp->property("runningScriptsGlobalList").toStringList();
-            runningScriptsGlobalCurrentList.removeOne(scriptFullFilePath);
-            qApp->setProperty("runningScriptsGlobalList",
-                              runningScriptsGlobalCurrentList);
+        qDebug() << "Script timed out:" << job->scriptFullFilePath;
+        qDebug() << "Expired deadline:" << job->expiredDeadline;
+        qDebug() << "===============";
 
-            qDebug() << "Script timed out:" << scriptFullFilePath;
-            qDebug() << "===============";
+        QMessageBox scriptTimeoutMessageBox;
+        scriptTimeoutMessageBox.setWindowModality(Qt::WindowModal);
+        scriptTimeoutMessageBox.setWindowTitle(tr("Script Timeout"));
+        scriptTimeoutMessageBox
+                .setIconPixmap((qApp->property("icon").toString()));
+        scriptTimeoutMessageBox
+                .setText(timeoutReason
+                         + tr("Consider starting it as a long-running script."));
+        scriptTimeoutMessageBox.setDefaultButton(QMessageBox::Ok);
+        scriptTimeoutMessageBox.exec();
+    }
 
-            QMessageBox scriptTimeoutMessageBox;
-            scriptTimeoutMessageBox.setWindowModality(Qt::WindowModal);
-            scriptTimeoutMessageBox.setWindowTitle(tr("Script Timeout"));
-            scriptTimeoutMessageBox
-                    .setIconPixmap((qApp->property("icon").toString()));
-            scriptTimeoutMessageBox
-                    .setText(tr("Your script timed out!<br>")
-                             + tr("Consider starting it as a long-running script."));
-            scriptTimeoutMessageBox.setDefaultButton(QMessageBox::Ok);
-            scriptTimeoutMessageBox.exec();
+    void abortAllScriptsSlot()
+    {
+        foreach (ScriptJob *job,
+                 ScriptJobRegistry::instance()->jobsForPage(this)) {
+            job->killed = true;
+            job->abortSlot();
         }
     }
 
@@ -914,6 +7934,17 @@ public slots:
                 debuggerScriptToDebugFilePath = filePath;
             }
 
+#if ZIP_SUPPORT == 1
+            // The debugger is started again,
+            // when the folder of the script is extracted:
+            if (!ZipPackage::instance()->prepareScript(
+                        debuggerScriptToDebugFilePath, this,
+                        "packageExtractedSlot")) {
+                packagedDebuggerUrls.append(debuggerUrl);
+                return;
+            }
+#endif
+
             debuggerQueryString = debuggerUrl.toString(QUrl::RemoveScheme
                                                        | QUrl::RemoveAuthority
                                                        | QUrl::RemovePath)
@@ -931,7 +7962,7 @@ public slots:
             qDebug() << "Interpreter:" << debuggerInterpreter;
 
             // Clean accumulated debugger output from previous debugger session:
-            debuggerAccumulatedOutput = "";
+            debuggerOutputSpool.clear();
 
             // Clean debugger output file from previous debugger session:
             QFile debuggerOutputFile(debuggerOutputFilePath);
@@ -1068,20 +8099,21 @@ public slots:
             // Make HTML-compatible line endings:
             debuggerOutput.replace("\n", "<br>\n");
 
-            // Append last output from the debugger
-            // to the accumulated debugger output:
-            debuggerAccumulatedOutput.append(debuggerOutput);
-
             // Preserve extra spacing within the output from
             // "List variables in package" and
             // "List variables in current package" commands:
             if (debuggerQueryString == "V") {
-                debuggerAccumulatedOutput.replace("  ", "&nbsp;&nbsp;");
+                debuggerOutput.replace("  ", "&nbsp;&nbsp;");
             }
             if (debuggerQueryString == "X") {
-                debuggerAccumulatedOutput.replace("  ", "&nbsp;&nbsp;");
+                debuggerOutput.replace("  ", "&nbsp;&nbsp;");
             }
 
+            // Append last output from the debugger
+            // to the accumulated debugger output.
+            // Long debugger sessions are spilled to disk like script output:
+            debuggerOutputSpool.append(debuggerOutput.toUtf8());
+
             // Start highlighting the necessary source code:
             if (!debuggerSyntaxHighlighter.isOpen()) {
                 qDebug() << "Source viewer for the Perl debugger started.";
@@ -1174,10 +8206,6 @@ public slots:
                                        "source.htm#"
                                        + debuggerHighlightedSourceScrollToLine);
 
-            debuggerHtmlOutput
-                    .replace("[% Debugger Output %]",
-                             debuggerAccumulatedOutput);
-
             if (debuggerQueryString.length() > 0) {
                 debuggerHtmlOutput
                         .replace("[% Debugger Command %]",
@@ -1193,10 +8221,29 @@ public slots:
                     ((qApp->property("applicationOutputDirectory").toString())
                      + QDir::separator() + "dbgoutput.htm");
 
+            // The accumulated debugger output is copied from its spool
+            // between the two parts of the template:
+            int debuggerOutputPosition =
+                    debuggerHtmlOutput.indexOf("[% Debugger Output %]");
+
             QFile debuggerOutputFile(debuggerOutputFilePath);
-            if (debuggerOutputFile.open(QIODevice::ReadWrite)) {
-                QTextStream debuggerOutputStream(&debuggerOutputFile);
-                debuggerOutputStream << debuggerHtmlOutput << endl;
+            if (debuggerOutputFile.open(QIODevice::WriteOnly
+                                        | QIODevice::Truncate)) {
+                if (debuggerOutputPosition >= 0) {
+                    debuggerOutputFile.write(
+                                debuggerHtmlOutput.left(debuggerOutputPosition)
+                                .toUtf8());
+                    debuggerOutputSpool.copyTo(&debuggerOutputFile);
+                    debuggerOutputFile.write(
+                                debuggerHtmlOutput.mid(
+                                    debuggerOutputPosition
+                                    + QString("[% Debugger Output %]").length())
+                                .toUtf8());
+                } else {
+                    debuggerOutputFile.write(debuggerHtmlOutput.toUtf8());
+                }
+                debuggerOutputFile.write("\n");
+                debuggerOutputFile.close();
             }
 
             qDebug() << "Output from Perl debugger received.";
@@ -1212,9 +8259,16 @@ public slots:
 
 public:
     Page();
+
+    // Spooled errors never displayed are removed with the page:
+    ~Page()
+    {
+        foreach (QString errorsFilePath, scriptErrorsFilePaths) {
+            QFile::remove(errorsFilePath);
+        }
+    }
+
     QString scriptFullFilePath;
-    QProcess scriptHandler;
-    QStringList runningScriptsInCurrentWindowList;
 
 protected:
     bool acceptNavigationRequest(QWebFrame *frame,
@@ -1222,6 +8276,173 @@ protected:
                                  QWebPage::NavigationType type);
 
 private:
+    // Attachments are saved to disk, all other responses are
+    // passed to the network reply or, in the 'latest' mode, to the frame:
+    void routeResponse(ScriptJob *job)
+    {
+        job->responseRouted = true;
+
+        // Unchanged responses are taken from the cache and
+        // any body of the '304' answer is ignored:
+        if (job->responseRevalidated == true and
+                job->responseParser.statusCode == 304) {
+            job->responseNotModified = true;
+            ScriptResponseCache::instance()->refresh(job->responseCacheKey,
+                                                     &job->responseParser);
+            if (job->replyOutput == true and
+                    !job->reply.isNull() and !job->reply->isClosing()) {
+                job->reply->setCachedResponse(job->revalidatedResponse);
+                job->reply->writeBodySlot(job->revalidatedResponse.body);
+            }
+            return;
+        }
+
+        if (job->responseParser.isAttachment()) {
+            job->responseCacheable = false;
+            job->attachmentFile.setFileName(
+                        QDir::toNativeSeparators(
+                            (qApp->property("applicationTempDirectory")
+                             .toString())
+                            + QDir::separator() + "attachment-"
+                            + job->jobId + ".part"));
+            job->attachmentFile.open(QIODevice::WriteOnly
+                                     | QIODevice::Truncate);
+
+            qDebug() << "Attachment from" << job->scriptFullFilePath
+                     << "is spooled to" << job->attachmentFile.fileName();
+            qDebug() << "===============";
+
+            if (job->replyOutput == true and !job->reply.isNull()) {
+                job->reply->cancelSlot();
+            }
+            return;
+        }
+
+        if (job->replyOutput == true and
+                !job->reply.isNull() and !job->reply->isClosing()) {
+            job->reply->setResponse(&job->responseParser);
+        }
+    }
+
+    void writeResponseBody(ScriptJob *job, QByteArray body)
+    {
+        if (body.size() == 0 or job->responseNotModified == true) {
+            return;
+        }
+
+        if (job->responseCacheable == true) {
+            if (job->responseCacheBody.size() + body.size() >
+                    ScriptResponseCache::instance()->maximumEntrySize()) {
+                job->responseCacheable = false;
+                job->responseCacheBody.clear();
+            } else {
+                job->responseCacheBody.append(body);
+            }
+        }
+
+        if (job->attachmentFile.isOpen()) {
+            job->attachmentFile.write(body);
+            return;
+        }
+
+        if (job->replyOutput == true) {
+            // Output is dropped, if the document was abandoned:
+            if (!job->reply.isNull() and !job->reply->isClosing()) {
+                job->reply->writeBodySlot(body);
+            }
+            return;
+        }
+
+        // Latest output replaces any output not yet displayed.
+        // Only HTML is decoded, all other content,
+        // for example images, is displayed as it is.
+        // Every chunk is decoded by the I/O thread, so that
+        // characters split between two chunks are never lost:
+        if (job->responseParser.isHtml()) {
+            job->pendingRenderText = job->outputText;
+        } else {
+            job->pendingRenderOutput = body;
+        }
+        job->renderScheduler.requestUpdate(true);
+    }
+
+    void renderJobOutputSlot()
+    {
+        ScriptJob *job = qobject_cast<ScriptJob *>(sender());
+        if (job == 0) {
+            return;
+        }
+
+        if (job->pendingRenderText.length() > 0) {
+            QString output = job->pendingRenderText;
+            job->pendingRenderText.clear();
+
+            if (job->outputThemeEnabled == true) {
+                themeLinker(output);
+                output = cssLinkedHtml;
+            }
+
+            jobFrame(job)->setHtml(output);
+        }
+
+        if (job->pendingRenderOutput.size() > 0) {
+            QByteArray body = job->pendingRenderOutput;
+            job->pendingRenderOutput.clear();
+
+            jobFrame(job)->setContent(body,
+                                      QString(job->responseParser.mimeType()));
+        }
+    }
+
+    void saveAttachment(ScriptJob *job)
+    {
+        QString suggestedFileName = job->responseParser.attachmentFileName();
+        if (suggestedFileName.isEmpty()) {
+            suggestedFileName = QFileInfo(job->scriptFullFilePath)
+                    .completeBaseName();
+        }
+
+        QFileDialog saveFileDialog;
+        saveFileDialog.setWindowModality(Qt::WindowModal);
+        saveFileDialog.setWindowIcon(icon);
+        QString fileName = saveFileDialog.getSaveFileName
+                (0, tr("Save File"),
+                 QDir::currentPath() + QDir::separator() + suggestedFileName,
+                 tr("All files (*)"));
+        saveFileDialog.close();
+        saveFileDialog.deleteLater();
+
+        if (fileName.isEmpty()) {
+            job->attachmentFile.remove();
+            return;
+        }
+
+        if (QFile::exists(fileName)) {
+            QFile::remove(fileName);
+        }
+
+        // Renaming fails across file systems and the file is copied then:
+        if (!job->attachmentFile.rename(fileName)) {
+            job->attachmentFile.copy(fileName);
+            job->attachmentFile.remove();
+        }
+
+        qDebug() << "Attachment saved:" << QDir::toNativeSeparators(fileName);
+        qDebug() << "===============";
+    }
+
+    // Frames closed or replaced while their script was running
+    // are substituted with the current frame:
+    QWebFrame *jobFrame(ScriptJob *job)
+    {
+        if (job->targetFrame.isNull() or
+                !Page::mainFrame()->childFrames()
+                .contains(job->targetFrame.data())) {
+            job->targetFrame = Page::currentFrame();
+        }
+        return job->targetFrame.data();
+    }
+
     QString userAgentForUrl(const QUrl &url) const
     {
         Q_UNUSED(url);
@@ -1232,19 +8453,11 @@ private:
     QWebFrame *targetFrame;
 
     QString cssLinkedHtml;
-    QString httpHeadersCleanedHtml;
 
     QStringList allowedEnvironmentVariables;
     QStringList sourceViewerMandatoryCommandLine;
 
     QProcessEnvironment scriptEnvironment;
-    bool scriptTimedOut;
-    bool scriptKilled;
-    QString scriptOutputFilePath;
-    QString scriptAccumulatedOutput;
-    QString scriptAccumulatedErrors;
-    bool scriptOutputThemeEnabled;
-    QString scriptOutputType;
 
     QWebView *debuggerNewWindow;
     QString debuggerScriptUrl;
@@ -1252,12 +8465,21 @@ private:
     QString debuggerQueryString;
     QProcess debuggerHandler;
     QString debuggerLineInfoLastLine;
-    QString debuggerAccumulatedOutput;
+    ScriptSpool debuggerOutputSpool;
+    QStringList scriptErrorsFilePaths;
     QString debuggerOutputFilePath;
     QProcess debuggerSyntaxHighlighter;
     QString debuggerSourceToHighlightFilePath;
     QString debuggerHighlighterOutputFilePath;
 
+#if ZIP_SUPPORT == 1
+    // Scripts and debugger sessions waiting for
+    // their folders to be extracted from the ZIP package:
+    QList<QUrl> packagedScriptUrls;
+    QList<QPointer<ScriptReply> > packagedScriptReplies;
+    QList<QUrl> packagedDebuggerUrls;
+#endif
+
     QPixmap icon;
 };
 
@@ -1275,11 +8497,10 @@ signals:
 public slots:
     void loadStartPageSlot()
     {
-        FileDetector fileDetector;
-        fileDetector
-                .defineInterpreter((qApp->property("startPage").toString()));
+        QString fileType = RootIndex::instance()
+                ->fileType((qApp->property("startPage").toString()));
 
-        if (fileDetector.interpreter.contains("browser-html")) {
+        if (fileType.contains("browser-html")) {
             setUrl(QUrl::fromLocalFile
                    (QDir::toNativeSeparators
                     ((qApp->property("startPage").toString()))));
@@ -1461,10 +8682,9 @@ public slots:
                  + qWebHitTestURL.toString
                  (QUrl::RemoveScheme | QUrl::RemoveAuthority));
 
-        FileDetector fileDetector;
-        fileDetector.defineInterpreter(fileToOpen);
+        QString fileType = RootIndex::instance()->fileType(fileToOpen);
 
-        if (fileDetector.interpreter.contains("browser-html")) {
+        if (fileType.contains("browser-html")) {
             newWindow->setUrl(QUrl::fromLocalFile(fileToOpen));
         } else {
             newWindow->setUrl(qWebHitTestURL);
@@ -1475,12 +8695,29 @@ public slots:
     void displayErrorsSlot(QString errors)
     {
         errorsWindow = new TopLevel();
-        errorsWindow->setHtml(errors);
+        // Large errors are spooled to a file and loaded by URL.
+        // The file is removed, when it is loaded:
+        if (QFile::exists(errors)) {
+            QObject::connect(errorsWindow, SIGNAL(loadFinished(bool)),
+                             this, SLOT(removeLoadedErrorsSlot()));
+            errorsWindow->setUrl(QUrl::fromLocalFile(errors));
+        } else {
+            errorsWindow->setHtml(errors);
+        }
         errorsWindow->setFocus();
         errorsWindow->show();
+    }
+
+    void removeLoadedErrorsSlot()
+    {
+        QWebView *window = qobject_cast<QWebView *>(sender());
+        if (window == 0) {
+            return;
+        }
 
-        QFile scriptErrorsFile(errors);
-        scriptErrorsFile.remove();
+        QObject::disconnect(window, SIGNAL(loadFinished(bool)),
+                            this, SLOT(removeLoadedErrorsSlot()));
+        QFile::remove(window->url().toLocalFile());
     }
 
     void contextMenuEvent(QContextMenuEvent *event)
@@ -1509,11 +8746,10 @@ public slots:
                              | QUrl::RemoveQuery)
                          .replace("?", ""));
 
-                FileDetector fileDetector;
-                fileDetector.defineInterpreter(fileToOpen);
+                QString fileType = RootIndex::instance()->fileType(fileToOpen);
 
-                if ((!fileDetector.interpreter.contains("browser")) and
-                        (!fileDetector.interpreter.contains("undefined"))) {
+                if ((!fileType.contains("browser")) and
+                        (!fileType.contains("undefined"))) {
                     QAction *viewSourceAct =
                             menu->addAction(tr("&View Source"));
                     QObject::connect(viewSourceAct, SIGNAL(triggered()),
@@ -1559,13 +8795,15 @@ public slots:
             QObject::connect(minimizeAct, SIGNAL(triggered()),
                              this, SLOT(minimizeSlot()));
 
-            if (mainPage->runningScriptsInCurrentWindowList.length() == 0) {
+            if (ScriptJobRegistry::instance()
+                    ->jobCountForPage(mainPage) == 0) {
                 QAction *homeAct = menu->addAction(tr("&Home"));
                 QObject::connect(homeAct, SIGNAL(triggered()),
                                  this, SLOT(loadStartPageSlot()));
             }
 
-            if (mainPage->runningScriptsInCurrentWindowList.length() == 0 or
+            if (ScriptJobRegistry::instance()
+                    ->jobCountForPage(mainPage) == 0 or
                     TopLevel::url().toString().length() > 0) {
                 QAction *reloadAct = menu->addAction(tr("&Reload"));
                 QObject::connect(reloadAct, SIGNAL(triggered()),
@@ -1584,7 +8822,8 @@ public slots:
             QObject::connect(saveAsPdfAct, SIGNAL(triggered()),
                              this, SLOT(saveAsPdfSlot()));
 
-            if (mainPage->runningScriptsInCurrentWindowList.length() == 0 or
+            if (ScriptJobRegistry::instance()
+                    ->jobCountForPage(mainPage) == 0 or
                     TopLevel::url().toString().length() > 0) {
                 QAction *selectThemeAct = menu->addAction(tr("&Select theme"));
                 QObject::connect(selectThemeAct, SIGNAL(triggered()),
@@ -1679,7 +8918,7 @@ public slots:
 
     void closeEvent(QCloseEvent *event)
     {
-        if (mainPage->scriptHandler.isOpen()) {
+        if (ScriptJobRegistry::instance()->jobCountForPage(mainPage) > 0) {
             QMessageBox confirmExitMessageBox;
             confirmExitMessageBox.setWindowModality(Qt::WindowModal);
             confirmExitMessageBox.setWindowTitle(tr("Quit"));
@@ -1695,7 +8934,7 @@ public slots:
             confirmExitMessageBox.setButtonText(QMessageBox::No, tr("No"));
             confirmExitMessageBox.setDefaultButton(QMessageBox::No);
             if (confirmExitMessageBox.exec() == QMessageBox::Yes) {
-                mainPage->scriptHandler.close();
+                mainPage->abortAllScriptsSlot();
                 event->accept();
             } else {
                 event->ignore();
@@ -1707,8 +8946,7 @@ public slots:
 
     void quitApplicationSlot()
     {
-        if (qApp->property("runningScriptsGlobalList")
-                .toStringList().length() > 0) {
+        if (ScriptJobRegistry::instance()->jobCount() > 0) {
             QMessageBox confirmExitMessageBox;
             confirmExitMessageBox.setWindowModality(Qt::WindowModal);
             confirmExitMessageBox.setWindowTitle(tr("Quit"));
@@ -1724,6 +8962,14 @@ public slots:
             confirmExitMessageBox.setButtonText(QMessageBox::No, tr("No"));
             confirmExitMessageBox.setDefaultButton(QMessageBox::No);
             if (confirmExitMessageBox.exec() == QMessageBox::Yes) {
+#if ZIP_SUPPORT == 1
+                // A packaged Perl interpreter is extracted for the removal:
+                foreach (QString perlFolder,
+                         ZipPackage::instance()->perlFolders()) {
+                    ZipPackage::instance()->extract(perlFolder);
+                }
+#endif
+
                 // Perl temp folder removal code:
                 QProcess cleanerProcess;
                 cleanerProcess
@@ -1754,6 +9000,14 @@ public slots:
             //QDir applicationTempDirectory(qApp->property("applicationTempDirectory").toString());
             //applicationTempDirectory.removeRecursively();
 
+#if ZIP_SUPPORT == 1
+            // A packaged Perl interpreter is extracted for the removal:
+            foreach (QString perlFolder,
+                     ZipPackage::instance()->perlFolders()) {
+                ZipPackage::instance()->extract(perlFolder);
+            }
+#endif
+
             // Perl temp folder removal code:
             QProcess cleanerProcess;
             cleanerProcess
@@ -88,6 +88,9 @@ greaterThan (QT_MAJOR_VERSION, 4) {
 HEADERS += peb.h
 SOURCES += peb.cpp
 
+# Resources - the fork-server script:
+RESOURCES += peb.qrc
+
 # Temporary folder:
 MOC_DIR = ../tmp
 OBJECTS_DIR = ../tmp
@@ -123,9 +126,10 @@ message ("Browser pseudo-domain: $$PSEUDO_DOMAIN")
 # SCRIPT_CENSORING = 1
 # If this option is enabled,
 # every Perl script going to be executed by the browser
-# is scanned by a special super-script, censor.pl, and
+# is scanned by the built-in script censor before it is started and
 # if any security issues are found, the offending script
 # is blocked and error message is displayed.
+# Approved scripts are started with 'fork' and 'unlink' masked.
 ##########################################################
 # To turn off security checks of user-supplied Perl scripts:
 # SCRIPT_CENSORING = 0
@@ -138,7 +142,6 @@ equals (SCRIPT_CENSORING, 0) {
     message ("Going to build without script censoring support.")
 }
 equals (SCRIPT_CENSORING, 1) {
-    RESOURCES += peb.qrc
     message ("Going to build with script censoring support.")
 }
 
@@ -202,4 +205,32 @@ equals (PERL_DEBUGGER_INTERACTION, 1) {
     message ("Going to build with Perl debugger interaction capability.")
 }
 
+##########################################################
+# To run trusted scripts inside the browser process using libperl:
+# EMBEDDED_PERL = 1
+# Scripts listed in the 'embedded' setting of peb.ini run in
+# fresh clones of one embedded Perl interpreter on worker threads,
+# without fork, exec and pipe setup for every script.
+# A Perl built with ithreads and its development files are needed.
+# All embedded scripts share the browser process and its working directory,
+# so this option is meant only for trusted, latency-sensitive deployments.
+##########################################################
+# To start every script as a separate process:
+# EMBEDDED_PERL = 0
+##########################################################
+EMBEDDED_PERL = 0
+
+DEFINES += "EMBEDDED_PERL=$$EMBEDDED_PERL"
+
+equals (EMBEDDED_PERL, 0) {
+    message ("Going to build without embedded Perl interpreter.")
+}
+equals (EMBEDDED_PERL, 1) {
+    message ("Going to build with embedded Perl interpreter.")
+    HEADERS += perlembed.h
+    SOURCES += perlembed.cpp
+    QMAKE_CXXFLAGS += $$system(perl -MExtUtils::Embed -e ccopts)
+    LIBS += $$system(perl -MExtUtils::Embed -e ldopts)
+}
+
 message ("")
@@ -0,0 +1,254 @@
+/*
+ Perl Executing Browser, v. 0.1
+
+ This program is free software;
+ you can redistribute it and/or modify it under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 3 of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ Dimitar D. Mitov, 2013 - 2015, ddmitov (at) yahoo (dot) com
+ Valcho Nedelchev, 2014 - 2015
+*/
+
+#include <EXTERN.h>
+#include <perl.h>
+#include "perlembed.h"
+
+#ifndef USE_ITHREADS
+#error "Embedded Perl needs a libperl built with ithreads (perl_clone)."
+#endif
+
+// ==============================
+// XS MODULES SUPPORT:
+// ==============================
+EXTERN_C void boot_DynaLoader(pTHX_ CV *cv);
+
+static void xs_init(pTHX)
+{
+    newXS("DynaLoader::boot_DynaLoader", boot_DynaLoader, __FILE__);
+}
+
+// ==============================
+// BOOTSTRAP CODE OF THE PARENT INTERPRETER:
+// ==============================
+// 'exit' is turned into an exception, so that it ends only the script and
+// not the whole browser. Standard filehandles are localized globs opened
+// on scalars and no file descriptor of the browser is touched.
+// %ENV of the script is a plain hash put in the glob of %ENV:
+// 'local %ENV' would keep the environment magic and call setenv() for
+// the whole process, racing with scripts on other pool threads.
+// $0 is not localized for the same reason - its magic sets the process title.
+static const char *bootstrapCode =
+        "package PEB::Embed;"
+        "our ($script, $stdin, $stdout, $stderr, %env);"
+        "BEGIN {"
+        "    *CORE::GLOBAL::exit = sub {"
+        "        die bless { status => (defined $_[0] ? $_[0] : 0) },"
+        "            'PEB::Embed::Exit';"
+        "    };"
+        "}"
+        "sub run {"
+        "    my %script_env = %env;"
+        "    local *ENV = \\%script_env;"
+        "    local @ARGV = ();"
+        "    local *STDIN;"
+        "    local *STDOUT;"
+        "    local *STDERR;"
+        "    $stdout = '';"
+        "    $stderr = '';"
+        "    open (STDIN, '<', \\$stdin);"
+        "    open (STDOUT, '>', \\$stdout);"
+        "    open (STDERR, '>', \\$stderr);"
+        "    my $status = 0;"
+        "    if (not -r $script) {"
+        "        print STDERR \"$script could not be read.\\n\";"
+        "        $status = 1;"
+        "    } else {"
+        "        do $script;"
+        "        if (ref $@ eq 'PEB::Embed::Exit') {"
+        "            $status = $@->{status};"
+        "        } elsif ($@) {"
+        "            print STDERR $@;"
+        "            $status = 255;"
+        "        }"
+        "    }"
+        "    close (STDOUT);"
+        "    close (STDERR);"
+        "    return $status;"
+        "}"
+        "sub preload {"
+        "    foreach my $module (@_) {"
+        "        next if $module !~ m/^\\w+(::\\w+)*$/;"
+        "        eval \"require $module; 1\" or"
+        "            print STDERR \"Module $module was not preloaded: $@\";"
+        "    }"
+        "}"
+        "sub mask {"
+        "    require Opcode;"
+        "    Opcode::opmask_add (Opcode::opset (split (/,/, $_[0])));"
+        "}"
+        "1;";
+
+static PerlInterpreter *parentInterpreter = 0;
+
+bool PerlEmbed::initialize(const std::vector<std::string> &includeDirectories,
+                           const std::vector<std::string> &preloadModules,
+                           const std::string &prohibitedCoreFunctions)
+{
+    if (parentInterpreter != 0) {
+        return true;
+    }
+
+    int systemArgc = 0;
+    char **systemArgv = 0;
+    char **systemEnv = 0;
+    PERL_SYS_INIT3(&systemArgc, &systemArgv, &systemEnv);
+
+    std::vector<std::string> arguments;
+    arguments.push_back("");
+    for (size_t index = 0; index < includeDirectories.size(); index++) {
+        arguments.push_back("-I" + includeDirectories[index]);
+    }
+    arguments.push_back("-e");
+    arguments.push_back(bootstrapCode);
+
+    std::vector<char *> argumentPointers;
+    for (size_t index = 0; index < arguments.size(); index++) {
+        argumentPointers.push_back(const_cast<char *>(arguments[index].c_str()));
+    }
+    argumentPointers.push_back(0);
+
+    PerlInterpreter *my_perl = perl_alloc();
+    PERL_SET_CONTEXT(my_perl);
+    perl_construct(my_perl);
+    PL_exit_flags |= PERL_EXIT_DESTRUCT_END;
+
+    if (perl_parse(my_perl, xs_init, (int) arguments.size(),
+                   &argumentPointers[0], NULL) != 0 or
+            perl_run(my_perl) != 0) {
+        perl_destruct(my_perl);
+        perl_free(my_perl);
+        return false;
+    }
+
+    {
+        dSP;
+        ENTER;
+        SAVETMPS;
+        PUSHMARK(SP);
+        for (size_t index = 0; index < preloadModules.size(); index++) {
+            XPUSHs(sv_2mortal(newSVpvn(preloadModules[index].c_str(),
+                                       preloadModules[index].length())));
+        }
+        PUTBACK;
+        call_pv("PEB::Embed::preload", G_DISCARD | G_EVAL);
+        FREETMPS;
+        LEAVE;
+    }
+
+    // The mask is set after preloading and is copied into every clone:
+    if (prohibitedCoreFunctions.length() > 0) {
+        dSP;
+        ENTER;
+        SAVETMPS;
+        PUSHMARK(SP);
+        XPUSHs(sv_2mortal(newSVpvn(prohibitedCoreFunctions.c_str(),
+                                   prohibitedCoreFunctions.length())));
+        PUTBACK;
+        call_pv("PEB::Embed::mask", G_DISCARD | G_EVAL);
+        FREETMPS;
+        LEAVE;
+    }
+
+    parentInterpreter = my_perl;
+
+    return true;
+}
+
+void *PerlEmbed::cloneInterpreter()
+{
+    if (parentInterpreter == 0) {
+        return 0;
+    }
+
+    PERL_SET_CONTEXT(parentInterpreter);
+#ifdef WIN32
+    PerlInterpreter *clone = perl_clone(parentInterpreter, CLONEf_CLONE_HOST);
+#else
+    PerlInterpreter *clone = perl_clone(parentInterpreter, 0);
+#endif
+
+    return clone;
+}
+
+int PerlEmbed::runScript(void *interpreter,
+                         const std::string &scriptFullFilePath,
+                         const std::vector<std::string> &environment,
+                         const std::string &stdinData,
+                         std::string &stdoutData,
+                         std::string &stderrData)
+{
+    PerlInterpreter *my_perl = static_cast<PerlInterpreter *>(interpreter);
+    PERL_SET_CONTEXT(my_perl);
+
+    sv_setpvn(get_sv("PEB::Embed::script", GV_ADD),
+              scriptFullFilePath.c_str(), scriptFullFilePath.length());
+    sv_setpvn(get_sv("PEB::Embed::stdin", GV_ADD),
+              stdinData.c_str(), stdinData.length());
+
+    HV *environmentHash = get_hv("PEB::Embed::env", GV_ADD);
+    hv_clear(environmentHash);
+    for (size_t index = 0; index < environment.size(); index++) {
+        const std::string &variable = environment[index];
+        size_t separator = variable.find('=');
+        if (separator == std::string::npos) {
+            continue;
+        }
+        std::string value = variable.substr(separator + 1);
+        (void) hv_store(environmentHash, variable.c_str(), (I32) separator,
+                        newSVpvn(value.c_str(), value.length()), 0);
+    }
+
+    int status = 255;
+    {
+        dSP;
+        ENTER;
+        SAVETMPS;
+        PUSHMARK(SP);
+        PUTBACK;
+        int count = call_pv("PEB::Embed::run", G_SCALAR | G_EVAL);
+        SPAGAIN;
+        if (count == 1) {
+            status = POPi;
+        }
+        PUTBACK;
+        FREETMPS;
+        LEAVE;
+    }
+
+    STRLEN length;
+    const char *buffer;
+
+    buffer = SvPV(get_sv("PEB::Embed::stdout", GV_ADD), length);
+    stdoutData.assign(buffer, length);
+
+    buffer = SvPV(get_sv("PEB::Embed::stderr", GV_ADD), length);
+    stderrData.assign(buffer, length);
+
+    if (SvTRUE(ERRSV)) {
+        buffer = SvPV(ERRSV, length);
+        stderrData.append(buffer, length);
+    }
+
+    return status;
+}
+
+void PerlEmbed::destroyInterpreter(void *interpreter)
+{
+    PerlInterpreter *my_perl = static_cast<PerlInterpreter *>(interpreter);
+    PERL_SET_CONTEXT(my_perl);
+    PL_perl_destruct_level = 2;
+    perl_destruct(my_perl);
+    perl_free(my_perl);
+}
@@ -0,0 +1,59 @@
+/*
+ Perl Executing Browser, v. 0.1
+
+ This program is free software;
+ you can redistribute it and/or modify it under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 3 of the License, or (at your option) any later version.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ Dimitar D. Mitov, 2013 - 2015, ddmitov (at) yahoo (dot) com
+ Valcho Nedelchev, 2014 - 2015
+*/
+
+#ifndef PERLEMBED_H
+#define PERLEMBED_H
+
+#include <string>
+#include <vector>
+
+// ==============================
+// EMBEDDED PERL INTERFACE:
+// ==============================
+// Thin wrapper around libperl.
+// The Perl headers define macros clashing with Qt names and
+// are included only in perlembed.cpp, so this interface uses no Perl types.
+// One parent interpreter is created at startup and every script runs in
+// a fresh clone of it, so scripts never share global state.
+// Cloning and destruction are not thread-safe and
+// have to be serialized by the caller; running clones is thread-safe.
+namespace PerlEmbed
+{
+    // Creates the parent interpreter in the calling thread.
+    // 'includeDirectories' are added to @INC, 'preloadModules' are
+    // loaded once and 'prohibitedCoreFunctions' (comma-separated or empty)
+    // are masked for all clones.
+    bool initialize(const std::vector<std::string> &includeDirectories,
+                    const std::vector<std::string> &preloadModules,
+                    const std::string &prohibitedCoreFunctions);
+
+    void *cloneInterpreter();
+
+    // Runs one script in a clone. STDIN, STDOUT and STDERR of the script
+    // are in-memory buffers: the whole output is returned only after
+    // the script ends and a running script can not be stopped.
+    // %ENV is a plain hash inside the clone, so the process environment,
+    // which child processes of the script inherit, is never changed.
+    // $0 is left unchanged too - scripts can use __FILE__ instead.
+    // Returns the exit status of the script.
+    int runScript(void *interpreter,
+                  const std::string &scriptFullFilePath,
+                  const std::vector<std::string> &environment,
+                  const std::string &stdinData,
+                  std::string &stdoutData,
+                  std::string &stderrData);
+
+    void destroyInterpreter(void *interpreter);
+}
+
+#endif // PERLEMBED_H
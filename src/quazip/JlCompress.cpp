@@ -25,6 +25,14 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include "JlCompress.h"
 #include <QDebug>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <algorithm>
 
 static bool copyData(QIODevice &inFile, QIODevice &outFile)
 {
@@ -39,6 +47,108 @@ static bool copyData(QIODevice &inFile, QIODevice &outFile)
     return true;
 }
 
+/// An entry to be extracted by the parallel extraction.
+struct ParallelExtractionEntry {
+    QString destination;
+    unz64_file_pos position;
+    qint64 size;
+    QFile::Permissions permissions;
+};
+
+static bool largerEntryFirst(const ParallelExtractionEntry &first,
+                             const ParallelExtractionEntry &second)
+{
+    return first.size > second.size;
+}
+
+/// One thread of the parallel extraction.
+/**
+  Every worker opens the archive again and has its own \c unzFile handle,
+  so no state of the archive is shared between threads. Only the
+  end of the central directory is read when the archive is opened,
+  the entries are reached directly by their positions.
+  Workers take the next entry from a shared counter until all entries are
+  extracted or any of them fails.
+  */
+class ParallelExtractionWorker : public QRunnable {
+public:
+    ParallelExtractionWorker(const QString &fileCompressed,
+                             const QVector<ParallelExtractionEntry> &entries,
+                             QAtomicInt &nextEntry, QAtomicInt &failed):
+        fileCompressed(fileCompressed), entries(entries),
+        nextEntry(nextEntry), failed(failed)
+    {
+    }
+
+    void run()
+    {
+        QuaZip zip(fileCompressed);
+        if (!zip.open(QuaZip::mdUnzip)) {
+            failed.fetchAndStoreOrdered(1);
+            return;
+        }
+
+        QByteArray buffer(65536, 0);
+        while (failed.fetchAndAddOrdered(0) == 0) {
+            int index = nextEntry.fetchAndAddOrdered(1);
+            if (index >= entries.size())
+                break;
+            if (!extractEntry(zip.getUnzFile(), entries.at(index), buffer))
+                failed.fetchAndStoreOrdered(1);
+        }
+
+        zip.close();
+    }
+
+private:
+    static bool extractEntry(unzFile file, const ParallelExtractionEntry &entry,
+                             QByteArray &buffer)
+    {
+        if (unzGoToFilePos64(file, &entry.position) != UNZ_OK)
+            return false;
+        if (unzOpenCurrentFile(file) != UNZ_OK)
+            return false;
+
+        QFile outFile(entry.destination);
+        if (!outFile.open(QIODevice::WriteOnly)) {
+            unzCloseCurrentFile(file);
+            return false;
+        }
+
+        qint64 total = 0;
+        int readLen;
+        bool ok = true;
+        while ((readLen = unzReadCurrentFile(file, buffer.data(),
+                                             (unsigned) buffer.size())) > 0) {
+            if (outFile.write(buffer.constData(), readLen) != readLen) {
+                ok = false;
+                break;
+            }
+            total += readLen;
+        }
+        ok = ok && readLen == 0 && total == entry.size;
+
+        // The CRC is verified when the whole entry is read:
+        if (unzCloseCurrentFile(file) != UNZ_OK)
+            ok = false;
+        outFile.close();
+
+        if (!ok) {
+            outFile.remove();
+            return false;
+        }
+        if (entry.permissions != 0) {
+            outFile.setPermissions(entry.permissions);
+        }
+        return true;
+    }
+
+    QString fileCompressed;
+    const QVector<ParallelExtractionEntry> &entries;
+    QAtomicInt &nextEntry;
+    QAtomicInt &failed;
+};
+
 /**OK
  * Comprime il file fileName, nell'oggetto zip, con il nome fileDest.
  *
@@ -248,6 +358,113 @@ bool JlCompress::removeFile(QStringList listFile) {
     return ret;
 }
 
+/**
+ * Extracts the given entries, or the whole archive if allFiles is true,
+ * into the folder dir using threadCount threads.
+ * If the function fails, all files it tried to extract are removed.
+ * Returns the absolute paths of the extracted entries
+ * in the order of the central directory.
+ * If several entries have the same name, only the last one is extracted,
+ * like by the sequential extraction overwriting the earlier ones.
+ *
+ * The function fails if:
+ * * the archive can not be opened;
+ * * any of the requested files is not found in the archive;
+ * * a folder can not be created;
+ * * the extraction of any entry fails, including a wrong CRC.
+ */
+QStringList JlCompress::extractEntriesParallel(QString fileCompressed, QStringList files, bool allFiles, QString dir, int threadCount) {
+    QuaZip zip(fileCompressed);
+    if(!zip.open(QuaZip::mdUnzip)) {
+        return QStringList();
+    }
+
+    // The central directory is read only once, here:
+    QSet<QString> requested = files.toSet();
+    QSet<QString> found;
+    QDir directory(dir);
+    QStringList extracted;
+    QStringList directories;
+    QVector<ParallelExtractionEntry> entries;
+    QHash<QString, int> entryIndexes;
+    QSet<QString> listedDirectories;
+    QuaZipFileInfo64 info;
+    for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+        if (!zip.getCurrentFileInfo(&info)) {
+            return QStringList();
+        }
+        if (!allFiles && !requested.contains(info.name))
+            continue;
+        found.insert(info.name);
+
+        QString absFilePath = directory.absoluteFilePath(info.name);
+        if (info.name.endsWith('/')) {
+            if (!listedDirectories.contains(info.name)) {
+                listedDirectories.insert(info.name);
+                extracted.append(absFilePath);
+            }
+            directories.append(absFilePath);
+            continue;
+        }
+
+        ParallelExtractionEntry entry;
+        entry.destination = absFilePath;
+        unzGetFilePos64(zip.getUnzFile(), &entry.position);
+        entry.size = info.uncompressedSize;
+        entry.permissions = info.getPermissions();
+
+        // Two threads must never write the same file,
+        // so a later entry of the same name replaces the earlier one:
+        if (entryIndexes.contains(info.name)) {
+            entries[entryIndexes.value(info.name)] = entry;
+            continue;
+        }
+        entryIndexes.insert(info.name, entries.size());
+        entries.append(entry);
+        extracted.append(absFilePath);
+        directories.append(QFileInfo(absFilePath).absolutePath());
+    }
+    zip.close();
+    if (zip.getZipError() != 0 || (!allFiles && found.size() != requested.size())) {
+        return QStringList();
+    }
+
+    // Folders are created before the threads are started:
+    QDir curDir;
+    foreach (QString directoryName, directories.toSet()) {
+        if (!curDir.mkpath(directoryName)) {
+            return QStringList();
+        }
+    }
+
+    // Large entries are started first, so that
+    // no thread is left with a large entry at the end:
+    std::sort(entries.begin(), entries.end(), largerEntryFirst);
+
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+    threadCount = qMax(1, qMin(threadCount, entries.size()));
+
+    QAtomicInt nextEntry(0);
+    QAtomicInt failed(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int i=0; i<threadCount; i++) {
+        pool.start(new ParallelExtractionWorker(fileCompressed, entries,
+                                                nextEntry, failed));
+    }
+    pool.waitForDone();
+
+    if (failed.fetchAndAddOrdered(0) != 0) {
+        for (int i=0; i<entries.size(); i++) {
+            QFile::remove(entries.at(i).destination);
+        }
+        return QStringList();
+    }
+
+    return extracted;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 /**OK
@@ -412,6 +629,8 @@ QString JlCompress::extractFile(QString fileCompressed, QString fileName, QStrin
 QStringList JlCompress::extractFiles(QString fileCompressed, QStringList files, QString dir) {
     // Creo lo zip
     QuaZip zip(fileCompressed);
+    // Ogni file viene cercato per nome: l'indice evita di scorrere la directory centrale
+    zip.setFileNameIndexingEnabled(true);
     if(!zip.open(QuaZip::mdUnzip)) {
         return QStringList();
     }
@@ -480,6 +699,14 @@ QStringList JlCompress::extractDir(QString fileCompressed, QString dir) {
     return extracted;
 }
 
+QStringList JlCompress::extractFilesParallel(QString fileCompressed, QStringList files, QString dir, int threadCount) {
+    return extractEntriesParallel(fileCompressed, files, false, dir, threadCount);
+}
+
+QStringList JlCompress::extractDirParallel(QString fileCompressed, QString dir, int threadCount) {
+    return extractEntriesParallel(fileCompressed, QStringList(), true, dir, threadCount);
+}
+
 /**OK
  * Restituisce la lista dei file resenti nel file compresso fileCompressed.
  * Se la funzione fallisce, restituisce un elenco vuoto.
@@ -74,6 +74,16 @@ private:
       \return true if success, false otherwise.
       */
     static bool removeFile(QStringList listFile);
+    /// Extract entries using several threads.
+    /**
+      \param fileCompressed The name of the archive.
+      \param files The entries to extract, ignored if \a allFiles is true.
+      \param allFiles Whether to extract the whole archive.
+      \param dir The directory to put the files to.
+      \param threadCount The number of threads.
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractEntriesParallel(QString fileCompressed, QStringList files, bool allFiles, QString dir, int threadCount);
 
 public:
     /// Compress a single file.
@@ -127,6 +137,33 @@ public:
       \return The list of the full paths of the files extracted, empty on failure.
       */
     static QStringList extractDir(QString fileCompressed, QString dir = QString());
+    /// Extract a list of files using several threads.
+    /**
+      The central directory is read once. The entries are then inflated
+      and CRC-verified on a thread pool, every thread having its own
+      handle to the archive. If several entries have the same name,
+      only the last one is extracted.
+      \param fileCompressed The name of the archive.
+      \param files The file list to extract.
+      \param dir The directory to put the files to, the current
+      directory if left empty.
+      \param threadCount The number of threads,
+      QThread::idealThreadCount() if 0.
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractFilesParallel(QString fileCompressed, QStringList files, QString dir = QString(), int threadCount = 0);
+    /// Extract a whole archive using several threads.
+    /**
+      Same as extractDir(), but the entries are inflated like in
+      extractFilesParallel().
+      \param fileCompressed The name of the archive.
+      \param dir The directory to extract to, the current directory if
+      left empty.
+      \param threadCount The number of threads,
+      QThread::idealThreadCount() if 0.
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractDirParallel(QString fileCompressed, QString dir = QString(), int threadCount = 0);
     /// Get the file list.
     /**
       \return The list of the files in the archive, or, more precisely, the
@@ -25,9 +25,37 @@ quazip/(un)zip.h files for details, basically it's zlib license.
 #include <QFile>
 #include <QFlags>
 #include <QHash>
+#include <QVector>
+#include <QtAlgorithms>
 
 #include "quazip.h"
 
+/// A file name of the index with the number of its entry.
+/**
+  \internal
+
+  The index is sorted by name for prefix lookups, while listings
+  are given in the order of the central directory by the entry number.
+  */
+struct QuaZipIndexedName {
+    QString name;
+    int entry;
+};
+
+static bool indexedNameLessThan(const QuaZipIndexedName &first,
+                                const QuaZipIndexedName &second)
+{
+    if (first.name != second.name)
+        return first.name < second.name;
+    return first.entry < second.entry;
+}
+
+static bool indexedEntryLessThan(const QuaZipIndexedName &first,
+                                 const QuaZipIndexedName &second)
+{
+    return first.entry < second.entry;
+}
+
 /// All the internal stuff for the QuaZip class.
 /**
   \internal
@@ -69,6 +97,12 @@ class QuaZipPrivate {
     bool zip64;
     /// The auto-close flag.
     bool autoClose;
+    /// Whether the file name index is built by QuaZip::open().
+    bool fileNameIndexing;
+    /// Whether every file of the archive is in the directory map.
+    bool directoryMapComplete;
+    /// All file names of the archive, sorted, if the index is built.
+    QVector<QuaZipIndexedName> sortedFileNames;
     inline QTextCodec *getDefaultFileNameCodec()
     {
         if (defaultFileNameCodec == NULL) {
@@ -88,7 +122,9 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      fileNameIndexing(false),
+      directoryMapComplete(false)
     {
         lastMappedDirectoryEntry.num_of_file = 0;
         lastMappedDirectoryEntry.pos_in_zip_directory = 0;
@@ -105,7 +141,9 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      fileNameIndexing(false),
+      directoryMapComplete(false)
     {
         lastMappedDirectoryEntry.num_of_file = 0;
         lastMappedDirectoryEntry.pos_in_zip_directory = 0;
@@ -121,7 +159,9 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      fileNameIndexing(false),
+      directoryMapComplete(false)
     {
         lastMappedDirectoryEntry.num_of_file = 0;
         lastMappedDirectoryEntry.pos_in_zip_directory = 0;
@@ -134,6 +174,7 @@ class QuaZipPrivate {
       inline void clearDirectoryMap();
       inline void addCurrentFileToDirectoryMap(const QString &fileName);
       bool goToFirstUnmappedFile();
+      bool indexDirectory();
       QHash<QString, unz64_file_pos> directoryCaseSensitive;
       QHash<QString, unz64_file_pos> directoryCaseInsensitive;
       unz64_file_pos lastMappedDirectoryEntry;
@@ -148,6 +189,8 @@ void QuaZipPrivate::clearDirectoryMap()
     directoryCaseSensitive.clear();
     lastMappedDirectoryEntry.num_of_file = 0;
     lastMappedDirectoryEntry.pos_in_zip_directory = 0;
+    directoryMapComplete = false;
+    sortedFileNames.clear();
 }
 
 void QuaZipPrivate::addCurrentFileToDirectoryMap(const QString &fileName)
@@ -158,7 +201,10 @@ void QuaZipPrivate::addCurrentFileToDirectoryMap(const QString &fileName)
     // Adds current file to filename map as fileName
     unz64_file_pos fileDirectoryPos;
     unzGetFilePos64(unzFile_f, &fileDirectoryPos);
-    directoryCaseSensitive.insert(fileName, fileDirectoryPos);
+    // Only the first entry of a duplicated name is mapped,
+    // as unzLocateFile() would find it
+    if (!directoryCaseSensitive.contains(fileName))
+        directoryCaseSensitive.insert(fileName, fileDirectoryPos);
     // Only add lowercase to directory map if not already there
     // ensures only map the first one seen
     QString lower = fileName.toLower();
@@ -190,6 +236,32 @@ bool QuaZipPrivate::goToFirstUnmappedFile()
     return hasCurrentFile_f;
 }
 
+bool QuaZipPrivate::indexDirectory()
+{
+    // Walks the whole central directory once, mapping every file name
+    sortedFileNames.clear();
+    for (bool more = q->goToFirstFile(); more; more = q->goToNextFile()) {
+        QuaZipIndexedName indexedName;
+        indexedName.name = q->getCurrentFileName();
+        indexedName.entry = sortedFileNames.size();
+        if (indexedName.name.isEmpty()) {
+            clearDirectoryMap();
+            return false;
+        }
+        sortedFileNames.append(indexedName);
+    }
+    if (zipError != UNZ_OK) {
+        clearDirectoryMap();
+        return false;
+    }
+    qSort(sortedFileNames.begin(), sortedFileNames.end(), indexedNameLessThan);
+    directoryMapComplete = true;
+    // Leave the archive as a freshly opened one
+    unzGoToFirstFile(unzFile_f);
+    hasCurrentFile_f = false;
+    return true;
+}
+
 QuaZip::QuaZip():
   p(new QuaZipPrivate(this))
 {
@@ -258,6 +330,11 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
         }
         p->mode=mode;
         p->ioDevice = ioDevice;
+        if (p->fileNameIndexing) {
+            // A broken central directory is reported on the first lookup
+            p->indexDirectory();
+            p->zipError=UNZ_OK;
+        }
         return true;
       } else {
         p->zipError=UNZ_OPENERROR;
@@ -432,17 +509,20 @@ bool QuaZip::setCurrentFile(const QString& fileName, CaseSensitivity cs)
   p->hasCurrentFile_f=false;
 
   // Check the appropriate Map
-  unz64_file_pos fileDirPos;
-  fileDirPos.pos_in_zip_directory = 0;
+  // The first entry is at position 0, so the position can't tell
+  // whether the name is mapped
+  QHash<QString, unz64_file_pos>::const_iterator mapped;
+  bool isMapped;
   if (sens) {
-      if (p->directoryCaseSensitive.contains(fileName))
-          fileDirPos = p->directoryCaseSensitive.value(fileName);
+      mapped = p->directoryCaseSensitive.constFind(fileName);
+      isMapped = mapped != p->directoryCaseSensitive.constEnd();
   } else {
-      if (p->directoryCaseInsensitive.contains(lower))
-          fileDirPos = p->directoryCaseInsensitive.value(lower);
+      mapped = p->directoryCaseInsensitive.constFind(lower);
+      isMapped = mapped != p->directoryCaseInsensitive.constEnd();
   }
 
-  if (fileDirPos.pos_in_zip_directory != 0) {
+  if (isMapped) {
+      unz64_file_pos fileDirPos = mapped.value();
       p->zipError = unzGoToFilePos64(p->unzFile_f, &fileDirPos);
       p->hasCurrentFile_f = p->zipError == UNZ_OK;
   }
@@ -450,6 +530,10 @@ bool QuaZip::setCurrentFile(const QString& fileName, CaseSensitivity cs)
   if (p->hasCurrentFile_f)
       return p->hasCurrentFile_f;
 
+  // Everything is mapped, so the file is not in the archive
+  if (p->directoryMapComplete && !isMapped)
+      return false;
+
   // Not mapped yet, start from where we have got to so far
   for(bool more=p->goToFirstUnmappedFile(); more; more=goToNextFile()) {
     current=getCurrentFileName();
@@ -786,3 +870,45 @@ void QuaZip::setAutoClose(bool autoClose) const
 {
     p->autoClose = autoClose;
 }
+
+void QuaZip::setFileNameIndexingEnabled(bool enabled)
+{
+    if (isOpen()) {
+        qWarning("QuaZip::setFileNameIndexingEnabled(): ZIP is already open!");
+        return;
+    }
+    p->fileNameIndexing = enabled;
+}
+
+bool QuaZip::isFileNameIndexingEnabled() const
+{
+    return p->fileNameIndexing;
+}
+
+bool QuaZip::hasFileNameIndex() const
+{
+    return p->mode == mdUnzip && p->directoryMapComplete;
+}
+
+QStringList QuaZip::getIndexedFileNameList(const QString &prefix) const
+{
+    QStringList result;
+    if (!hasFileNameIndex())
+        return result;
+    // The sorted index gives the range of the prefix,
+    // the matches are then put back in the order of the central directory
+    QuaZipIndexedName first;
+    first.name = prefix;
+    first.entry = -1;
+    QVector<QuaZipIndexedName>::const_iterator it =
+        qLowerBound(p->sortedFileNames.constBegin(),
+                    p->sortedFileNames.constEnd(), first, indexedNameLessThan);
+    QVector<QuaZipIndexedName> matches;
+    for (; it != p->sortedFileNames.constEnd() && it->name.startsWith(prefix);
+            ++it)
+        matches.append(*it);
+    qSort(matches.begin(), matches.end(), indexedEntryLessThan);
+    for (int i = 0; i < matches.size(); ++i)
+        result.append(matches.at(i).name);
+    return result;
+}
@@ -529,6 +529,47 @@ class QUAZIP_EXPORT QuaZip {
       @sa setIoDevice()
       */
     void setAutoClose(bool autoClose) const;
+    /// Enables or disables the file name index.
+    /**
+      If enabled, open() in the mdUnzip mode walks the central directory
+      once and maps every file name, both as it is and in lower case,
+      to the position of its entry. setCurrentFile() then finds any file,
+      or finds out that it is missing, without walking the central
+      directory, and QuaZipDir lists only the entries under its path,
+      still in the order of the central directory.
+      QuaZipFile instances sharing this QuaZip are opened using the index too.
+
+      Without the index, file names are mapped only as the central directory
+      is walked, so looking up N missing or late files is O(N^2).
+      The index is disabled by default, because the walk at open() is
+      wasted if only a few files are looked up. It must be enabled before
+      open() is called.
+
+      @sa isFileNameIndexingEnabled()
+      @sa hasFileNameIndex()
+      */
+    void setFileNameIndexingEnabled(bool enabled);
+    /// Returns whether the file name index is enabled.
+    /**
+      @sa setFileNameIndexingEnabled()
+      */
+    bool isFileNameIndexingEnabled() const;
+    /// Returns whether all file names of the open archive are indexed.
+    /**
+      @sa setFileNameIndexingEnabled()
+      */
+    bool hasFileNameIndex() const;
+    /// Returns the indexed file names starting with the given prefix.
+    /**
+      The names are given in the order of the central directory, like
+      by getFileNameList(), and the comparison is case sensitive.
+      The index is sorted by name, so only the matching part of it is
+      visited and then only the matches are put back in order.
+      \return The list of the file names, empty if there is no index.
+
+      @sa hasFileNameIndex()
+      */
+    QStringList getIndexedFileNameList(const QString &prefix = QString()) const;
     /// Sets the default file name codec to use.
     /**
      * The default codec is used by the constructors, so calling this function
@@ -329,7 +329,18 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
     int baseLength = basePath.length();
     result.clear();
     QuaZipDirRestoreCurrent saveCurrent(zip);
-    if (!zip->goToFirstFile()) {
+    // With the file name index only the names under basePath are visited,
+    // otherwise the whole central directory is walked. Both give the names
+    // in the order of the central directory, which decides whether a
+    // folder is listed as its own entry or as the path of a file
+    bool indexed = zip->hasFileNameIndex();
+    QStringList indexedNames;
+    int indexedPosition = 0;
+    if (indexed) {
+        indexedNames = zip->getIndexedFileNameList(basePath);
+        if (indexedNames.isEmpty())
+            return true;
+    } else if (!zip->goToFirstFile()) {
         return zip->getZipError() == UNZ_OK;
     }
     QDir::Filters fltr = filter;
@@ -343,7 +354,8 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
     QSet<QString> dirsFound;
     QList<QuaZipFileInfo64> list;
     do {
-        QString name = zip->getCurrentFileName();
+        QString name = indexed ? indexedNames.at(indexedPosition)
+            : zip->getCurrentFileName();
         if (!name.startsWith(basePath))
             continue;
         QString relativeName = name.mid(baseLength);
@@ -367,6 +379,10 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
             continue;
         if (!nmfltr.isEmpty() && !QDir::match(nmfltr, relativeName))
             continue;
+        if (indexed && isReal
+                && !zip->setCurrentFile(name, QuaZip::csSensitive)) {
+            return false;
+        }
         bool ok;
         QuaZipFileInfo64 info = QuaZipDir_getFileInfo(zip, &ok, relativeName,
             isReal);
@@ -374,7 +390,8 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
             return false;
         }
         list.append(info);
-    } while (zip->goToNextFile());
+    } while (indexed ? ++indexedPosition < indexedNames.size()
+            : zip->goToNextFile());
     QDir::SortFlags srt = sort;
     if (srt == QDir::NoSort)
         srt = sorting;
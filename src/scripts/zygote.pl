@@ -0,0 +1,409 @@
+#!/usr/bin/perl -w
+
+use strict;
+use warnings;
+
+use Config;
+use Socket;
+use IO::Socket::UNIX;
+use POSIX qw(:sys_wait_h);
+
+# Fork-server ("zygote") started once by Perl Executing Browser.
+# Modules given on the command line are loaded only once here and
+# every request is served by a copy-on-write child of this process.
+# Command line: control socket, governor settings,
+# comma-separated prohibited core functions or empty string, modules.
+# Governor settings are the [perl] settings of peb.ini applied to
+# every script process: "CPU seconds,memory megabytes,open files,
+# nice level,termination grace period milliseconds", 0 means no limit.
+#
+# Request connection protocol "PEB-ZYGOTE 2":
+# The browser sends a magic line, a header length line and
+# a NUL-separated header - script, working directory and
+# environment variables as NAME=value.
+# Everything after the header is a stream of records in both directions:
+# one type byte, payload length as four bytes in network order, payload.
+#   I - browser to script: STDIN data, an empty I record closes STDIN
+#   P - script to browser: process group ID of the script, sent first
+#   O - script to browser: STDOUT data
+#   E - script to browser: STDERR data
+#   X - script to browser: "wait status, user CPU msecs, system CPU msecs"
+#       of the script and its reaped children, sent last
+# Every request is served by a session child of the fork-server, which
+# relays the records between the connection and the pipes of the script.
+# The script itself runs in a grandchild leading its own process group
+# with the resource limits and the nice level of the governor settings.
+# The browser stops a script by signalling this group and
+# a closed connection makes the session child signal the group too -
+# SIGTERM first and SIGKILL after the termination grace period.
+
+my $socket_path = shift @ARGV;
+my ($cpu_time_limit, $memory_limit, $open_files_limit, $nice_level, $grace_period) =
+	map { int ($_ || 0) } split (/,/, shift @ARGV);
+my $prohibited_core_functions = shift @ARGV;
+my @preload_modules = @ARGV;
+@ARGV = ();
+
+# Without a way to set resource limits, the fork-server does not start
+# and the browser starts every script as a new process with its limits:
+my $set_limit = limit_setter();
+if (not defined $set_limit and ($cpu_time_limit > 0 or $memory_limit > 0 or $open_files_limit > 0)) {
+	print STDERR "Resource limits can not be set without BSD::Resource, fork-server is not started.\n";
+	exit 1;
+}
+
+# Scripts are censored by the browser before they are sent here,
+# but the prohibited core functions are masked in every child:
+require Opcode if length ($prohibited_core_functions) > 0;
+
+foreach my $module (@preload_modules) {
+	if ($module !~ m/^\w+(::\w+)*$/) {
+		print STDERR "Invalid module name was not preloaded: $module\n";
+		next;
+	}
+	if (not eval "require $module; 1") {
+		print STDERR "Module $module was not preloaded: $@";
+	}
+}
+
+unlink $socket_path;
+my $server = IO::Socket::UNIX->new (Type => SOCK_STREAM, Local => $socket_path, Listen => 64) or
+	die "Control socket $socket_path could not be created: $!";
+
+# Finished session children are reaped automatically:
+$SIG{CHLD} = 'IGNORE';
+
+my $browser_pid = getppid();
+
+$| = 1;
+print "READY\n";
+
+while (1) {
+	my $connection = $server->accept();
+	if (not defined $connection) {
+		next if $!{EINTR};
+		die "Control socket failed: $!";
+	}
+
+	my $pid = fork();
+	if (not defined $pid) {
+		print STDERR "Request could not be forked: $!\n";
+		close $connection;
+		next;
+	}
+
+	if ($pid == 0) {
+		close $server;
+		$SIG{CHLD} = 'DEFAULT';
+		serve_request ($connection);
+		exit 0;
+	}
+
+	close $connection;
+
+	# The browser is gone:
+	last if getppid() != $browser_pid;
+}
+
+# Records are appended to a buffer and
+# complete ones are taken from its beginning:
+sub take_record {
+	my $buffer = shift;
+	return () if length ($$buffer) < 5;
+
+	my ($type, $length) = unpack ('a N', $$buffer);
+	return () if length ($$buffer) < 5 + $length;
+
+	my $payload = substr ($$buffer, 5, $length);
+	substr ($$buffer, 0, 5 + $length) = '';
+	return ($type, $payload);
+}
+
+sub send_record {
+	my ($connection, $type, $payload) = @_;
+	my $record = pack ('a N', $type, length ($payload)) . $payload;
+
+	while (length ($record) > 0) {
+		my $written = syswrite ($connection, $record);
+		if (not defined $written) {
+			next if $!{EINTR};
+			return 0;
+		}
+		substr ($record, 0, $written) = '';
+	}
+	return 1;
+}
+
+# The header is read without buffered I/O, so that
+# the records after it are seen by select():
+sub read_header {
+	my ($connection, $input) = @_;
+
+	while (1) {
+		if ($$input =~ m/^PEB-ZYGOTE 2\n(\d+)\n/) {
+			my $header_start = $+[0];
+			my $header_length = $1;
+			if (length ($$input) >= $header_start + $header_length) {
+				my $header = substr ($$input, $header_start, $header_length);
+				substr ($$input, 0, $header_start + $header_length) = '';
+				return $header;
+			}
+		} elsif (length ($$input) > 64) {
+			return undef;
+		}
+
+		my $read = sysread ($connection, $$input, 65536, length ($$input));
+		return undef if not $read;
+	}
+}
+
+sub serve_request {
+	my $connection = shift;
+	binmode $connection;
+
+	my $input = '';
+	my $header = read_header ($connection, \$input);
+	exit 1 if not defined $header;
+	my ($script, $working_directory, @environment) = split (/\0/, $header);
+
+	pipe (my $stdin_reader, my $stdin_writer) or exit 1;
+	pipe (my $stdout_reader, my $stdout_writer) or exit 1;
+	pipe (my $stderr_reader, my $stderr_writer) or exit 1;
+
+	my $pid = fork();
+	if (not defined $pid) {
+		send_record ($connection, 'E', "$script could not be forked: $!\n");
+		send_record ($connection, 'X', "65280 0 0");
+		exit 1;
+	}
+
+	if ($pid == 0) {
+		close $connection;
+		close $stdin_writer;
+		close $stdout_reader;
+		close $stderr_reader;
+
+		open (STDIN, '<&', $stdin_reader) or exit 1;
+		open (STDOUT, '>&', $stdout_writer) or exit 1;
+		open (STDERR, '>&', $stderr_writer) or exit 1;
+		close $stdin_reader;
+		close $stdout_writer;
+		close $stderr_writer;
+
+		run_script ($script, $working_directory, @environment);
+	}
+
+	close $stdin_reader;
+	close $stdout_writer;
+	close $stderr_writer;
+
+	# Set in both processes, so the group exists whichever runs first:
+	setpgrp ($pid, $pid);
+
+	# A script closing its STDIN early must not end the session child:
+	$SIG{PIPE} = 'IGNORE';
+
+	send_record ($connection, 'P', $pid) or stop_script ($pid);
+
+	relay ($connection, \$input, $stdin_writer, $stdout_reader, $stderr_reader, $pid);
+
+	waitpid ($pid, 0);
+	my $status = $?;
+	my (undef, undef, $children_user, $children_system) = times;
+	send_record ($connection, 'X',
+		join (' ', $status, int ($children_user * 1000), int ($children_system * 1000)));
+	close $connection;
+}
+
+# The group is checked every 50 milliseconds during the grace period.
+# The stopped script is reaped meanwhile, but its process group ID
+# can not be reused while any member of the group is alive:
+sub stop_script {
+	my $pid = shift;
+	kill ('TERM', -$pid);
+
+	for (my $check = 0; $check < $grace_period / 50; $check++) {
+		waitpid ($pid, WNOHANG);
+		exit 0 if not kill (0, -$pid);
+		select (undef, undef, undef, 0.05);
+	}
+
+	kill ('KILL', -$pid);
+	exit 0;
+}
+
+# Resource limits are set by BSD::Resource, when it is installed, or
+# by the setrlimit system call on Linux, where
+# the resource numbers of the common architectures are known:
+sub limit_setter {
+	if (eval { require BSD::Resource; 1 }) {
+		my %resources = (cpu => BSD::Resource::RLIMIT_CPU(),
+			memory => BSD::Resource::RLIMIT_AS(),
+			open_files => BSD::Resource::RLIMIT_NOFILE());
+		return sub {
+			my ($resource, $soft, $hard) = @_;
+			return BSD::Resource::setrlimit ($resources{$resource}, $soft, $hard);
+		};
+	}
+
+	if ($^O eq 'linux' and $Config{archname} =~ m/^(x86_64|i\d86|aarch64|arm)/ and
+		eval { local $SIG{__WARN__} = sub {}; require 'syscall.ph'; 1 }) {
+		my %resources = (cpu => 0, memory => 9, open_files => 7);
+		return sub {
+			my ($resource, $soft, $hard) = @_;
+			# struct rlimit is two unsigned longs:
+			my $limit = pack ('L! L!', $soft, $hard);
+			return syscall (SYS_setrlimit(), $resources{$resource}, $limit) == 0;
+		};
+	}
+
+	return undef;
+}
+
+sub apply_governor {
+	# The hard CPU limit is one second later and ends the script,
+	# if SIGXCPU at the soft limit is ignored:
+	$set_limit->('cpu', $cpu_time_limit, $cpu_time_limit + 1) if $cpu_time_limit > 0;
+	$set_limit->('memory', $memory_limit * 1048576, $memory_limit * 1048576) if $memory_limit > 0;
+	$set_limit->('open_files', $open_files_limit, $open_files_limit) if $open_files_limit > 0;
+
+	# PRIO_PROCESS is 0 and 0 is the calling process:
+	setpriority (0, 0, $nice_level) if $nice_level != 0;
+}
+
+# STDIN data waiting for the script is limited, so
+# the connection is not read further until the script reads its STDIN:
+sub relay {
+	my ($connection, $input, $stdin_writer, $stdout_reader, $stderr_reader, $pid) = @_;
+
+	$stdin_writer->blocking (0);
+
+	my $stdin_buffer = '';
+	my $stdin_closed = 0;
+	my %outputs = (fileno ($stdout_reader) => [$stdout_reader, 'O'],
+		fileno ($stderr_reader) => [$stderr_reader, 'E']);
+
+	while (keys %outputs) {
+		while (my ($type, $payload) = take_record ($input)) {
+			next if $type ne 'I';
+			if (length ($payload) == 0) {
+				$stdin_closed = 1;
+			} elsif (defined $stdin_writer) {
+				$stdin_buffer .= $payload;
+			}
+		}
+
+		if (defined $stdin_writer and $stdin_closed and length ($stdin_buffer) == 0) {
+			close $stdin_writer;
+			undef $stdin_writer;
+		}
+
+		my $read_set = '';
+		my $write_set = '';
+		if (length ($stdin_buffer) < 1048576) {
+			vec ($read_set, fileno ($connection), 1) = 1;
+		}
+		foreach my $output (keys %outputs) {
+			vec ($read_set, $output, 1) = 1;
+		}
+		if (defined $stdin_writer and length ($stdin_buffer) > 0) {
+			vec ($write_set, fileno ($stdin_writer), 1) = 1;
+		}
+
+		my $ready = select (my $readable = $read_set, my $writable = $write_set, undef, undef);
+		if ($ready < 0) {
+			next if $!{EINTR};
+			stop_script ($pid);
+		}
+
+		if (vec ($readable, fileno ($connection), 1)) {
+			my $read = sysread ($connection, $$input, 65536, length ($$input));
+			# The browser is gone or has aborted the script:
+			stop_script ($pid) if not $read;
+		}
+
+		if (defined $stdin_writer and vec ($writable, fileno ($stdin_writer), 1)) {
+			my $written = syswrite ($stdin_writer, $stdin_buffer);
+			if (defined $written) {
+				substr ($stdin_buffer, 0, $written) = '';
+			} elsif (not $!{EAGAIN} and not $!{EINTR}) {
+				# The script has closed its STDIN:
+				$stdin_buffer = '';
+				close $stdin_writer;
+				undef $stdin_writer;
+			}
+		}
+
+		foreach my $output (keys %outputs) {
+			next if not vec ($readable, $output, 1);
+			my ($reader, $type) = @{$outputs{$output}};
+			my $read = sysread ($reader, my $data, 65536);
+			next if not defined $read and $!{EINTR};
+			if ($read) {
+				send_record ($connection, $type, $data) or stop_script ($pid);
+			} else {
+				close $reader;
+				delete $outputs{$output};
+			}
+		}
+	}
+
+	close $stdin_writer if defined $stdin_writer;
+}
+
+# Switches on the shebang line, like '-w' or '-T':
+sub shebang_switches {
+	my $script = shift;
+	open (my $script_file, '<', $script) or return ();
+	my $first_line = <$script_file>;
+	close $script_file;
+
+	return () if not defined $first_line or $first_line !~ m/^#!\S*perl\S*\s+(.+?)\s*$/;
+	return grep { m/^-/ } split (/\s+/, $1);
+}
+
+sub run_script {
+	my ($script, $working_directory, @environment) = @_;
+
+	setpgrp (0, 0);
+	$SIG{PIPE} = 'DEFAULT';
+
+	# Applied before anything of the script runs and
+	# inherited by a new interpreter started for shebang switches:
+	apply_governor();
+
+	%ENV = ();
+	foreach my $variable (@environment) {
+		my ($name, $value) = split (/=/, $variable, 2);
+		$ENV{$name} = $value;
+	}
+	chdir $working_directory;
+
+	if (not -r $script) {
+		print STDERR "$script could not be read.\n";
+		exit 1;
+	}
+
+	# '-w' is applied here, but switches like '-T' can be applied only by
+	# a new interpreter, which loses the preloaded modules:
+	my @switches = shebang_switches ($script);
+	if (grep { $_ ne '-w' } @switches) {
+		my @command_line = @switches;
+		push @command_line, "-M-ops=$prohibited_core_functions" if length ($prohibited_core_functions) > 0;
+		exec { $^X } ($^X, @command_line, $script) or
+			print STDERR "$script could not be started: $!\n";
+		exit 1;
+	}
+	$^W = 1 if @switches;
+
+	$0 = $script;
+
+	if (length ($prohibited_core_functions) > 0) {
+		Opcode::opmask_add (Opcode::opset (split (/,/, $prohibited_core_functions)));
+	}
+
+	do $script;
+	print STDERR $@ if $@;
+
+	exit 0;
+}
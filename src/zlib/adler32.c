@@ -61,6 +61,124 @@ local uLong adler32_combine_ OF((uLong adler1, uLong adler2, z_off64_t len2));
 #  define MOD63(a) a %= BASE
 #endif
 
+#ifdef X86_SIMD
+
+#include <immintrin.h>
+
+/* =========================================================================
+ * Adler-32 of whole 32-byte blocks with SSSE3 or AVX2.  For every block
+ * sum2 gets 32 times the adler of the block start plus the bytes weighted
+ * 32..1, and adler gets the plain sum of the bytes.  The partial sums are
+ * kept in 32-bit lanes and reduced modulo BASE once per NMAX bytes, as in
+ * the scalar code.  adler and sum2 are split and less than BASE, len is a
+ * multiple of 32.
+ */
+local X86_TARGET("ssse3") uLong adler32_ssse3(unsigned long adler,
+                                              unsigned long sum2,
+                                              const Bytef *buf,
+                                              unsigned len)
+{
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    unsigned blocks = len / 32;
+    unsigned n;
+    __m128i v_ps, v_s1, v_s2, bytes1, bytes2;
+
+    while (blocks) {
+        n = NMAX / 32;
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+
+        v_ps = _mm_cvtsi32_si128((int)(adler * n));
+        v_s2 = _mm_cvtsi32_si128((int)sum2);
+        v_s1 = zero;
+        do {
+            bytes1 = _mm_loadu_si128((const __m128i *)buf);
+            bytes2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                       _mm_maddubs_epi16(bytes1, tap1), ones));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                       _mm_maddubs_epi16(bytes2, tap2), ones));
+            buf += 32;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        /* add up the lanes */
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0x4e));
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0xb1));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0x4e));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0xb1));
+        adler += (unsigned)_mm_cvtsi128_si32(v_s1);
+        sum2 = (unsigned)_mm_cvtsi128_si32(v_s2);
+        MOD(adler);
+        MOD(sum2);
+    }
+    return adler | (sum2 << 16);
+}
+
+/* ========================================================================= */
+local X86_TARGET("avx2") uLong adler32_avx2(unsigned long adler,
+                                            unsigned long sum2,
+                                            const Bytef *buf,
+                                            unsigned len)
+{
+    const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                         24, 23, 22, 21, 20, 19, 18, 17,
+                                         16, 15, 14, 13, 12, 11, 10, 9,
+                                         8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    unsigned blocks = len / 32;
+    unsigned n;
+    __m256i v_ps, v_s1, v_s2, bytes;
+    __m128i s1, s2;
+
+    while (blocks) {
+        n = NMAX / 32;
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+
+        v_ps = _mm256_setr_epi32((int)(adler * n), 0, 0, 0, 0, 0, 0, 0);
+        v_s2 = _mm256_setr_epi32((int)sum2, 0, 0, 0, 0, 0, 0, 0);
+        v_s1 = zero;
+        do {
+            bytes = _mm256_loadu_si256((const __m256i *)buf);
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes, zero));
+            v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(
+                       _mm256_maddubs_epi16(bytes, tap), ones));
+            buf += 32;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+
+        /* add up the lanes */
+        s1 = _mm_add_epi32(_mm256_castsi256_si128(v_s1),
+                           _mm256_extracti128_si256(v_s1, 1));
+        s2 = _mm_add_epi32(_mm256_castsi256_si128(v_s2),
+                           _mm256_extracti128_si256(v_s2, 1));
+        s1 = _mm_add_epi32(s1, _mm_shuffle_epi32(s1, 0x4e));
+        s1 = _mm_add_epi32(s1, _mm_shuffle_epi32(s1, 0xb1));
+        s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, 0x4e));
+        s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, 0xb1));
+        adler += (unsigned)_mm_cvtsi128_si32(s1);
+        sum2 = (unsigned)_mm_cvtsi128_si32(s2);
+        MOD(adler);
+        MOD(sum2);
+    }
+    return adler | (sum2 << 16);
+}
+
+#endif /* X86_SIMD */
+
 /* ========================================================================= */
 uLong ZEXPORT adler32(adler, buf, len)
     uLong adler;
@@ -101,6 +219,28 @@ uLong ZEXPORT adler32(adler, buf, len)
         return adler | (sum2 << 16);
     }
 
+#ifdef X86_SIMD
+    /* whole 32-byte blocks with SIMD, the tail with the loops below */
+    if (len >= 64 && adler < BASE && sum2 < BASE) {
+        int features = x86_cpu_features();
+
+        if (features & (X86_AVX2 | X86_SSSE3)) {
+            unsigned blocks = len & ~31U;
+
+            if (features & X86_AVX2)
+                adler = adler32_avx2(adler, sum2, buf, blocks);
+            else
+                adler = adler32_ssse3(adler, sum2, buf, blocks);
+            buf += blocks;
+            len -= blocks;
+            sum2 = adler >> 16;
+            adler &= 0xffff;
+            if (len == 0)
+                return adler | (sum2 << 16);
+        }
+    }
+#endif /* X86_SIMD */
+
     /* do length NMAX blocks -- requires just one modulo operation */
     while (len >= NMAX) {
         len -= NMAX;
@@ -139,6 +139,72 @@ const char * ZEXPORT zError(err)
     return ERR_MSG(err);
 }
 
+#ifdef X86_SIMD
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#else
+#  include <cpuid.h>
+#endif
+
+local volatile int x86_features = -1;
+
+/* ===========================================================================
+ * Returns the X86_* flags of the instruction sets usable by the kernels.
+ * AVX2 needs the support of the operating system for the YMM registers too.
+ * Concurrent first calls detect the same value, so no lock is needed.
+ */
+int ZLIB_INTERNAL x86_cpu_features()
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int max_leaf, xcr0;
+    int features;
+
+    if (x86_features >= 0)
+        return x86_features;
+
+    features = 0;
+#ifdef _MSC_VER
+    {
+        int info[4];
+        __cpuid(info, 0);
+        max_leaf = (unsigned int)info[0];
+        __cpuid(info, 1);
+        ecx = (unsigned int)info[2];
+    }
+#else
+    max_leaf = __get_cpuid_max(0, 0);
+    if (max_leaf >= 1)
+        __cpuid(1, eax, ebx, ecx, edx);
+    else
+        ecx = 0;
+#endif
+    if (ecx & (1U << 1))
+        features |= X86_PCLMUL;
+    if (ecx & (1U << 9))
+        features |= X86_SSSE3;
+
+    /* OSXSAVE and AVX, then XMM and YMM state enabled in XCR0 */
+    if ((ecx & (1U << 27)) && (ecx & (1U << 28)) && max_leaf >= 7) {
+#ifdef _MSC_VER
+        int info[4];
+        xcr0 = (unsigned int)_xgetbv(0);
+        __cpuidex(info, 7, 0);
+        ebx = (unsigned int)info[1];
+#else
+        __asm__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+#endif
+        if ((xcr0 & 6) == 6 && (ebx & (1U << 5)))
+            features |= X86_AVX2;
+    }
+
+    x86_features = features;
+    return features;
+}
+
+#endif /* X86_SIMD */
+
 #if defined(_WIN32_WCE)
     /* The Microsoft C Run-Time Library for Windows CE doesn't have
      * errno.  We define it as a global variable to simplify porting.
@@ -246,6 +246,26 @@ extern z_const char * const z_errmsg[10]; /* indexed by 2-zlib_error */
 #define ZFREE(strm, addr)  (*((strm)->zfree))((strm)->opaque, (voidpf)(addr))
 #define TRY_FREE(s, p) {if (p) ZFREE(s, p);}
 
+/* x86-64 kernels for crc32() and adler32(), selected at run time.
+   They are compiled with per-function target attributes, so the rest of
+   zlib keeps the baseline instruction set.  #define NO_X86_SIMD to leave
+   them out. */
+#if !defined(NO_X86_SIMD) && (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(_MSC_VER) || defined(__clang__) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || \
+                            (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define X86_SIMD
+#  ifdef _MSC_VER
+#    define X86_TARGET(isa)
+#  else
+#    define X86_TARGET(isa) __attribute__((target(isa)))
+#  endif
+#  define X86_PCLMUL 1
+#  define X86_SSSE3  2
+#  define X86_AVX2   4
+   int ZLIB_INTERNAL x86_cpu_features OF((void));
+#endif
+
 /* Reverse the bytes in a 32-bit value */
 #define ZSWAP32(q) ((((q) >> 24) & 0xff) + (((q) >> 8) & 0xff00) + \
                     (((q) & 0xff00) << 8) + (((q) & 0xff) << 24))
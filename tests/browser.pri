@@ -0,0 +1,36 @@
+# Settings shared by the tests of the browser classes.
+# peb.cpp is compiled with PEB_TESTS defined, so
+# every test program supplies its own main().
+
+QT += network testlib
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+# Qt4 specific settings:
+lessThan (QT_MAJOR_VERSION, 5) {
+  QT += webkit
+}
+
+# Qt5 specific settings:
+greaterThan (QT_MAJOR_VERSION, 4) {
+  QT += widgets webkitwidgets printsupport
+  DEFINES += HAVE_QT5
+}
+
+INCLUDEPATH += $$PWD/../src
+DEPENDPATH += $$PWD/../src
+
+HEADERS += $$PWD/../src/peb.h
+SOURCES += $$PWD/../src/peb.cpp
+RESOURCES += $$PWD/../src/peb.qrc
+
+DEFINES += PEB_TESTS
+DEFINES += APPLICATION_NAME=\\\"Perl_Executing_Browser\\\"
+DEFINES += APPLICATION_VERSION=\\\"0.1\\\"
+DEFINES += PSEUDO_DOMAIN=\\\"http://perl-executing-browser-pseudodomain/\\\"
+
+# ZIP packages and embedded Perl have their own tests:
+DEFINES += "SCRIPT_CENSORING=1"
+DEFINES += "ZIP_SUPPORT=0"
+DEFINES += "PERL_DEBUGGER_INTERACTION=1"
+DEFINES += "EMBEDDED_PERL=0"
@@ -0,0 +1,12 @@
+# Native script censor: parity with the line-based censor.pl and
+# a benchmark censoring a large generated script.
+
+TEMPLATE = app
+TARGET = tst_censor
+
+include (../browser.pri)
+
+DEFINES += CENSOR_TEST_DIRECTORY=\\\"$$PWD\\\"
+
+SOURCES += tst_censor.cpp
+OTHER_FILES += censor_reference.pl corpus/*.pl
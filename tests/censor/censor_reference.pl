@@ -4,13 +4,10 @@ use strict;
 use warnings;
 use 5.010;
 
-# http://www.perlmonks.org/?node_id=737134 "How to redirect STDOUT to an array (not executing program)"
-# http://www.perlmonks.org/?node_id=1013683 "How to restore from redirecting STDOUT to variable?"
-
-open (my $saved_stderr_filehandle, '>&', \*STDERR)  or die "Can't duplicate STDERR: $!";
-close STDERR;
-my $stderr;
-open (STDERR, '>', \$stderr) or die "Unable to open STDERR: $!";
+# Reference verdicts of the line-based censor.pl of earlier versions.
+# The rules below are copied unchanged from censor.pl, but
+# an approved script is not run - only the verdict is printed:
+# 'APPROVED' or 'REJECTED' followed by the problematic lines.
 
 my $file = $ARGV[0];
 open my $filehandle, '<', $file or die;
@@ -110,64 +107,12 @@ if ($line =~ m/\$ENV{'DOCUMENT_ROOT'}\s*=/) {
 
 }
 
-my $header = "<html>
-
-<head>
-<title>Perl Executing Browser - Errors</title>
-<meta http-equiv='Content-Type' content='text/html; charset=utf-8'>
-<style type='text/css'>body {text-align: left}</style>\n
-</head>
-
-<body>";
-
-my $footer = "</body>
-
-</html>";
 
 if (scalar (keys %problematic_lines) == 0) {
-	my $user_code = join ('', @user_code);
-	eval ($user_code);
-
-	close (STDERR) or die "Can't close STDERR: $!";
-	open (STDERR, '>&', $saved_stderr_filehandle) or die "Can't restore STDERR: $!";
+	print "APPROVED\n";
 } else {
-	close (STDERR) or die "Can't close STDERR: $!";
-	open (STDERR, '>&', $saved_stderr_filehandle) or die "Can't restore STDERR: $!";
-
-	print STDERR $header;
-	print STDERR "<p align='center'><font size='5' face='SansSerif'>";
-	print STDERR "Script execution was not attempted due to security violations:</font></p>\n";
-	
+	print "REJECTED\n";
 	while ((my $line, my $explanation) = each (%problematic_lines)){
-		print STDERR "<pre>";
-		print STDERR "$line";
-		print STDERR "$explanation";
-		print STDERR "</pre>";
-	}
-	
-	print STDERR $footer;
-	exit;
-}
-
-if ($@) {
-	if ($@ =~ m/trapped/) {
-		print STDERR $header;
-		print STDERR "<p align='center'><font size='5' face='SansSerif'>Unsecure code was blocked:</font></p>\n";
-		print STDERR "<pre>$@</pre>";
-		print STDERR $footer;
-		exit;
-	} else {
-		print STDERR $header;
-		print STDERR "<p align='center'><font size='5' face='SansSerif'>Errors were found during script execution:</font></p>\n";
-		print STDERR "<pre>$@</pre>";
-		print STDERR $footer;
-		exit;
+		print "$explanation $line";
 	}
 }
-
-if (defined($stderr)) {
-	print STDERR $header;
-	print STDERR "<p align='center'><font size='5' face='SansSerif'>Errors were found during script execution:</font></p>\n";
-	print STDERR "<pre>$stderr</pre>";
-	print STDERR $footer;
-}
@@ -0,0 +1,8 @@
+# censor: approved
+use strict;
+use warnings;
+use CGI::Simple::Standard qw(param);
+
+my $name = param('name') || 'world';
+print "Content-type: text/html\n\n";
+print "<p>Hello, $name!</p>\n";
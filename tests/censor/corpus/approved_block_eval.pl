@@ -0,0 +1,8 @@
+# censor: approved
+use strict;
+use warnings;
+
+my $result = eval { 1 / 1 };
+my $text = 'abc';
+$text =~ s/(b)/uc($1)/e;
+print "$result $text @{[ scalar localtime ]}\n";
@@ -0,0 +1,9 @@
+# censor: approved
+use strict;
+use warnings;
+
+my $relative_filepath = '/html/index.htm';
+open my $filehandle, '<', "$ENV{'DOCUMENT_ROOT'}$relative_filepath" or die;
+my @lines = <$filehandle>;
+close $filehandle;
+print scalar @lines;
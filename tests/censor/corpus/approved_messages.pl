@@ -0,0 +1,10 @@
+# censor: approved
+# reference: false positive - 'open' and 'use' are words of messages here
+use strict;
+use warnings;
+
+my $relative_filepath = 'data.txt';
+if (not -e $relative_filepath) {
+	die "Could not open the file $relative_filepath\n";
+}
+print "Please use the form below.\n";
@@ -0,0 +1,16 @@
+# censor: approved
+# reference: false positive - 'use' and 'open' are in POD and in plain text
+use strict;
+use warnings;
+
+print <<'END';
+Content-type: text/plain
+
+You may open the settings dialog to use another theme.
+END
+
+=head1 USAGE
+
+use POSIX; open the page with the browser.
+
+=cut
@@ -0,0 +1,3 @@
+# censor: rejected
+use strict;
+$ENV{'DOCUMENT_ROOT'} = '/';
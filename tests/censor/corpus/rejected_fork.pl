@@ -0,0 +1,3 @@
+# censor: rejected
+use strict;
+my $pid = fork();
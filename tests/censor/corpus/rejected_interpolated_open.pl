@@ -0,0 +1,3 @@
+# censor: rejected
+use strict;
+print "@{[ open(my $file, '>', 'created.txt') ]}\n";
@@ -0,0 +1,4 @@
+# censor: rejected
+use strict;
+my $code = q{open my $file, '>', '/tmp/created.txt';};
+print $code;
@@ -0,0 +1,3 @@
+# censor: rejected
+use strict;
+'abc' =~ m/a(?{ unlink 'data.txt' })b/;
@@ -0,0 +1,3 @@
+# censor: rejected
+use strict;
+eval "use POSIX; 1" or die;
@@ -0,0 +1,4 @@
+# censor: rejected
+use strict;
+my $code = 'use ' . 'Socket';
+eval $code;
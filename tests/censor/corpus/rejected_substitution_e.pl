@@ -0,0 +1,5 @@
+# censor: rejected
+use strict;
+my $text = 'x';
+$text =~ s/x/use Socket; 1/e;
+print $text;
@@ -0,0 +1,4 @@
+# censor: rejected
+use strict;
+my $text = q(system 'id');
+$text =~ s/(.+)/$1/ee;
@@ -0,0 +1,7 @@
+# censor: rejected
+use strict;
+my $code = <<"END";
+use Socket;
+print "connected";
+END
+print $code;
@@ -0,0 +1,4 @@
+# censor: rejected
+use strict;
+use POSIX qw(floor);
+print floor(1.5);
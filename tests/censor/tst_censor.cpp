@@ -0,0 +1,157 @@
+// Every script in the 'corpus' folder starts with its expected verdict:
+// '# censor: approved' or '# censor: rejected'.
+// The native censor must give the expected verdict and
+// must reject every script rejected by censor_reference.pl,
+// the rules of the line-based censor.pl of earlier versions.
+// Scripts where only the reference censor objects to plain text
+// are marked with '# reference: false positive'.
+
+#include <QtTest>
+#include "peb.h"
+
+class CensorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void corpusParity_data();
+    void corpusParity();
+    void violationLines();
+    void largeScriptBenchmark();
+
+private:
+    QString referenceVerdict(QString scriptFileName);
+
+    QString testDirectoryName;
+};
+
+QString CensorTest::referenceVerdict(QString scriptFileName)
+{
+    QProcess reference;
+    reference.start("perl", QStringList()
+                    << QString(CENSOR_TEST_DIRECTORY) + "/censor_reference.pl"
+                    << scriptFileName);
+    reference.waitForFinished(10000);
+    return QString(reference.readAllStandardOutput()).section('\n', 0, 0);
+}
+
+void CensorTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-censor-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    // Censor verdicts are cached in the temporary folder of the browser:
+    qApp->setProperty("applicationTempDirectory", testDirectoryName);
+}
+
+void CensorTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void CensorTest::corpusParity_data()
+{
+    QTest::addColumn<QString>("scriptFileName");
+
+    QDir corpusDirectory(QString(CENSOR_TEST_DIRECTORY) + "/corpus");
+    foreach (QString fileName,
+             corpusDirectory.entryList(QStringList() << "*.pl", QDir::Files)) {
+        QTest::newRow(fileName.toLatin1())
+                << corpusDirectory.absoluteFilePath(fileName);
+    }
+}
+
+void CensorTest::corpusParity()
+{
+    QFETCH(QString, scriptFileName);
+
+    QFile scriptFile(scriptFileName);
+    QVERIFY(scriptFile.open(QIODevice::ReadOnly));
+    QString header = scriptFile.read(512);
+    scriptFile.close();
+
+    bool expectedApproval = header.startsWith("# censor: approved");
+    bool referenceFalsePositive =
+            header.contains("# reference: false positive");
+
+    ScriptCensor censor;
+    censor.censorScript(scriptFileName);
+    QCOMPARE(censor.approved, expectedApproval);
+
+    QString reference = referenceVerdict(scriptFileName);
+    QVERIFY(reference == "APPROVED" or reference == "REJECTED");
+    if (reference == "REJECTED" and censor.approved == true) {
+        QVERIFY2(referenceFalsePositive,
+                 "Approved a script rejected by censor.pl.");
+    }
+}
+
+void CensorTest::violationLines()
+{
+    QString scriptFileName = testDirectoryName + "/violation_lines.pl";
+    QFile scriptFile(scriptFileName);
+    QVERIFY(scriptFile.open(QIODevice::WriteOnly));
+    scriptFile.write("use strict;\n"
+                     "my $text = 'x';\n"
+                     "$text =~ s{x}\n"
+                     "          {use Socket; 1}e;\n"
+                     "print <<END;\n"
+                     "first\n"
+                     "use IO::Socket;\n"
+                     "END\n");
+    scriptFile.close();
+
+    ScriptCensor censor;
+    censor.censorScript(scriptFileName);
+    QVERIFY(!censor.approved);
+
+    QString html = censor.violationsHtml();
+    QVERIFY(html.contains("Line 4:"));
+    QVERIFY(html.contains("Line 7:"));
+}
+
+void CensorTest::largeScriptBenchmark()
+{
+    // A script with a violation on its last line is never cached as approved,
+    // so every iteration censors the whole script:
+    QByteArray block(
+                "my %data = (name => 'value', count => 42);\n"
+                "foreach my $key (sort keys %data) {\n"
+                "    print \"$key: $data{$key} @{[ length $key ]}\\n\";\n"
+                "}\n"
+                "my $text = q{plain text with open words};\n"
+                "$text =~ s/(\\w+)/uc($1)/ge;\n"
+                "print <<END;\n"
+                "<p>$text</p>\n"
+                "END\n"
+                "# a comment with use POSIX;\n");
+
+    QByteArray script("use strict;\nuse warnings;\n");
+    for (int index = 0; index < 2000; index++) {
+        script.append(block);
+    }
+    script.append("use POSIX;\n");
+
+    QString scriptFileName = testDirectoryName + "/large_script.pl";
+    QFile scriptFile(scriptFileName);
+    QVERIFY(scriptFile.open(QIODevice::WriteOnly));
+    scriptFile.write(script);
+    scriptFile.close();
+
+    ScriptCensor censor;
+    QBENCHMARK {
+        censor.censorScript(scriptFileName);
+    }
+    QVERIFY(!censor.approved);
+    QCOMPARE(censor.violationsHtml().count("<pre>"), 1);
+}
+
+QTEST_MAIN(CensorTest)
+#include "tst_censor.moc"
@@ -0,0 +1,9 @@
+# FastCGI requests and responders against a fake responder socket,
+# timed against a new process for every request.
+
+TEMPLATE = app
+TARGET = tst_fastcgi
+
+include (../browser.pri)
+
+SOURCES += tst_fastcgi.cpp
@@ -0,0 +1,376 @@
+// FastCGI requests are checked against a fake responder listening on
+// a local socket, and the environment of a real responder process is
+// checked with a small Perl script that writes its variable names to a file.
+// The fake responder does not need CGI::Fast or FCGI.
+// The same script is also timed as a FastCGI responder and
+// as a new process for every request, the responder side of
+// the FastCGI protocol is implemented in pure Perl there.
+
+#include <QtTest>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "peb.h"
+
+class FastCgiTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void requestSendsParamsAndStdin();
+    void responderEnvironmentHasNoRequestVariables();
+    void responderAndNewProcessBenchmark_data();
+    void responderAndNewProcessBenchmark();
+
+private:
+    struct Record {
+        int type;
+        int requestId;
+        QByteArray content;
+    };
+
+    static bool takeRecord(QByteArray &data, Record &record);
+    static QHash<QByteArray, QByteArray> nameValuePairs(QByteArray body);
+    static QByteArray record(int type, int requestId, QByteArray content);
+    static bool waitFor(QSignalSpy &spy, int milliseconds);
+    QByteArray runBenchmarkScript(bool responder);
+
+    QString testDirectoryName;
+    QString benchmarkScriptFileName;
+    QProcessEnvironment benchmarkEnvironment;
+};
+
+bool FastCgiTest::takeRecord(QByteArray &data, Record &record)
+{
+    if (data.size() < 8) {
+        return false;
+    }
+
+    int contentLength = ((unsigned char) data.at(4) << 8)
+            | (unsigned char) data.at(5);
+    int paddingLength = (unsigned char) data.at(6);
+    if (data.size() < 8 + contentLength + paddingLength) {
+        return false;
+    }
+
+    record.type = (unsigned char) data.at(1);
+    record.requestId = ((unsigned char) data.at(2) << 8)
+            | (unsigned char) data.at(3);
+    record.content = data.mid(8, contentLength);
+    data.remove(0, 8 + contentLength + paddingLength);
+    return true;
+}
+
+QHash<QByteArray, QByteArray> FastCgiTest::nameValuePairs(QByteArray body)
+{
+    QHash<QByteArray, QByteArray> pairs;
+
+    int position = 0;
+    while (position < body.size()) {
+        int lengths[2];
+        for (int index = 0; index < 2; index++) {
+            unsigned char first = (unsigned char) body.at(position);
+            if (first < 128) {
+                lengths[index] = first;
+                position = position + 1;
+            } else {
+                lengths[index] = ((first & 0x7F) << 24)
+                        | ((unsigned char) body.at(position + 1) << 16)
+                        | ((unsigned char) body.at(position + 2) << 8)
+                        | (unsigned char) body.at(position + 3);
+                position = position + 4;
+            }
+        }
+        QByteArray name = body.mid(position, lengths[0]);
+        QByteArray value = body.mid(position + lengths[0], lengths[1]);
+        pairs.insert(name, value);
+        position = position + lengths[0] + lengths[1];
+    }
+
+    return pairs;
+}
+
+QByteArray FastCgiTest::record(int type, int requestId, QByteArray content)
+{
+    QByteArray data;
+    data.append(char(1));
+    data.append(char(type));
+    data.append(char((requestId >> 8) & 0xFF));
+    data.append(char(requestId & 0xFF));
+    data.append(char((content.size() >> 8) & 0xFF));
+    data.append(char(content.size() & 0xFF));
+    data.append(char(0));
+    data.append(char(0));
+    data.append(content);
+    return data;
+}
+
+bool FastCgiTest::waitFor(QSignalSpy &spy, int milliseconds)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (spy.count() == 0 and timer.elapsed() < milliseconds) {
+        QTest::qWait(10);
+    }
+    return spy.count() > 0;
+}
+
+void FastCgiTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-fastcgi-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    qApp->setProperty("applicationTempDirectory", testDirectoryName);
+    qApp->setProperty("perlInterpreter", "perl");
+}
+
+void FastCgiTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    // Sockets of responders are system files:
+    foreach (QString fileName,
+             testDirectory.entryList(QDir::Files | QDir::System)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void FastCgiTest::requestSendsParamsAndStdin()
+{
+    QString socketName = testDirectoryName + "/fake-responder.sock";
+    QLocalServer::removeServer(socketName);
+    QLocalServer server;
+    QVERIFY(server.listen(socketName));
+
+    QProcessEnvironment params;
+    params.insert("REQUEST_METHOD", "POST");
+    params.insert("QUERY_STRING", "first=1&second=2");
+    params.insert("CONTENT_LENGTH", "5");
+    params.insert("LONG_VALUE", QString(300, 'x'));
+
+    // The request is read in the I/O thread, the responder in this one.
+    // STDIN given to the request goes first, the streamed body after it:
+    QBuffer uploadBuffer;
+    uploadBuffer.setData(QByteArray(" world"));
+    uploadBuffer.open(QIODevice::ReadOnly);
+
+    ScriptJob job(0, testDirectoryName + "/fake_responder.pl");
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.uploadDevice = &uploadBuffer;
+    job.attachRequest(new FastCgiRequest(&job, socketName, 7, params,
+                                         QByteArray("hello")));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!server.hasPendingConnections() and timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    QLocalSocket *responder = server.nextPendingConnection();
+    QVERIFY(responder != 0);
+
+    // Read records until the empty record closing the STDIN stream:
+    QByteArray receivedData;
+    QByteArray paramsBody;
+    QByteArray stdinData;
+    bool beginRequestReceived = false;
+    bool stdinClosed = false;
+    timer.restart();
+    while (stdinClosed == false and timer.elapsed() < 5000) {
+        QTest::qWait(10);
+        receivedData.append(responder->readAll());
+
+        Record received;
+        while (takeRecord(receivedData, received)) {
+            QCOMPARE(received.requestId, 7);
+            if (received.type == 1) {
+                beginRequestReceived = true;
+            }
+            if (received.type == 4) {
+                paramsBody.append(received.content);
+            }
+            if (received.type == 5) {
+                if (received.content.isEmpty()) {
+                    stdinClosed = true;
+                }
+                stdinData.append(received.content);
+            }
+        }
+    }
+    QVERIFY(beginRequestReceived);
+    QVERIFY(stdinClosed);
+    QCOMPARE(stdinData, QByteArray("hello world"));
+
+    QHash<QByteArray, QByteArray> receivedParams = nameValuePairs(paramsBody);
+    QCOMPARE(receivedParams.value("REQUEST_METHOD"), QByteArray("POST"));
+    QCOMPARE(receivedParams.value("QUERY_STRING"),
+             QByteArray("first=1&second=2"));
+    QCOMPARE(receivedParams.value("CONTENT_LENGTH"), QByteArray("5"));
+    QCOMPARE(receivedParams.value("LONG_VALUE"), QByteArray(300, 'x'));
+
+    responder->write(record(6, 7, "Content-Type: text/plain\r\n\r\nanswer"));
+    responder->write(record(6, 7, QByteArray()));
+    responder->write(record(3, 7, QByteArray(8, char(0))));
+    responder->flush();
+
+    QVERIFY(waitFor(finishedSpy, 5000));
+    QByteArray receivedOutput;
+    for (int index = 0; index < outputSpy.count(); index++) {
+        receivedOutput.append(outputSpy.at(index).at(0).toByteArray());
+    }
+
+    // Headers are parsed by the I/O thread, only the body is handed over:
+    QCOMPARE(receivedOutput, QByteArray("answer"));
+    QVERIFY(job.responseParser.headersComplete);
+    QCOMPARE(job.responseParser.mimeType(), QByteArray("text/plain"));
+}
+
+void FastCgiTest::responderEnvironmentHasNoRequestVariables()
+{
+    QString environmentFileName = testDirectoryName + "/responder.env";
+    QString scriptFileName = testDirectoryName + "/environment_responder.pl";
+
+    QFile scriptFile(scriptFileName);
+    QVERIFY(scriptFile.open(QIODevice::WriteOnly));
+    scriptFile.write(
+                "open(my $file, '>', $ENV{PEB_TEST_ENVIRONMENT_FILE}) or die;\n"
+                "print $file \"$_\\n\" foreach sort keys %ENV;\n"
+                "close($file);\n");
+    scriptFile.close();
+
+    QProcessEnvironment environment;
+    environment.insert("PATH", QProcessEnvironment::systemEnvironment()
+                       .value("PATH"));
+    environment.insert("PEB_TEST_ENVIRONMENT_FILE", environmentFileName);
+    environment.insert("REQUEST_METHOD", "GET");
+    environment.insert("QUERY_STRING", "first=1");
+    environment.insert("PEB_SCRIPT_JOB_ID", "42");
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.attachRequest(FastCgiResponder::responderForScript(scriptFileName)
+                      ->startRequest(&job, environment, QByteArray()));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!QFile::exists(environmentFileName) and timer.elapsed() < 10000) {
+        QTest::qWait(10);
+    }
+    QTest::qWait(100);
+    job.abortSlot();
+    QVERIFY(waitFor(finishedSpy, 5000));
+
+    QFile environmentFile(environmentFileName);
+    QVERIFY(environmentFile.open(QIODevice::ReadOnly));
+    QList<QByteArray> names = environmentFile.readAll().split('\n');
+
+    QVERIFY(names.contains("FCGI_SOCKET_PATH"));
+    QVERIFY(names.contains("PEB_TEST_ENVIRONMENT_FILE"));
+    QVERIFY(!names.contains("REQUEST_METHOD"));
+    QVERIFY(!names.contains("QUERY_STRING"));
+    QVERIFY(!names.contains("PEB_SCRIPT_JOB_ID"));
+}
+
+void FastCgiTest::responderAndNewProcessBenchmark_data()
+{
+    QTest::addColumn<bool>("responder");
+
+    QTest::newRow("FastCGI responder") << true;
+    QTest::newRow("new process") << false;
+}
+
+// Both runs start the same script. Without FCGI_SOCKET_PATH
+// it prints its response once and ends, otherwise
+// it answers requests until the test ends:
+void FastCgiTest::responderAndNewProcessBenchmark()
+{
+    QFETCH(bool, responder);
+
+    benchmarkScriptFileName = testDirectoryName + "/benchmark.pl";
+    if (!QFile::exists(benchmarkScriptFileName)) {
+        QFile scriptFile(benchmarkScriptFileName);
+        QVERIFY(scriptFile.open(QIODevice::WriteOnly));
+        scriptFile.write(
+                    "use strict;\n"
+                    "use IO::Socket::UNIX;\n"
+                    "my $output = \"Content-Type: text/plain\\r\\n\\r\\nanswer\";\n"
+                    "if (not defined $ENV{FCGI_SOCKET_PATH}) {\n"
+                    "    print $output;\n"
+                    "    exit;\n"
+                    "}\n"
+                    "sub record {\n"
+                    "    my ($type, $id, $content) = @_;\n"
+                    "    return pack ('CCnnCx', 1, $type, $id,\n"
+                    "                 length $content, 0) . $content;\n"
+                    "}\n"
+                    "sub read_exactly {\n"
+                    "    my ($connection, $length) = @_;\n"
+                    "    my $data = '';\n"
+                    "    while (length $data < $length) {\n"
+                    "        return undef unless sysread ($connection, $data,\n"
+                    "            $length - length $data, length $data);\n"
+                    "    }\n"
+                    "    return $data;\n"
+                    "}\n"
+                    "my $server = IO::Socket::UNIX->new (\n"
+                    "    Local => $ENV{FCGI_SOCKET_PATH}, Listen => 5) or die;\n"
+                    "while (my $connection = $server->accept) {\n"
+                    "    my $id = 1;\n"
+                    "    while (defined (my $header =\n"
+                    "                    read_exactly ($connection, 8))) {\n"
+                    "        my (undef, $type, $request_id, $length, $padding) =\n"
+                    "            unpack ('CCnnC', $header);\n"
+                    "        $id = $request_id;\n"
+                    "        read_exactly ($connection, $length + $padding);\n"
+                    "        last if $type == 5 and $length == 0;\n"
+                    "    }\n"
+                    "    print $connection record (6, $id, $output),\n"
+                    "        record (6, $id, ''), record (3, $id, \"\\0\" x 8);\n"
+                    "    close $connection;\n"
+                    "}\n");
+        scriptFile.close();
+    }
+
+    benchmarkEnvironment.insert("PATH", QProcessEnvironment::systemEnvironment()
+                                .value("PATH"));
+
+    // The responder is started by the first request:
+    QCOMPARE(runBenchmarkScript(responder), QByteArray("answer"));
+
+    QBENCHMARK {
+        QCOMPARE(runBenchmarkScript(responder), QByteArray("answer"));
+    }
+}
+
+QByteArray FastCgiTest::runBenchmarkScript(bool responder)
+{
+    ScriptJob job(0, benchmarkScriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+
+    if (responder == true) {
+        job.attachRequest(FastCgiResponder::responderForScript(
+                              benchmarkScriptFileName)
+                          ->startRequest(&job, benchmarkEnvironment,
+                                         QByteArray()));
+    } else {
+        job.startProcess("perl", QStringList() << benchmarkScriptFileName,
+                         benchmarkEnvironment, testDirectoryName,
+                         QByteArray());
+    }
+
+    if (!waitFor(finishedSpy, 10000)) {
+        return QByteArray();
+    }
+
+    QByteArray output;
+    for (int index = 0; index < outputSpy.count(); index++) {
+        output.append(outputSpy.at(index).at(0).toByteArray());
+    }
+    return output;
+}
+
+QTEST_MAIN(FastCgiTest)
+#include "tst_fastcgi.moc"
@@ -0,0 +1,8 @@
+# File type detection: extensions, shebang lines and the shebang cache.
+
+TEMPLATE = app
+TARGET = tst_filedetector
+
+include (../browser.pri)
+
+SOURCES += tst_filedetector.cpp
@@ -0,0 +1,159 @@
+// Files without an extension are detected by their shebang line,
+// which is read again only when the file is replaced or changed.
+
+#include <QtTest>
+#include "peb.h"
+
+class FileDetectorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void extensions_data();
+    void extensions();
+    void mimeTypes_data();
+    void mimeTypes();
+    void shebangLines();
+    void shebangCachedUntilFileChanges();
+    void lookupBenchmark_data();
+    void lookupBenchmark();
+
+private:
+    QString writeFile(QString fileName, QByteArray contents);
+
+    QString testDirectoryName;
+};
+
+QString FileDetectorTest::writeFile(QString fileName, QByteArray contents)
+{
+    QString filePath = testDirectoryName + "/" + fileName;
+    QFile file(filePath);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(contents);
+    file.close();
+    return filePath;
+}
+
+void FileDetectorTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-filedetector-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    qApp->setProperty("perlInterpreter", "perl");
+}
+
+void FileDetectorTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void FileDetectorTest::extensions_data()
+{
+    QTest::addColumn<QString>("filePath");
+    QTest::addColumn<QString>("fileType");
+
+    QTest::newRow("html") << "/root/index.html" << "browser-html";
+    QTest::newRow("upper case") << "/root/INDEX.HTM" << "browser-html";
+    QTest::newRow("image") << "/root/images/logo.Png" << "browser-image";
+    QTest::newRow("perl") << "/root/scripts/env.pl" << "perl";
+    QTest::newRow("unknown") << "/root/archive.tar.gz" << "undefined";
+    QTest::newRow("dot in folder name")
+            << "/root/folder.d/script" << "undefined";
+}
+
+void FileDetectorTest::extensions()
+{
+    QFETCH(QString, filePath);
+    QFETCH(QString, fileType);
+
+    QCOMPARE(FileDetector::instance()->lookup(filePath), fileType);
+}
+
+void FileDetectorTest::mimeTypes_data()
+{
+    QTest::addColumn<QString>("filePath");
+    QTest::addColumn<QString>("mimeType");
+
+    QTest::newRow("html") << "/root/index.HTML" << "text/html";
+    QTest::newRow("jpeg") << "/root/photo.jpg" << "image/jpeg";
+    QTest::newRow("svg") << "/root/icon.svg" << "image/svg+xml";
+    QTest::newRow("font") << "/root/fonts/text.woff2" << "font/woff2";
+    QTest::newRow("json") << "/root/data.json" << "application/json";
+    QTest::newRow("unknown") << "/root/data.bin" << "application/octet-stream";
+    QTest::newRow("no extension") << "/root/README" << "application/octet-stream";
+}
+
+void FileDetectorTest::mimeTypes()
+{
+    QFETCH(QString, filePath);
+    QFETCH(QString, mimeType);
+
+    QCOMPARE(FileDetector::instance()->mimeType(
+                 FileDetector::extension(filePath)), mimeType);
+}
+
+void FileDetectorTest::shebangLines()
+{
+    QString perlScript = writeFile("perl_script",
+                                   "#!/usr/bin/perl -w\nprint 1;\n");
+    QString shellScript = writeFile("shell_script",
+                                    "#!/bin/sh\necho 1\n");
+    QString plainText = writeFile("plain_text", "perl is mentioned here\n");
+
+    FileDetector *fileDetector = FileDetector::instance();
+    QCOMPARE(fileDetector->lookup(perlScript), QString("perl"));
+    QCOMPARE(fileDetector->lookup(shellScript), QString("undefined"));
+    QCOMPARE(fileDetector->lookup(plainText), QString("undefined"));
+    QCOMPARE(fileDetector->lookup(testDirectoryName + "/missing"),
+             QString("undefined"));
+}
+
+void FileDetectorTest::shebangCachedUntilFileChanges()
+{
+    FileDetector *fileDetector = FileDetector::instance();
+    QString script = writeFile("changing_script", "#!/bin/sh\necho 1\n");
+
+    qint64 shebangReads = fileDetector->shebangReads;
+    QCOMPARE(fileDetector->lookup(script), QString("undefined"));
+    QCOMPARE(fileDetector->lookup(script), QString("undefined"));
+    QCOMPARE(fileDetector->shebangReads, shebangReads + 1);
+
+    // A file of another size is read again:
+    writeFile("changing_script", "#!/usr/bin/perl\nprint 1;\n");
+    QCOMPARE(fileDetector->lookup(script), QString("perl"));
+    QCOMPARE(fileDetector->shebangReads, shebangReads + 2);
+}
+
+void FileDetectorTest::lookupBenchmark_data()
+{
+    QTest::addColumn<bool>("withExtension");
+
+    QTest::newRow("extension") << true;
+    QTest::newRow("cached shebang") << false;
+}
+
+void FileDetectorTest::lookupBenchmark()
+{
+    QFETCH(bool, withExtension);
+
+    QString filePath = writeFile(withExtension ? "benchmark.pl"
+                                               : "benchmark_script",
+                                 "#!/usr/bin/perl\nprint 1;\n");
+    FileDetector *fileDetector = FileDetector::instance();
+
+    QBENCHMARK {
+        for (int index = 0; index < 1000; index++) {
+            QCOMPARE(fileDetector->lookup(filePath), QString("perl"));
+        }
+    }
+}
+
+QTEST_MAIN(FileDetectorTest)
+#include "tst_filedetector.moc"
@@ -0,0 +1,8 @@
+# Parallel extraction of JlCompress: same files as the sequential one.
+
+TEMPLATE = app
+TARGET = tst_jlcompress
+
+include (../quazip.pri)
+
+SOURCES += tst_jlcompress.cpp
@@ -0,0 +1,224 @@
+// Archives are written by QuaZip into a temporary folder.
+// Parallel extraction must give the same files as the sequential
+// extraction, also for archives with several entries of the same name,
+// where the last entry wins.
+
+#include <QtTest>
+#include "quazip/quazip.h"
+#include "quazip/quazipfile.h"
+#include "quazip/JlCompress.h"
+
+class JlCompressTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void sameFilesAsSequentialExtraction();
+    void lastDuplicateEntryWins();
+    void missingEntryFails();
+    void extractionBenchmark_data();
+    void extractionBenchmark();
+
+private:
+    bool writeArchive(QString archiveName,
+                      QList<QPair<QString, QByteArray> > archiveEntries);
+    static QHash<QString, QByteArray> readFiles(QString directoryName);
+    static void removeDirectory(QString directoryName);
+    static QByteArray randomData(int size);
+
+    QString testDirectoryName;
+    QString archiveName;
+    QList<QPair<QString, QByteArray> > archiveEntries;
+};
+
+bool JlCompressTest::writeArchive(QString archiveName,
+                                  QList<QPair<QString, QByteArray> > archiveEntries)
+{
+    QuaZip zip(archiveName);
+    if (!zip.open(QuaZip::mdCreate)) {
+        return false;
+    }
+
+    for (int index = 0; index < archiveEntries.size(); index++) {
+        QuaZipFile file(&zip);
+        if (!file.open(QIODevice::WriteOnly,
+                       QuaZipNewInfo(archiveEntries.at(index).first))) {
+            return false;
+        }
+        file.write(archiveEntries.at(index).second);
+        file.close();
+        if (file.getZipError() != UNZ_OK) {
+            return false;
+        }
+    }
+
+    zip.close();
+    return (zip.getZipError() == UNZ_OK);
+}
+
+QHash<QString, QByteArray> JlCompressTest::readFiles(QString directoryName)
+{
+    QHash<QString, QByteArray> files;
+    QDir directory(directoryName);
+    QDirIterator iterator(directoryName, QDir::Files,
+                          QDirIterator::Subdirectories);
+    while (iterator.hasNext()) {
+        QFile file(iterator.next());
+        file.open(QIODevice::ReadOnly);
+        files.insert(directory.relativeFilePath(file.fileName()),
+                     file.readAll());
+    }
+    return files;
+}
+
+void JlCompressTest::removeDirectory(QString directoryName)
+{
+    QDir directory(directoryName);
+    foreach (QFileInfo fileInfo,
+             directory.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot)) {
+        if (fileInfo.isDir()) {
+            removeDirectory(fileInfo.absoluteFilePath());
+        } else {
+            QFile::remove(fileInfo.absoluteFilePath());
+        }
+    }
+    QDir().rmdir(directoryName);
+}
+
+QByteArray JlCompressTest::randomData(int size)
+{
+    // Short runs of few different bytes compress like text:
+    QByteArray data(size, char(0));
+    for (int position = 0; position < size; position++) {
+        data[position] = char('a' + qrand() % 8);
+    }
+    return data;
+}
+
+void JlCompressTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-jlcompress-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    qsrand(2015);
+    for (int index = 0; index < 200; index++) {
+        archiveEntries.append(qMakePair(
+                                  QString("folder%1/file%2.txt")
+                                  .arg(index % 10).arg(index),
+                                  randomData(qrand() % 65536)));
+    }
+    archiveEntries.append(qMakePair(QString("large.bin"),
+                                    randomData(8 * 1048576)));
+    archiveEntries.append(qMakePair(QString("empty.txt"), QByteArray()));
+
+    archiveName = testDirectoryName + "/archive.zip";
+    QVERIFY(writeArchive(archiveName, archiveEntries));
+}
+
+void JlCompressTest::cleanupTestCase()
+{
+    removeDirectory(testDirectoryName);
+}
+
+void JlCompressTest::sameFilesAsSequentialExtraction()
+{
+    QString sequentialDirectory = testDirectoryName + "/sequential";
+    QString parallelDirectory = testDirectoryName + "/parallel";
+
+    QCOMPARE(JlCompress::extractDir(archiveName, sequentialDirectory).size(),
+             archiveEntries.size());
+    QStringList extracted =
+            JlCompress::extractDirParallel(archiveName, parallelDirectory, 4);
+    QCOMPARE(extracted.size(), archiveEntries.size());
+    QCOMPARE(extracted.first(),
+             QDir(parallelDirectory).absoluteFilePath(archiveEntries.first().first));
+
+    QHash<QString, QByteArray> sequentialFiles = readFiles(sequentialDirectory);
+    QHash<QString, QByteArray> parallelFiles = readFiles(parallelDirectory);
+    QCOMPARE(parallelFiles.size(), archiveEntries.size());
+    QVERIFY(parallelFiles == sequentialFiles);
+
+    // Some entries only, from several threads:
+    QString someDirectory = testDirectoryName + "/some";
+    QStringList someNames;
+    someNames << archiveEntries.at(3).first << archiveEntries.at(150).first
+              << "large.bin";
+    QCOMPARE(JlCompress::extractFilesParallel(archiveName, someNames,
+                                              someDirectory).size(), 3);
+    QCOMPARE(readFiles(someDirectory).value("large.bin"),
+             sequentialFiles.value("large.bin"));
+}
+
+void JlCompressTest::lastDuplicateEntryWins()
+{
+    QList<QPair<QString, QByteArray> > duplicateEntries;
+    duplicateEntries.append(qMakePair(QString("duplicate.txt"),
+                                      randomData(1048576)));
+    duplicateEntries.append(qMakePair(QString("other.txt"),
+                                      QByteArray("other")));
+    duplicateEntries.append(qMakePair(QString("duplicate.txt"),
+                                      QByteArray("last")));
+
+    QString duplicateArchiveName = testDirectoryName + "/duplicate.zip";
+    QVERIFY(writeArchive(duplicateArchiveName, duplicateEntries));
+
+    for (int run = 0; run < 20; run++) {
+        QString directoryName = testDirectoryName + "/duplicate"
+                + QString::number(run);
+        QStringList extracted = JlCompress::extractDirParallel(
+                    duplicateArchiveName, directoryName, 2);
+        QCOMPARE(extracted.size(), 2);
+
+        QHash<QString, QByteArray> files = readFiles(directoryName);
+        QCOMPARE(files.value("duplicate.txt"), QByteArray("last"));
+        QCOMPARE(files.value("other.txt"), QByteArray("other"));
+    }
+
+    QString directoryName = testDirectoryName + "/duplicate-files";
+    QCOMPARE(JlCompress::extractFilesParallel(duplicateArchiveName,
+                                              QStringList() << "duplicate.txt",
+                                              directoryName).size(), 1);
+    QCOMPARE(readFiles(directoryName).value("duplicate.txt"),
+             QByteArray("last"));
+}
+
+void JlCompressTest::missingEntryFails()
+{
+    QString directoryName = testDirectoryName + "/missing";
+    QStringList extracted = JlCompress::extractFilesParallel(
+                archiveName, QStringList() << "large.bin" << "missing.txt",
+                directoryName);
+    QVERIFY(extracted.isEmpty());
+    QVERIFY(!QFile::exists(directoryName + "/large.bin"));
+}
+
+void JlCompressTest::extractionBenchmark_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    // Zero threads stand for the sequential extraction:
+    QTest::newRow("sequential") << 0;
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("2 threads") << 2;
+    QTest::newRow("ideal thread count") << QThread::idealThreadCount();
+}
+
+void JlCompressTest::extractionBenchmark()
+{
+    QFETCH(int, threadCount);
+
+    QString directoryName = testDirectoryName + "/benchmark";
+    QBENCHMARK {
+        QStringList extracted = (threadCount == 0) ?
+                    JlCompress::extractDir(archiveName, directoryName) :
+                    JlCompress::extractDirParallel(archiveName, directoryName,
+                                                   threadCount);
+        QCOMPARE(extracted.size(), archiveEntries.size());
+    }
+}
+
+QTEST_MAIN(JlCompressTest)
+#include "tst_jlcompress.moc"
@@ -0,0 +1,9 @@
+# Script output buffer: theme link insertion, byte-exact reading and
+# an append-and-read benchmark, which has to stay linear in the output size.
+
+TEMPLATE = app
+TARGET = tst_outputbuffer
+
+include (../browser.pri)
+
+SOURCES += tst_outputbuffer.cpp
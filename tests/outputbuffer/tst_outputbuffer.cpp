@@ -0,0 +1,149 @@
+// Output beyond the memory limit of the spool (16 MB by default) is
+// spilled to a file in the temporary folder, so the benchmark rows
+// cover memory segments and the spool file alike.
+
+#include <QtTest>
+#include "peb.h"
+
+class OutputBufferTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void themeLinkInsertedAfterTitle();
+    void headWithoutTitleReleasedAtBody();
+    void flushReleasesHeldHead();
+    void readsExactBytesInSmallPieces();
+    void appendAndReadBenchmark_data();
+    void appendAndReadBenchmark();
+
+private:
+    static QByteArray readAll(ScriptOutputBuffer &buffer, int pieceSize);
+
+    QString testDirectoryName;
+};
+
+QByteArray OutputBufferTest::readAll(ScriptOutputBuffer &buffer, int pieceSize)
+{
+    QByteArray data;
+    QByteArray piece(pieceSize, char(0));
+    qint64 bytesRead;
+    while ((bytesRead = buffer.read(piece.data(), pieceSize)) > 0) {
+        data.append(piece.constData(), (int) bytesRead);
+    }
+    return data;
+}
+
+void OutputBufferTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-outputbuffer-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+    qApp->setProperty("applicationTempDirectory", testDirectoryName);
+}
+
+void OutputBufferTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void OutputBufferTest::themeLinkInsertedAfterTitle()
+{
+    QByteArray link("<link rel='stylesheet' href='current.css'>");
+
+    ScriptOutputBuffer buffer;
+    buffer.setThemeLink(link);
+    buffer.append("<html><head><ti");
+    QCOMPARE(buffer.size(), (qint64) 0);
+    buffer.append("tle>Title</title></head>");
+    buffer.append("<body>text</body></html>");
+
+    QCOMPARE(readAll(buffer, 5),
+             QByteArray("<html><head><title>Title</title>\n") + link
+             + "</head><body>text</body></html>");
+    QCOMPARE(buffer.totalBytes, (qint64) 63);
+}
+
+void OutputBufferTest::headWithoutTitleReleasedAtBody()
+{
+    ScriptOutputBuffer buffer;
+    buffer.setThemeLink("<link rel='stylesheet' href='current.css'>");
+    buffer.append("<html><body>text");
+
+    QCOMPARE(readAll(buffer, 64), QByteArray("<html><body>text"));
+}
+
+void OutputBufferTest::flushReleasesHeldHead()
+{
+    ScriptOutputBuffer buffer;
+    buffer.setThemeLink("<link rel='stylesheet' href='current.css'>");
+    buffer.append("<html><head>");
+    QCOMPARE(buffer.size(), (qint64) 0);
+
+    buffer.flush();
+    QCOMPARE(readAll(buffer, 64), QByteArray("<html><head>"));
+}
+
+void OutputBufferTest::readsExactBytesInSmallPieces()
+{
+    ScriptOutputBuffer buffer;
+    QByteArray expected;
+
+    qsrand(2015);
+    for (int index = 0; index < 1000; index++) {
+        QByteArray chunk(qrand() % 4096 + 1, char(0));
+        for (int position = 0; position < chunk.size(); position++) {
+            chunk[position] = char(qrand() % 256);
+        }
+        buffer.append(chunk);
+        expected.append(chunk);
+    }
+
+    QCOMPARE(buffer.size(), (qint64) expected.size());
+    QCOMPARE(readAll(buffer, 7), expected);
+    QCOMPARE(buffer.size(), (qint64) 0);
+}
+
+void OutputBufferTest::appendAndReadBenchmark_data()
+{
+    QTest::addColumn<int>("megabytes");
+
+    // Time per megabyte has to stay the same for all rows:
+    QTest::newRow("8 MB") << 8;
+    QTest::newRow("32 MB") << 32;
+    QTest::newRow("128 MB") << 128;
+}
+
+void OutputBufferTest::appendAndReadBenchmark()
+{
+    QFETCH(int, megabytes);
+
+    QByteArray chunk(65536, 'x');
+    QByteArray piece(16384, char(0));
+    int chunks = megabytes * 16;
+
+    // All output is appended before it is read, like the output of
+    // a script writing faster than WebKit reads:
+    QBENCHMARK {
+        ScriptOutputBuffer buffer;
+        for (int index = 0; index < chunks; index++) {
+            buffer.append(chunk);
+        }
+
+        qint64 bytesRead = 0;
+        qint64 pieceBytes;
+        while ((pieceBytes = buffer.read(piece.data(), piece.size())) > 0) {
+            bytesRead += pieceBytes;
+        }
+        QCOMPARE(bytesRead, (qint64) chunks * chunk.size());
+    }
+}
+
+QTEST_MAIN(OutputBufferTest)
+#include "tst_outputbuffer.moc"
@@ -0,0 +1,15 @@
+# Embedded Perl interface without Qt: private %ENV, unchanged $0,
+# exit handling and clones running on several threads at once.
+# The same script is timed embedded and in a new perl process.
+
+TEMPLATE = app
+TARGET = tst_perlembed
+CONFIG += console testcase
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += $$PWD/../../src
+HEADERS += $$PWD/../../src/perlembed.h
+SOURCES += $$PWD/../../src/perlembed.cpp tst_perlembed.cpp
+
+QMAKE_CXXFLAGS += $$system(perl -MExtUtils::Embed -e ccopts)
+LIBS += $$system(perl -MExtUtils::Embed -e ldopts)
@@ -0,0 +1,254 @@
+// Scripts are written to the temporary folder and run in clones of
+// one parent interpreter, like EmbeddedPerl does in the browser.
+// The same script is timed in a clone and in a new perl process,
+// which is started with fork() and exec() like QProcess does.
+// The program returns a non-zero exit status if any check fails.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "perlembed.h"
+
+#define BENCHMARK_RUNS 50
+
+extern char **environ;
+
+static int failures = 0;
+
+static void check(bool condition, const char *description)
+{
+    std::printf("%s: %s\n", (condition ? "PASS" : "FAIL"), description);
+    if (!condition) {
+        failures++;
+    }
+}
+
+static std::string writeScript(const char *name, const char *contents)
+{
+    std::ostringstream fileName;
+    fileName << "/tmp/peb-perlembed-test-" << getpid() << "-" << name;
+    std::ofstream scriptFile(fileName.str().c_str());
+    scriptFile << contents;
+    return fileName.str();
+}
+
+static std::string processTitle()
+{
+    std::ifstream commandLine("/proc/self/cmdline");
+    std::ostringstream title;
+    title << commandLine.rdbuf();
+    return title.str();
+}
+
+// Cloning has to be serialized by the caller:
+static pthread_mutex_t cloneMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int run(const std::string &script,
+               const std::vector<std::string> &environment,
+               const std::string &stdinData,
+               std::string &stdoutData,
+               std::string &stderrData)
+{
+    pthread_mutex_lock(&cloneMutex);
+    void *interpreter = PerlEmbed::cloneInterpreter();
+    pthread_mutex_unlock(&cloneMutex);
+
+    int status = PerlEmbed::runScript(interpreter, script, environment,
+                                      stdinData, stdoutData, stderrData);
+
+    pthread_mutex_lock(&cloneMutex);
+    PerlEmbed::destroyInterpreter(interpreter);
+    pthread_mutex_unlock(&cloneMutex);
+
+    return status;
+}
+
+static double seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// New processes get the prohibited core functions masked too:
+static std::string runProcess(const std::string &script)
+{
+    int outputPipe[2];
+    if (pipe(outputPipe) != 0) {
+        return "";
+    }
+
+    posix_spawn_file_actions_t fileActions;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawn_file_actions_adddup2(&fileActions, outputPipe[1],
+                                     STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&fileActions, outputPipe[0]);
+    posix_spawn_file_actions_addclose(&fileActions, outputPipe[1]);
+
+    char perl[] = "perl";
+    char ops[] = "-M-ops=fork,unlink";
+    char *arguments[] = {perl, ops, const_cast<char *>(script.c_str()), 0};
+
+    pid_t pid;
+    int spawned = posix_spawnp(&pid, "perl", &fileActions, 0,
+                               arguments, environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    close(outputPipe[1]);
+
+    std::string stdoutData;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(outputPipe[0], buffer, sizeof(buffer))) > 0) {
+        stdoutData.append(buffer, length);
+    }
+    close(outputPipe[0]);
+
+    if (spawned == 0) {
+        waitpid(pid, 0, 0);
+    }
+    return stdoutData;
+}
+
+// A small page of the kind local scripts return:
+static void benchmark()
+{
+    std::string benchmarkScript = writeScript(
+                "benchmark.pl",
+                "use strict;\n"
+                "use warnings;\n"
+                "use Cwd;\n"
+                "my %counts;\n"
+                "$counts{$_ % 7}++ for 1 .. 1000;\n"
+                "print \"Content-Type: text/html\\r\\n\\r\\n\";\n"
+                "print \"<li>$_: $counts{$_}</li>\\n\" foreach sort keys %counts;\n");
+
+    std::string embeddedOutput;
+    std::string processOutput;
+    std::string stderrData;
+
+    double start = seconds();
+    for (int index = 0; index < BENCHMARK_RUNS; index++) {
+        run(benchmarkScript, std::vector<std::string>(), "",
+            embeddedOutput, stderrData);
+    }
+    double embeddedTime = (seconds() - start) / BENCHMARK_RUNS;
+
+    start = seconds();
+    for (int index = 0; index < BENCHMARK_RUNS; index++) {
+        processOutput = runProcess(benchmarkScript);
+    }
+    double processTime = (seconds() - start) / BENCHMARK_RUNS;
+
+    check(embeddedOutput.size() > 0 and embeddedOutput == processOutput,
+          "embedded and new process output of the benchmark are the same");
+    std::printf("Embedded perl: %.2f ms per script, "
+                "new process: %.2f ms per script\n",
+                embeddedTime * 1000, processTime * 1000);
+
+    std::remove(benchmarkScript.c_str());
+}
+
+struct ThreadRun {
+    std::string script;
+    std::string value;
+    std::string stdoutData;
+};
+
+static void *runOnThread(void *argument)
+{
+    ThreadRun *threadRun = static_cast<ThreadRun *>(argument);
+    std::vector<std::string> environment;
+    environment.push_back("PEB_THREAD_VALUE=" + threadRun->value);
+    std::string stderrData;
+    run(threadRun->script, environment, "", threadRun->stdoutData, stderrData);
+    return 0;
+}
+
+int main()
+{
+    check(PerlEmbed::initialize(std::vector<std::string>(),
+                                std::vector<std::string>(), "fork,unlink"),
+          "parent interpreter is created");
+
+    std::string titleBefore = processTitle();
+
+    std::string environmentScript = writeScript(
+                "environment.pl",
+                "$ENV{PEB_EMBED_CHANGED} = 'changed';\n"
+                "delete $ENV{PATH};\n"
+                "my $input = <STDIN>;\n"
+                "print \"value=$ENV{PEB_EMBED_VALUE} input=$input\";\n"
+                "print STDERR \"to stderr\";\n"
+                "exit 3;\n");
+
+    std::vector<std::string> environment;
+    environment.push_back("PEB_EMBED_VALUE=first");
+    std::string stdoutData;
+    std::string stderrData;
+    int status = run(environmentScript, environment, "line",
+                     stdoutData, stderrData);
+
+    check(status == 3, "exit ends only the script and returns its status");
+    check(stdoutData == "value=first input=line", "STDIN and STDOUT are buffers");
+    check(stderrData == "to stderr", "STDERR is a buffer");
+    check(std::getenv("PEB_EMBED_CHANGED") == 0,
+          "process environment is not changed by %ENV assignments");
+    check(std::getenv("PATH") != 0,
+          "process environment is not changed by %ENV deletions");
+    check(processTitle() == titleBefore, "process title is not changed");
+
+    std::string forkScript = writeScript("fork.pl", "fork();\n");
+    status = run(forkScript, std::vector<std::string>(), "",
+                 stdoutData, stderrData);
+    check(status == 255 and
+          stderrData.find("trapped by operation mask") != std::string::npos,
+          "prohibited core functions are masked");
+
+    // Every thread has to see only its own environment:
+    std::string threadScript = writeScript(
+                "thread.pl",
+                "my $mismatches = 0;\n"
+                "my $value = $ENV{PEB_THREAD_VALUE};\n"
+                "for (1 .. 20000) {\n"
+                "    $ENV{PEB_THREAD_VALUE} = $value;\n"
+                "    $mismatches++ if $ENV{PEB_THREAD_VALUE} ne $value;\n"
+                "}\n"
+                "print \"$value:$mismatches\";\n");
+
+    const int threadCount = 8;
+    pthread_t threads[threadCount];
+    ThreadRun threadRuns[threadCount];
+    for (int index = 0; index < threadCount; index++) {
+        std::ostringstream value;
+        value << "thread" << index;
+        threadRuns[index].script = threadScript;
+        threadRuns[index].value = value.str();
+        pthread_create(&threads[index], 0, runOnThread, &threadRuns[index]);
+    }
+    bool threadsIsolated = true;
+    for (int index = 0; index < threadCount; index++) {
+        pthread_join(threads[index], 0);
+        if (threadRuns[index].stdoutData != threadRuns[index].value + ":0") {
+            threadsIsolated = false;
+        }
+    }
+    check(threadsIsolated, "concurrent scripts have separate environments");
+    check(std::getenv("PEB_THREAD_VALUE") == 0,
+          "concurrent scripts leave the process environment unchanged");
+
+    benchmark();
+
+    std::remove(environmentScript.c_str());
+    std::remove(forkScript.c_str());
+    std::remove(threadScript.c_str());
+
+    std::printf("%d failures\n", failures);
+    return (failures == 0 ? 0 : 1);
+}
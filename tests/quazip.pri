@@ -0,0 +1,32 @@
+# Settings shared by the tests of QuaZip and zlib.
+# QuaZip and zlib are compiled from the browser sources,
+# the browser classes are not needed.
+
+QT -= gui
+QT += testlib
+CONFIG += console testcase warn_off
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../src $$PWD/../src/zlib
+DEPENDPATH += $$PWD/../src
+
+DEFINES += "QUAZIP_STATIC=1"
+
+SOURCES += $$PWD/../src/zlib/adler32.c $$PWD/../src/zlib/crc32.c \
+    $$PWD/../src/zlib/gzclose.c $$PWD/../src/zlib/gzread.c \
+    $$PWD/../src/zlib/infback.c $$PWD/../src/zlib/inflate.c \
+    $$PWD/../src/zlib/trees.c $$PWD/../src/zlib/zutil.c \
+    $$PWD/../src/zlib/compress.c $$PWD/../src/zlib/deflate.c \
+    $$PWD/../src/zlib/gzlib.c $$PWD/../src/zlib/gzwrite.c \
+    $$PWD/../src/zlib/inffast.c $$PWD/../src/zlib/inftrees.c \
+    $$PWD/../src/zlib/uncompr.c
+HEADERS += $$PWD/../src/quazip/JlCompress.h $$PWD/../src/quazip/quazip.h \
+    $$PWD/../src/quazip/quazipdir.h $$PWD/../src/quazip/quazipfile.h \
+    $$PWD/../src/quazip/quaziodevice.h $$PWD/../src/quazip/quagzipfile.h
+SOURCES += $$PWD/../src/quazip/unzip.c $$PWD/../src/quazip/zip.c \
+    $$PWD/../src/quazip/JlCompress.cpp $$PWD/../src/quazip/qioapi.cpp \
+    $$PWD/../src/quazip/quaadler32.cpp $$PWD/../src/quazip/quacrc32.cpp \
+    $$PWD/../src/quazip/quagzipfile.cpp $$PWD/../src/quazip/quaziodevice.cpp \
+    $$PWD/../src/quazip/quazip.cpp $$PWD/../src/quazip/quazipdir.cpp \
+    $$PWD/../src/quazip/quazipfile.cpp $$PWD/../src/quazip/quazipfileinfo.cpp \
+    $$PWD/../src/quazip/quazipnewinfo.cpp
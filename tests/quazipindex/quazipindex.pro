@@ -0,0 +1,8 @@
+# File name index of QuaZip: same results as the central directory walk.
+
+TEMPLATE = app
+TARGET = tst_quazipindex
+
+include (../quazip.pri)
+
+SOURCES += tst_quazipindex.cpp
@@ -0,0 +1,198 @@
+// Every check opens the same archive with and without the file name index
+// and compares the results. Entries are written in no sorted order,
+// with folders listed both before and after their files.
+
+#include <QtTest>
+#include "quazip/quazip.h"
+#include "quazip/quazipfile.h"
+#include "quazip/quazipdir.h"
+
+class QuaZipIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void namesInCentralDirectoryOrder_data();
+    void namesInCentralDirectoryOrder();
+    void directoryListings_data();
+    void directoryListings();
+    void lookups();
+    void lookupBenchmark_data();
+    void lookupBenchmark();
+
+private:
+    static bool writeArchive(QString archiveName, QStringList names);
+
+    QString testDirectoryName;
+    QString archiveName;
+    QString largeArchiveName;
+    QStringList largeArchiveNames;
+};
+
+bool QuaZipIndexTest::writeArchive(QString archiveName, QStringList names)
+{
+    QuaZip zip(archiveName);
+    if (!zip.open(QuaZip::mdCreate)) {
+        return false;
+    }
+
+    foreach (QString name, names) {
+        QuaZipFile file(&zip);
+        if (!file.open(QIODevice::WriteOnly, QuaZipNewInfo(name))) {
+            return false;
+        }
+        if (!name.endsWith('/')) {
+            file.write(name.toUtf8());
+        }
+        file.close();
+    }
+
+    zip.close();
+    return (zip.getZipError() == UNZ_OK);
+}
+
+void QuaZipIndexTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-quazipindex-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    archiveName = testDirectoryName + "/archive.zip";
+    QVERIFY(writeArchive(archiveName, QStringList()
+                         << "b.txt" << "sub/z.txt" << "sub/" << "a.txt"
+                         << "sub/deep/y.txt" << "sub/a.txt" << "virtual/x.txt"
+                         << "Upper.TXT" << "sub/deep/" << "b.txt"));
+
+    qsrand(2015);
+    for (int index = 0; index < 20000; index++) {
+        largeArchiveNames.append(QString("folder%1/file%2.txt")
+                                 .arg(qrand() % 100).arg(index));
+    }
+    largeArchiveName = testDirectoryName + "/large.zip";
+    QVERIFY(writeArchive(largeArchiveName, largeArchiveNames));
+}
+
+void QuaZipIndexTest::cleanupTestCase()
+{
+    QFile::remove(archiveName);
+    QFile::remove(largeArchiveName);
+    QDir().rmdir(testDirectoryName);
+}
+
+void QuaZipIndexTest::namesInCentralDirectoryOrder_data()
+{
+    QTest::addColumn<QString>("prefix");
+
+    QTest::newRow("all") << "";
+    QTest::newRow("folder") << "sub/";
+    QTest::newRow("subfolder") << "sub/deep/";
+    QTest::newRow("file name") << "b";
+    QTest::newRow("missing") << "missing/";
+}
+
+void QuaZipIndexTest::namesInCentralDirectoryOrder()
+{
+    QFETCH(QString, prefix);
+
+    QuaZip indexedZip(archiveName);
+    indexedZip.setFileNameIndexingEnabled(true);
+    QVERIFY(indexedZip.open(QuaZip::mdUnzip));
+    QVERIFY(indexedZip.hasFileNameIndex());
+
+    QStringList expectedNames;
+    foreach (QString name, indexedZip.getFileNameList()) {
+        if (name.startsWith(prefix)) {
+            expectedNames.append(name);
+        }
+    }
+    QCOMPARE(indexedZip.getIndexedFileNameList(prefix), expectedNames);
+}
+
+void QuaZipIndexTest::directoryListings_data()
+{
+    QTest::addColumn<QString>("directoryName");
+
+    QTest::newRow("root") << "";
+    QTest::newRow("folder") << "sub";
+    QTest::newRow("subfolder") << "sub/deep";
+    QTest::newRow("virtual folder") << "virtual";
+}
+
+void QuaZipIndexTest::directoryListings()
+{
+    QFETCH(QString, directoryName);
+
+    QuaZip zip(archiveName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QuaZip indexedZip(archiveName);
+    indexedZip.setFileNameIndexingEnabled(true);
+    QVERIFY(indexedZip.open(QuaZip::mdUnzip));
+
+    QuaZipDir directory(&zip, directoryName);
+    QuaZipDir indexedDirectory(&indexedZip, directoryName);
+
+    QCOMPARE(indexedDirectory.entryList(QDir::NoFilter, QDir::Unsorted),
+             directory.entryList(QDir::NoFilter, QDir::Unsorted));
+    QCOMPARE(indexedDirectory.entryList(QDir::Files, QDir::Name),
+             directory.entryList(QDir::Files, QDir::Name));
+
+    // Folders with their own entry have its time, the others have none:
+    QList<QuaZipFileInfo64> infos =
+            directory.entryInfoList64(QDir::Dirs, QDir::Unsorted);
+    QList<QuaZipFileInfo64> indexedInfos =
+            indexedDirectory.entryInfoList64(QDir::Dirs, QDir::Unsorted);
+    QCOMPARE(indexedInfos.size(), infos.size());
+    for (int index = 0; index < infos.size(); index++) {
+        QCOMPARE(indexedInfos.at(index).name, infos.at(index).name);
+        QCOMPARE(indexedInfos.at(index).dateTime, infos.at(index).dateTime);
+    }
+}
+
+void QuaZipIndexTest::lookups()
+{
+    QuaZip indexedZip(archiveName);
+    indexedZip.setFileNameIndexingEnabled(true);
+    QVERIFY(indexedZip.open(QuaZip::mdUnzip));
+
+    // The first entry is at position 0 of the central directory:
+    QVERIFY(indexedZip.setCurrentFile("b.txt"));
+    QCOMPARE(indexedZip.getCurrentFileName(), QString("b.txt"));
+    QVERIFY(indexedZip.setCurrentFile("sub/deep/y.txt"));
+    QVERIFY(indexedZip.setCurrentFile("upper.txt", QuaZip::csInsensitive));
+    QCOMPARE(indexedZip.getCurrentFileName(), QString("Upper.TXT"));
+    QVERIFY(!indexedZip.setCurrentFile("upper.txt", QuaZip::csSensitive));
+    QVERIFY(!indexedZip.setCurrentFile("missing.txt"));
+}
+
+void QuaZipIndexTest::lookupBenchmark_data()
+{
+    QTest::addColumn<bool>("indexed");
+
+    QTest::newRow("without index") << false;
+    QTest::newRow("with index") << true;
+}
+
+void QuaZipIndexTest::lookupBenchmark()
+{
+    QFETCH(bool, indexed);
+
+    // Names are looked up from the end of the central directory,
+    // the worst case of the walk:
+    QBENCHMARK {
+        QuaZip zip(largeArchiveName);
+        zip.setFileNameIndexingEnabled(indexed);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        for (int index = largeArchiveNames.size() - 1; index >= 0;
+             index -= 10) {
+            QVERIFY(zip.setCurrentFile(largeArchiveNames.at(index)));
+        }
+        QVERIFY(!zip.setCurrentFile("missing.txt"));
+        QuaZipDir directory(&zip, "folder42");
+        QVERIFY(directory.entryList().size() > 0);
+    }
+}
+
+QTEST_MAIN(QuaZipIndexTest)
+#include "tst_quazipindex.moc"
@@ -0,0 +1,8 @@
+# Script response cache: budget checks and persistence.
+
+TEMPLATE = app
+TARGET = tst_responsecache
+
+include (../browser.pri)
+
+SOURCES += tst_responsecache.cpp
@@ -0,0 +1,134 @@
+// The cache is created with a budget of 1 MB and persistence enabled,
+// so every accepted entry is also saved in the 'response-cache' folder.
+
+#include <QtTest>
+#include "peb.h"
+
+class ResponseCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void storesAndPersistsFittingResponse();
+    void oversizedResponseIsNotPersisted();
+    void oversizedResponseReplacesOlderOne();
+
+private:
+    QString writeScript(QString fileName);
+    static void parseHeaders(CgiResponseParser &parser);
+    int cacheFileCount();
+
+    QString testDirectoryName;
+};
+
+QString ResponseCacheTest::writeScript(QString fileName)
+{
+    QString scriptFileName = testDirectoryName + "/" + fileName;
+    QFile scriptFile(scriptFileName);
+    scriptFile.open(QIODevice::WriteOnly);
+    scriptFile.write("print \"Content-Type: text/plain\\n\\n\";\n");
+    scriptFile.close();
+    return scriptFileName;
+}
+
+void ResponseCacheTest::parseHeaders(CgiResponseParser &parser)
+{
+    parser.parse("Status: 200 OK\r\n"
+                 "Content-Type: text/plain\r\n"
+                 "Cache-Control: max-age=60\r\n"
+                 "\r\n");
+}
+
+int ResponseCacheTest::cacheFileCount()
+{
+    return QDir(testDirectoryName + "/response-cache")
+            .entryList(QStringList() << "*.cache", QDir::Files).size();
+}
+
+void ResponseCacheTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-responsecache-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    qApp->setProperty("applicationTempDirectory", testDirectoryName);
+    qApp->setProperty("responseCache", "enable");
+    qApp->setProperty("responseCachePersistence", "enable");
+    qApp->setProperty("responseCacheSize", 1);
+}
+
+void ResponseCacheTest::cleanupTestCase()
+{
+    QDir cacheDirectory(testDirectoryName + "/response-cache");
+    foreach (QString fileName, cacheDirectory.entryList(QDir::Files)) {
+        cacheDirectory.remove(fileName);
+    }
+    QDir().rmdir(cacheDirectory.path());
+
+    QDir testDirectory(testDirectoryName);
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void ResponseCacheTest::storesAndPersistsFittingResponse()
+{
+    ScriptResponseCache cache;
+    QString scriptFileName = writeScript("fitting.pl");
+    QString key = ScriptResponseCache::cacheKey(scriptFileName, "a=1");
+
+    CgiResponseParser parser;
+    parseHeaders(parser);
+    int filesBefore = cacheFileCount();
+    cache.store(scriptFileName, key, &parser, QByteArray(1000, 'x'));
+
+    ScriptResponseCache::CachedResponse response;
+    QCOMPARE(cache.lookup(key, response), ScriptResponseCache::Fresh);
+    QCOMPARE(response.body, QByteArray(1000, 'x'));
+    QCOMPARE(cacheFileCount(), filesBefore + 1);
+}
+
+void ResponseCacheTest::oversizedResponseIsNotPersisted()
+{
+    ScriptResponseCache cache;
+    QString scriptFileName = writeScript("oversized.pl");
+    QString key = ScriptResponseCache::cacheKey(scriptFileName, "a=1");
+
+    CgiResponseParser parser;
+    parseHeaders(parser);
+    int filesBefore = cacheFileCount();
+    cache.store(scriptFileName, key, &parser,
+                QByteArray(cache.maximumEntrySize() + 1, 'x'));
+
+    ScriptResponseCache::CachedResponse response;
+    QCOMPARE(cache.lookup(key, response), ScriptResponseCache::Missing);
+    QCOMPARE(cacheFileCount(), filesBefore);
+}
+
+void ResponseCacheTest::oversizedResponseReplacesOlderOne()
+{
+    ScriptResponseCache cache;
+    QString scriptFileName = writeScript("replaced.pl");
+    QString key = ScriptResponseCache::cacheKey(scriptFileName, "a=1");
+
+    CgiResponseParser smallParser;
+    parseHeaders(smallParser);
+    cache.store(scriptFileName, key, &smallParser, QByteArray("small"));
+
+    int filesBefore = cacheFileCount();
+    CgiResponseParser largeParser;
+    parseHeaders(largeParser);
+    cache.store(scriptFileName, key, &largeParser,
+                QByteArray(cache.maximumEntrySize() + 1, 'x'));
+
+    // Neither the memory nor the saved copy of the older response is left:
+    ScriptResponseCache::CachedResponse response;
+    QCOMPARE(cache.lookup(key, response), ScriptResponseCache::Missing);
+    QCOMPARE(cacheFileCount(), filesBefore - 1);
+}
+
+QTEST_MAIN(ResponseCacheTest)
+#include "tst_responsecache.moc"
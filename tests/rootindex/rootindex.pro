@@ -0,0 +1,8 @@
+# Root index: changes made during and after the scan at startup.
+
+TEMPLATE = app
+TARGET = tst_rootindex
+
+include (../browser.pri)
+
+SOURCES += tst_rootindex.cpp
@@ -0,0 +1,165 @@
+// The root index is built from a temporary root folder.
+// Files are created right after the scan is started, so they may be
+// created while the scan is running - they must be found either way.
+// Files without an extension are typed by their shebang line,
+// which is read again when the file is changed.
+
+#include <QtTest>
+#include "peb.h"
+
+class RootIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void findsFilesCreatedDuringScan();
+    void findsNewAndRemovedFiles();
+    void detectsChangedShebang();
+    void scansNewFolders();
+
+private:
+    QString writeFile(QString fileName, QByteArray contents);
+    static bool waitForType(QString filePath, QString fileType);
+
+    QString testDirectoryName;
+};
+
+QString RootIndexTest::writeFile(QString fileName, QByteArray contents)
+{
+    QString filePath = testDirectoryName + "/" + fileName;
+    QFile file(filePath);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(contents);
+    file.close();
+    return filePath;
+}
+
+bool RootIndexTest::waitForType(QString filePath, QString fileType)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (RootIndex::instance()->fileType(filePath) != fileType and
+           timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    return (RootIndex::instance()->fileType(filePath) == fileType);
+}
+
+void RootIndexTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-rootindex-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName + "/folder"));
+    writeFile("folder/index.html", "<html></html>");
+
+    qApp->setProperty("rootDirName", testDirectoryName);
+    qApp->setProperty("perlInterpreter", "perl");
+
+    RootIndex::instance()->startScan();
+    writeFile("during_scan.pl", "print 1;\n");
+    writeFile("folder/during_scan", "#!/usr/bin/perl\nprint 1;\n");
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!RootIndex::instance()->isReady() and timer.elapsed() < 10000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(RootIndex::instance()->isReady());
+}
+
+void RootIndexTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    foreach (QString folderName, QStringList() << "folder" << "new_folder") {
+        QDir folder(testDirectoryName + "/" + folderName);
+        foreach (QString fileName, folder.entryList(QDir::Files)) {
+            folder.remove(fileName);
+        }
+        testDirectory.rmdir(folderName);
+    }
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void RootIndexTest::findsFilesCreatedDuringScan()
+{
+    RootIndex *rootIndex = RootIndex::instance();
+
+    QVERIFY(rootIndex->exists(testDirectoryName + "/folder/index.html"));
+    QCOMPARE(rootIndex->fileType(testDirectoryName + "/folder/index.html"),
+             QString("browser-html"));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!rootIndex->exists(testDirectoryName + "/during_scan.pl") and
+           timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(rootIndex->exists(testDirectoryName + "/during_scan.pl"));
+    QVERIFY(waitForType(testDirectoryName + "/folder/during_scan", "perl"));
+}
+
+void RootIndexTest::findsNewAndRemovedFiles()
+{
+    RootIndex *rootIndex = RootIndex::instance();
+    QString filePath = writeFile("new_file.css", "body {}\n");
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!rootIndex->exists(filePath) and timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(rootIndex->exists(filePath));
+
+    QVERIFY(QFile::remove(filePath));
+    timer.restart();
+    while (rootIndex->exists(filePath) and timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(!rootIndex->exists(filePath));
+}
+
+void RootIndexTest::detectsChangedShebang()
+{
+    QString filePath = writeFile("changing_script", "#!/bin/sh\necho 1\n");
+    QVERIFY(waitForType(filePath, "undefined"));
+
+    // The same file is rewritten in place, its folder is not changed:
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.write("#!/usr/bin/perl\n");
+    file.close();
+    QVERIFY(waitForType(filePath, "perl"));
+
+    // Editors often replace the file with a new copy:
+    QString newCopy = writeFile("changing_script.new", "#!/bin/sh\n");
+    QVERIFY(QFile::remove(filePath));
+    QVERIFY(QFile::rename(newCopy, filePath));
+    QVERIFY(waitForType(filePath, "undefined"));
+
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.write("#!/usr/bin/perl\n");
+    file.close();
+    QVERIFY(waitForType(filePath, "perl"));
+}
+
+void RootIndexTest::scansNewFolders()
+{
+    QVERIFY(QDir().mkpath(testDirectoryName + "/new_folder"));
+    QString filePath = writeFile("new_folder/script", "#!/bin/sh\n");
+    QVERIFY(waitForType(filePath, "undefined"));
+    QVERIFY(RootIndex::instance()->exists(filePath));
+
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.write("#!/usr/bin/perl\n");
+    file.close();
+    QVERIFY(waitForType(filePath, "perl"));
+}
+
+QTEST_MAIN(RootIndexTest)
+#include "tst_rootindex.moc"
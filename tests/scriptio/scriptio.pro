@@ -0,0 +1,8 @@
+# Event loop latency and backpressure while scripts flood their pipes.
+
+TEMPLATE = app
+TARGET = tst_scriptio
+
+include (../browser.pri)
+
+SOURCES += tst_scriptio.cpp
@@ -0,0 +1,201 @@
+// Scripts printing as fast as they can must not stall the GUI thread:
+// their pipes and sockets are read in the I/O thread and
+// the event loop of this thread only drains the ring buffers.
+// The lateness of a 50 msecs probe timer in the thread of the test,
+// where script jobs live, is measured while the script runs.
+// A job not drained by this thread must hold the script back
+// instead of reading all of its output into memory.
+
+#include <QtTest>
+#include "peb.h"
+
+class ScriptIoTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void floodKeepsEventLoopResponsive_data();
+    void floodKeepsEventLoopResponsive();
+    void undrainedJobBlocksScript_data();
+    void undrainedJobBlocksScript();
+
+public slots:
+    void outputSlot(QByteArray outputData);
+    void latencyProbeSlot();
+
+private:
+    QString testDirectoryName;
+    QString floodScriptFileName;
+    QString markerFileName;
+    qint64 receivedBytes;
+    QElapsedTimer latencyProbeTimer;
+    qint64 maximumEventLoopLatency;
+
+    static const int floodMegabytes = 64;
+    static const int maximumLatency = 250;
+    static const int latencyProbeInterval = 50;
+};
+
+void ScriptIoTest::outputSlot(QByteArray outputData)
+{
+    receivedBytes += outputData.size();
+}
+
+void ScriptIoTest::latencyProbeSlot()
+{
+    qint64 latency = latencyProbeTimer.restart() - latencyProbeInterval;
+    if (latency > maximumEventLoopLatency) {
+        maximumEventLoopLatency = latency;
+    }
+}
+
+void ScriptIoTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-scriptio-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    qApp->setProperty("applicationTempDirectory", testDirectoryName);
+    qApp->setProperty("perlInterpreter", "perl");
+    qApp->setProperty("perlLib", QString());
+    qApp->setProperty("zygotePreloadModules", QStringList());
+
+    // The marker file is written, when all output is written:
+    floodScriptFileName = testDirectoryName + "/flood.pl";
+    markerFileName = testDirectoryName + "/flood.done";
+    QFile floodScriptFile(floodScriptFileName);
+    QVERIFY(floodScriptFile.open(QIODevice::WriteOnly));
+    floodScriptFile.write(
+                "$| = 1;\n"
+                "my $line = ('x' x 1023) . \"\\n\";\n"
+                "print $line for 1 .. " + QByteArray::number(floodMegabytes)
+                + " * 1024;\n"
+                "open (my $marker, '>', '" + markerFileName.toUtf8()
+                + "') and close ($marker);\n");
+    floodScriptFile.close();
+
+    ZygoteServer::instance()->startSlot();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!ZygoteServer::instance()->isReady() and timer.elapsed() < 10000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(ZygoteServer::instance()->isReady());
+}
+
+void ScriptIoTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void ScriptIoTest::floodKeepsEventLoopResponsive_data()
+{
+    QTest::addColumn<bool>("forkServer");
+
+    QTest::newRow("new process") << false;
+    QTest::newRow("fork-server request") << true;
+}
+
+void ScriptIoTest::floodKeepsEventLoopResponsive()
+{
+    QFETCH(bool, forkServer);
+
+    receivedBytes = 0;
+    maximumEventLoopLatency = 0;
+
+    ScriptJob job(0, floodScriptFileName);
+    QObject::connect(&job, SIGNAL(outputSignal(QByteArray)),
+                     this, SLOT(outputSlot(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+
+    QTimer latencyProbe;
+    QObject::connect(&latencyProbe, SIGNAL(timeout()),
+                     this, SLOT(latencyProbeSlot()));
+    latencyProbeTimer.start();
+    latencyProbe.start(latencyProbeInterval);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (forkServer == true) {
+        job.attachRequest(ZygoteServer::instance()
+                          ->startRequest(&job, floodScriptFileName,
+                                         testDirectoryName,
+                                         QProcessEnvironment(), QByteArray()));
+    } else {
+        job.startProcess("perl", QStringList() << floodScriptFileName,
+                         QProcessEnvironment(), testDirectoryName,
+                         QByteArray());
+    }
+
+    while (finishedSpy.count() == 0 and timer.elapsed() < 60000) {
+        QTest::qWait(10);
+    }
+    latencyProbe.stop();
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(receivedBytes, (qint64) floodMegabytes * 1048576);
+
+    qDebug() << "Output:" << floodMegabytes * 1000
+                / qMax((qint64) 1, timer.elapsed()) << "MB/s,"
+             << "maximal event loop latency:"
+             << maximumEventLoopLatency << "msecs";
+
+    QVERIFY(maximumEventLoopLatency < maximumLatency);
+}
+
+void ScriptIoTest::undrainedJobBlocksScript_data()
+{
+    QTest::addColumn<bool>("forkServer");
+
+    QTest::newRow("new process") << false;
+    QTest::newRow("fork-server request") << true;
+}
+
+void ScriptIoTest::undrainedJobBlocksScript()
+{
+    QFETCH(bool, forkServer);
+
+    receivedBytes = 0;
+    QFile::remove(markerFileName);
+
+    ScriptJob job(0, floodScriptFileName);
+    QObject::connect(&job, SIGNAL(outputSignal(QByteArray)),
+                     this, SLOT(outputSlot(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+
+    if (forkServer == true) {
+        job.attachRequest(ZygoteServer::instance()
+                          ->startRequest(&job, floodScriptFileName,
+                                         testDirectoryName,
+                                         QProcessEnvironment(), QByteArray()));
+    } else {
+        job.startProcess("perl", QStringList() << floodScriptFileName,
+                         QProcessEnvironment(), testDirectoryName,
+                         QByteArray());
+    }
+
+    // The job is started by the I/O thread, but
+    // it is not drained while this thread sleeps.
+    // Unbounded reading would take all output in well under this time:
+    QTest::qSleep(3000);
+    QVERIFY(!QFile::exists(markerFileName));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (finishedSpy.count() == 0 and timer.elapsed() < 60000) {
+        QTest::qWait(10);
+    }
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(receivedBytes, (qint64) floodMegabytes * 1048576);
+    QVERIFY(QFile::exists(markerFileName));
+}
+
+QTEST_MAIN(ScriptIoTest)
+#include "tst_scriptio.moc"
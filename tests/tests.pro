@@ -0,0 +1,19 @@
+# Standalone tests and benchmarks of the browser, zlib and QuaZip code.
+# Build and run them from this folder with:
+# qmake tests.pro && make && make check
+
+TEMPLATE = subdirs
+
+SUBDIRS += censor
+SUBDIRS += fastcgi
+SUBDIRS += filedetector
+SUBDIRS += jlcompress
+SUBDIRS += outputbuffer
+SUBDIRS += perlembed
+SUBDIRS += quazipindex
+SUBDIRS += responsecache
+SUBDIRS += rootindex
+SUBDIRS += scriptio
+SUBDIRS += utf8decoder
+SUBDIRS += zygote
+SUBDIRS += zlibchecksum
@@ -0,0 +1,157 @@
+// Valid UTF-8 must be decoded exactly like QString::fromUtf8()
+// wherever the output is split in chunks.
+// The benchmark rows compare pure ASCII, where the ASCII runs are
+// converted without validation, and text with two-byte letters.
+
+#include <QtTest>
+#include "peb.h"
+
+class Utf8DecoderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void splitAtEveryPosition();
+    void randomChunks();
+    void invalidSequences_data();
+    void invalidSequences();
+    void incompleteSequenceAtEnd();
+    void decodingBenchmark_data();
+    void decodingBenchmark();
+
+private:
+    static QByteArray randomUtf8(int characters);
+};
+
+QByteArray Utf8DecoderTest::randomUtf8(int characters)
+{
+    QString text;
+    for (int index = 0; index < characters; index++) {
+        int kind = qrand() % 4;
+        if (kind == 0) {
+            text.append(QChar(ushort(0x20 + qrand() % 0x5F)));
+        } else if (kind == 1) {
+            text.append(QChar(ushort(0x410 + qrand() % 0x40)));
+        } else if (kind == 2) {
+            text.append(QChar(ushort(0x4E00 + qrand() % 0x1000)));
+        } else {
+            uint codePoint = 0x1F600 + qrand() % 0x40 - 0x10000;
+            text.append(QChar(ushort(0xD800 + (codePoint >> 10))));
+            text.append(QChar(ushort(0xDC00 + (codePoint & 0x3FF))));
+        }
+    }
+    return text.toUtf8();
+}
+
+void Utf8DecoderTest::splitAtEveryPosition()
+{
+    QByteArray data("ASCII text long enough for a whole SSE2 block - "
+                    "\xD0\xA0\xD0\xB5\xD0\xB4 \xE2\x82\xAC "
+                    "\xF0\x9F\x98\x80 end");
+    QString expected = QString::fromUtf8(data);
+
+    for (int split = 0; split <= data.size(); split++) {
+        Utf8StreamDecoder decoder;
+        QString text = decoder.decode(data.left(split));
+        text.append(decoder.decode(data.mid(split)));
+        text.append(decoder.finish());
+        QCOMPARE(text, expected);
+    }
+}
+
+void Utf8DecoderTest::randomChunks()
+{
+    qsrand(2015);
+    for (int round = 0; round < 200; round++) {
+        QByteArray data = randomUtf8(qrand() % 2000);
+
+        Utf8StreamDecoder decoder;
+        QString text;
+        int position = 0;
+        while (position < data.size()) {
+            int chunkSize = qrand() % 64 + 1;
+            text.append(decoder.decode(data.mid(position, chunkSize)));
+            position += chunkSize;
+        }
+        text.append(decoder.finish());
+
+        QCOMPARE(text, QString::fromUtf8(data));
+    }
+}
+
+void Utf8DecoderTest::invalidSequences_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("expected");
+
+    QString replacement(QChar(QChar::ReplacementCharacter));
+
+    QTest::newRow("stray continuation bytes")
+            << QByteArray("a\xC0\x80" "b")
+            << "a" + replacement + replacement + "b";
+    QTest::newRow("overlong three-byte form")
+            << QByteArray("\xE0\x80\x80")
+            << replacement;
+    QTest::newRow("surrogate")
+            << QByteArray("\xED\xA0\x80")
+            << replacement;
+    QTest::newRow("above U+10FFFF")
+            << QByteArray("\xF4\x90\x80\x80")
+            << replacement;
+    QTest::newRow("interrupted sequence")
+            << QByteArray("\xE2(\xA1")
+            << replacement + "(" + replacement;
+}
+
+void Utf8DecoderTest::invalidSequences()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, expected);
+
+    Utf8StreamDecoder decoder;
+    QString text = decoder.decode(data);
+    text.append(decoder.finish());
+    QCOMPARE(text, expected);
+}
+
+void Utf8DecoderTest::incompleteSequenceAtEnd()
+{
+    Utf8StreamDecoder decoder;
+    QCOMPARE(decoder.decode(QByteArray("ab\xE2\x82")), QString("ab"));
+    QCOMPARE(decoder.finish(), QString(QChar(QChar::ReplacementCharacter)));
+    QCOMPARE(decoder.finish(), QString());
+}
+
+void Utf8DecoderTest::decodingBenchmark_data()
+{
+    QTest::addColumn<QByteArray>("line");
+
+    QTest::newRow("ASCII")
+            << QByteArray("Log line ") + QByteArray(90, 'x') + "\n";
+    QTest::newRow("Cyrillic")
+            << QByteArray("Log line ") + QByteArray(40, 'x') + " "
+               + QByteArray("\xD0\xA0\xD0\xB5\xD0\xB4 \xD0\xBD\xD0\xB0 ")
+               .repeated(3) + "\n";
+}
+
+void Utf8DecoderTest::decodingBenchmark()
+{
+    QFETCH(QByteArray, line);
+
+    // 8 MB of output in chunks of 64 kB, as read from a pipe:
+    QByteArray chunk = line.repeated(65536 / line.size() + 1).left(65536);
+    int chunks = 128;
+
+    QBENCHMARK {
+        Utf8StreamDecoder decoder;
+        int characters = 0;
+        for (int index = 0; index < chunks; index++) {
+            characters += decoder.decode(chunk).size();
+        }
+        characters += decoder.finish().size();
+        QVERIFY(characters > 0);
+    }
+}
+
+QTEST_MAIN(Utf8DecoderTest)
+#include "tst_utf8decoder.moc"
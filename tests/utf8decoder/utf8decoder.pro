@@ -0,0 +1,8 @@
+# UTF-8 stream decoder: chunk boundaries, invalid sequences and throughput.
+
+TEMPLATE = app
+TARGET = tst_utf8decoder
+
+include (../browser.pri)
+
+SOURCES += tst_utf8decoder.cpp
@@ -0,0 +1,8 @@
+/* adler32() of zlib without the SIMD kernels, renamed to z_adler32(),
+   as the baseline of the checksum test and benchmark. */
+
+#ifndef NO_X86_SIMD
+#  define NO_X86_SIMD
+#endif
+#define Z_PREFIX
+#include "../../src/zlib/adler32.c"
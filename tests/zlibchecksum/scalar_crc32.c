@@ -0,0 +1,8 @@
+/* crc32() of zlib without the SIMD kernels, renamed to z_crc32(),
+   as the baseline of the checksum test and benchmark. */
+
+#ifndef NO_X86_SIMD
+#  define NO_X86_SIMD
+#endif
+#define Z_PREFIX
+#include "../../src/zlib/crc32.c"
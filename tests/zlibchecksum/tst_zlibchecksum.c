@@ -0,0 +1,213 @@
+/* crc32() and adler32() are compared with the same functions built
+   without the SIMD kernels (z_crc32() and z_adler32()) and with bitwise
+   reference code on random lengths, alignments, seeds and split points.
+   The speed of both builds is printed in MB/s.
+   The program returns a non-zero exit status if any check fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "zutil.h"
+
+#define RANDOM_CASES 20000
+#define MAXIMAL_LENGTH 4096
+#define BENCHMARK_LENGTH (16 * 1048576)
+
+uLong z_adler32 OF((uLong adler, const Bytef *buf, uInt len));
+uLong z_crc32 OF((uLong crc, const Bytef *buf, uInt len));
+
+static int failures = 0;
+
+static void check(int condition, const char *description)
+{
+    printf("%s: %s\n", (condition ? "PASS" : "FAIL"), description);
+    if (!condition) {
+        failures++;
+    }
+}
+
+/* xorshift32: the same cases on every run and platform */
+static unsigned long randomState = 2015;
+
+static unsigned long randomNumber(void)
+{
+    randomState ^= (randomState << 13) & 0xffffffffUL;
+    randomState ^= randomState >> 17;
+    randomState ^= (randomState << 5) & 0xffffffffUL;
+    return randomState;
+}
+
+static uLong bitwiseCrc32(uLong crc, const unsigned char *data, size_t length)
+{
+    int bit;
+
+    crc = crc ^ 0xffffffffUL;
+    while (length--) {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320UL & (0UL - (crc & 1)));
+        }
+    }
+    return crc ^ 0xffffffffUL;
+}
+
+static uLong bitwiseAdler32(uLong adler, const unsigned char *data,
+                            size_t length)
+{
+    uLong sum1 = (adler & 0xffff) % 65521;
+    uLong sum2 = ((adler >> 16) & 0xffff) % 65521;
+
+    while (length--) {
+        sum1 = (sum1 + *data++) % 65521;
+        sum2 = (sum2 + sum1) % 65521;
+    }
+    return sum1 | (sum2 << 16);
+}
+
+static double seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void printKernels(void)
+{
+#ifdef X86_SIMD
+    int features = x86_cpu_features();
+
+    printf("Kernels: crc32 %s, adler32 %s\n",
+           (features & X86_PCLMUL) ? "PCLMULQDQ" : "tables",
+           (features & X86_AVX2) ? "AVX2" :
+           (features & X86_SSSE3) ? "SSSE3" : "scalar");
+#else
+    printf("Kernels: none, zlib is built without X86_SIMD\n");
+#endif
+}
+
+/* Random lengths around the 64-byte threshold of the kernels and beyond,
+   at every alignment, from random seeds and split at a random point. */
+static void randomCases(void)
+{
+    unsigned char *buffer = malloc(MAXIMAL_LENGTH + 64);
+    int crcMismatches = 0;
+    int adlerMismatches = 0;
+    int splitMismatches = 0;
+    int index;
+    size_t position;
+
+    for (index = 0; index < RANDOM_CASES; index++) {
+        size_t offset = randomNumber() % 64;
+        size_t length = (index % 2 == 0) ?
+                    randomNumber() % 256 :
+                    randomNumber() % (MAXIMAL_LENGTH + 1);
+        size_t split = length > 0 ? randomNumber() % (length + 1) : 0;
+        unsigned char *data = buffer + offset;
+        uLong crcSeed = randomNumber();
+        uLong adlerSeed;
+        uLong expected;
+
+        /* Saturated bytes stress the sums of the kernels: */
+        if (index % 10 == 0) {
+            memset(data, 0xff, length);
+        } else {
+            for (position = 0; position < length; position++) {
+                data[position] = (unsigned char)randomNumber();
+            }
+        }
+
+        /* Seeds with sums not below 65521 are valid input too: */
+        adlerSeed = (index % 100 == 0) ? randomNumber() :
+                    ((randomNumber() % 65521) << 16) | (randomNumber() % 65521);
+
+        expected = bitwiseCrc32(crcSeed, data, length);
+        if (crc32(crcSeed, data, (uInt)length) != expected ||
+                z_crc32(crcSeed, data, (uInt)length) != expected) {
+            crcMismatches++;
+        }
+        if (crc32(crc32(crcSeed, data, (uInt)split), data + split,
+                  (uInt)(length - split)) != expected) {
+            splitMismatches++;
+        }
+
+        expected = bitwiseAdler32(adlerSeed, data, length);
+        if (adler32(adlerSeed, data, (uInt)length) != expected ||
+                z_adler32(adlerSeed, data, (uInt)length) != expected) {
+            adlerMismatches++;
+        }
+        if (adler32(adler32(adlerSeed, data, (uInt)split), data + split,
+                    (uInt)(length - split)) != expected) {
+            splitMismatches++;
+        }
+    }
+
+    free(buffer);
+    check(crcMismatches == 0,
+          "crc32 of 20000 random cases matches the tables and bitwise code");
+    check(adlerMismatches == 0,
+          "adler32 of 20000 random cases matches the scalar and bitwise code");
+    check(splitMismatches == 0,
+          "checksums of split buffers match the checksums of whole buffers");
+}
+
+/* Long runs of 0xff exceed NMAX (5552) bytes between the reductions
+   of the scalar code, so the sums of the kernels must not overflow. */
+static void longSaturatedBuffer(void)
+{
+    size_t length = 3 * 1048576 + 7;
+    unsigned char *data = malloc(length);
+
+    memset(data, 0xff, length);
+    check(adler32(1, data, (uInt)length) == bitwiseAdler32(1, data, length),
+          "adler32 of 3 MB of 0xff matches the bitwise code");
+    check(crc32(0, data, (uInt)length) == z_crc32(0, data, (uInt)length),
+          "crc32 of 3 MB of 0xff matches the tables");
+    free(data);
+}
+
+static double megabytesPerSecond(uLong (*checksum)(uLong, const Bytef *, uInt),
+                                 const unsigned char *data, size_t length)
+{
+    volatile uLong value = 0;
+    int rounds = 0;
+    double start = seconds();
+    double elapsed;
+
+    do {
+        value ^= checksum(0, data, (uInt)length);
+        rounds++;
+        elapsed = seconds() - start;
+    } while (elapsed < 0.25);
+
+    return (double)rounds * length / 1048576 / elapsed;
+}
+
+static void benchmark(void)
+{
+    unsigned char *data = malloc(BENCHMARK_LENGTH);
+    size_t position;
+
+    for (position = 0; position < BENCHMARK_LENGTH; position++) {
+        data[position] = (unsigned char)randomNumber();
+    }
+
+    printf("crc32:   scalar %6.0f MB/s, SIMD %6.0f MB/s\n",
+           megabytesPerSecond(z_crc32, data, BENCHMARK_LENGTH),
+           megabytesPerSecond(crc32, data, BENCHMARK_LENGTH));
+    printf("adler32: scalar %6.0f MB/s, SIMD %6.0f MB/s\n",
+           megabytesPerSecond(z_adler32, data, BENCHMARK_LENGTH),
+           megabytesPerSecond(adler32, data, BENCHMARK_LENGTH));
+    free(data);
+}
+
+int main(void)
+{
+    printKernels();
+    randomCases();
+    longSaturatedBuffer();
+    benchmark();
+
+    printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
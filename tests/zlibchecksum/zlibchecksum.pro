@@ -0,0 +1,13 @@
+# crc32() and adler32() of zlib with the x86-64 SIMD kernels against
+# the table-driven and bitwise code, and their speed in MB/s.
+# Plain C: no Qt is needed.
+
+TEMPLATE = app
+TARGET = tst_zlibchecksum
+CONFIG += console testcase
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += $$PWD/../../src/zlib
+SOURCES += $$PWD/../../src/zlib/adler32.c $$PWD/../../src/zlib/crc32.c \
+    $$PWD/../../src/zlib/zutil.c
+SOURCES += scalar_adler32.c scalar_crc32.c tst_zlibchecksum.c
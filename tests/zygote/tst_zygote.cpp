@@ -0,0 +1,305 @@
+// Scripts are run by a real fork-server started from the zygote.pl resource.
+// No modules are preloaded, so only a Perl interpreter is needed.
+// Requests are attached to script jobs like in the browser, so
+// their records are read in the I/O thread.
+
+#include <QtTest>
+#include "peb.h"
+
+#ifndef Q_OS_WIN
+#include <signal.h> // for kill()
+#endif
+
+class ZygoteTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void reportsUnavailableForkServer();
+    void streamsStdinOutputAndErrors();
+    void streamsUploadDevice();
+    void appliesShebangSwitches();
+    void abortTerminatesProcessGroup();
+    void appliesGovernorSettings();
+    void abortKillsGroupIgnoringTerm();
+
+private:
+    QString writeScript(QString fileName, QByteArray contents);
+    static bool waitFor(QSignalSpy &spy, int milliseconds);
+    static QByteArray joined(QSignalSpy &spy);
+
+    QString testDirectoryName;
+};
+
+QString ZygoteTest::writeScript(QString fileName, QByteArray contents)
+{
+    QString scriptFileName = testDirectoryName + "/" + fileName;
+    QFile scriptFile(scriptFileName);
+    scriptFile.open(QIODevice::WriteOnly);
+    scriptFile.write(contents);
+    scriptFile.close();
+    return scriptFileName;
+}
+
+bool ZygoteTest::waitFor(QSignalSpy &spy, int milliseconds)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (spy.count() == 0 and timer.elapsed() < milliseconds) {
+        QTest::qWait(10);
+    }
+    return spy.count() > 0;
+}
+
+QByteArray ZygoteTest::joined(QSignalSpy &spy)
+{
+    QByteArray data;
+    for (int index = 0; index < spy.count(); index++) {
+        data.append(spy.at(index).at(0).toByteArray());
+    }
+    return data;
+}
+
+void ZygoteTest::initTestCase()
+{
+    testDirectoryName = QDir::tempPath() + "/peb-zygote-test-"
+            + QString::number(QCoreApplication::applicationPid());
+    QVERIFY(QDir().mkpath(testDirectoryName));
+
+    qApp->setProperty("applicationTempDirectory", testDirectoryName);
+    qApp->setProperty("perlInterpreter", "perl");
+    qApp->setProperty("perlLib", QString());
+    qApp->setProperty("zygotePreloadModules", QStringList());
+
+    // Governor settings applied by the fork-server to every script:
+    qApp->setProperty("openFilesLimit", 32);
+    qApp->setProperty("niceLevel", 3);
+    qApp->setProperty("terminationGracePeriod", 500);
+
+    ZygoteServer::instance()->startSlot();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!ZygoteServer::instance()->isReady() and timer.elapsed() < 10000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(ZygoteServer::instance()->isReady());
+}
+
+void ZygoteTest::cleanupTestCase()
+{
+    QDir testDirectory(testDirectoryName);
+    foreach (QString fileName, testDirectory.entryList(QDir::Files)) {
+        testDirectory.remove(fileName);
+    }
+    QDir().rmdir(testDirectoryName);
+}
+
+void ZygoteTest::reportsUnavailableForkServer()
+{
+    // Even an immediate failure is delivered through the ring buffer:
+    ScriptJob job(0, testDirectoryName + "/missing.pl");
+    QSignalSpy errorSpy(&job, SIGNAL(errorSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+
+    job.attachRequest(new ZygoteRequest(&job,
+                                        testDirectoryName + "/missing.sock",
+                                        testDirectoryName + "/missing.pl",
+                                        testDirectoryName,
+                                        QProcessEnvironment(), QByteArray()));
+
+    QVERIFY(waitFor(finishedSpy, 5000));
+    QVERIFY(joined(errorSpy).contains("Fork-server is not available"));
+}
+
+void ZygoteTest::streamsStdinOutputAndErrors()
+{
+    QString scriptFileName = writeScript(
+                "stdin_test.pl",
+                "binmode STDIN;\n"
+                "my $length = 0;\n"
+                "while (sysread (STDIN, my $data, 4096)) {\n"
+                "    $length += length ($data);\n"
+                "}\n"
+                "print STDERR \"error line\\n\";\n"
+                "print \"length=$length variable=$ENV{PEB_TEST_VARIABLE}\\n\";\n");
+
+    QProcessEnvironment environment;
+    environment.insert("PEB_TEST_VARIABLE", "value");
+    QByteArray stdinData(300000, 'x');
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy errorSpy(&job, SIGNAL(errorSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.attachRequest(ZygoteServer::instance()
+                      ->startRequest(&job, scriptFileName, testDirectoryName,
+                                     environment, stdinData));
+
+    QVERIFY(waitFor(finishedSpy, 10000));
+    QCOMPARE(joined(outputSpy),
+             QByteArray("length=300000 variable=value\n"));
+    QCOMPARE(joined(errorSpy), QByteArray("error line\n"));
+}
+
+void ZygoteTest::streamsUploadDevice()
+{
+    // More than the STDIN buffer of the fork-server, read slowly:
+    QString scriptFileName = writeScript(
+                "upload_test.pl",
+                "binmode STDIN;\n"
+                "my ($length, $checksum) = (0, 0);\n"
+                "while (sysread (STDIN, my $data, 65536)) {\n"
+                "    $length += length ($data);\n"
+                "    $checksum = ($checksum + unpack ('%32C*', $data)) % 4294967296;\n"
+                "    select (undef, undef, undef, 0.001);\n"
+                "}\n"
+                "print \"$length $checksum\\n\";\n");
+
+    QByteArray uploadData(3 * 1048576, char(0));
+    quint32 checksum = 0;
+    qsrand(2015);
+    for (int index = 0; index < uploadData.size(); index++) {
+        uploadData[index] = char(qrand() % 256);
+        checksum += (unsigned char) uploadData.at(index);
+    }
+
+    QBuffer uploadBuffer(&uploadData);
+    uploadBuffer.open(QIODevice::ReadOnly);
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.uploadDevice = &uploadBuffer;
+    job.attachRequest(ZygoteServer::instance()
+                      ->startRequest(&job, scriptFileName, testDirectoryName,
+                                     QProcessEnvironment(), QByteArray()));
+
+    QVERIFY(waitFor(finishedSpy, 30000));
+    QCOMPARE(joined(outputSpy),
+             QByteArray::number(uploadData.size()) + " "
+             + QByteArray::number(checksum) + "\n");
+    QCOMPARE(job.uploadedBytes, (qint64) uploadData.size());
+}
+
+void ZygoteTest::appliesShebangSwitches()
+{
+    QString scriptFileName = writeScript(
+                "switches_test.pl",
+                "#!/usr/bin/perl -T\n"
+                "print \"taint=${^TAINT}\\n\";\n");
+
+    QProcessEnvironment environment;
+    environment.insert("PATH", "/usr/bin:/bin");
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.attachRequest(ZygoteServer::instance()
+                      ->startRequest(&job, scriptFileName, testDirectoryName,
+                                     environment, QByteArray()));
+
+    QVERIFY(waitFor(finishedSpy, 10000));
+    QCOMPARE(joined(outputSpy), QByteArray("taint=1\n"));
+}
+
+void ZygoteTest::abortTerminatesProcessGroup()
+{
+#ifndef Q_OS_WIN
+    QString scriptFileName = writeScript(
+                "abort_test.pl",
+                "$| = 1;\n"
+                "print getpgrp(), \"\\n\";\n"
+                "sleep 30;\n");
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.attachRequest(ZygoteServer::instance()
+                      ->startRequest(&job, scriptFileName, testDirectoryName,
+                                     QProcessEnvironment(), QByteArray()));
+
+    QVERIFY(waitFor(outputSpy, 10000));
+    pid_t processGroup = (pid_t) joined(outputSpy).trimmed().toLongLong();
+    QVERIFY(processGroup > 0);
+    QCOMPARE(::kill(-processGroup, 0), 0);
+
+    job.abortSlot();
+    QVERIFY(waitFor(finishedSpy, 1000));
+
+    QElapsedTimer timer;
+    timer.start();
+    while (::kill(-processGroup, 0) == 0 and timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(::kill(-processGroup, 0) != 0);
+#endif
+}
+
+void ZygoteTest::appliesGovernorSettings()
+{
+    QString scriptFileName = writeScript(
+                "governor_test.pl",
+                "my @files;\n"
+                "for (1 .. 100) {\n"
+                "    open (my $file, '<', $0) or last;\n"
+                "    push @files, $file;\n"
+                "}\n"
+                "print 'nice=', getpriority (0, 0), ' files=',\n"
+                "    scalar (@files), \"\\n\";\n");
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    QSignalSpy finishedSpy(&job, SIGNAL(finishedSignal()));
+    job.attachRequest(ZygoteServer::instance()
+                      ->startRequest(&job, scriptFileName, testDirectoryName,
+                                     QProcessEnvironment(), QByteArray()));
+
+    QVERIFY(waitFor(finishedSpy, 10000));
+    QByteArray output = joined(outputSpy);
+    QVERIFY2(output.startsWith("nice=3 files="), output.constData());
+
+    // STDIN, STDOUT, STDERR and the script file itself are open:
+    int files = output.trimmed().split('=').last().toInt();
+    QVERIFY(files > 0 and files < 32);
+}
+
+void ZygoteTest::abortKillsGroupIgnoringTerm()
+{
+#ifndef Q_OS_WIN
+    QString scriptFileName = writeScript(
+                "ignore_term_test.pl",
+                "$SIG{TERM} = 'IGNORE';\n"
+                "$| = 1;\n"
+                "print getpgrp(), \"\\n\";\n"
+                "sleep 30;\n");
+
+    ScriptJob job(0, scriptFileName);
+    QSignalSpy outputSpy(&job, SIGNAL(outputSignal(QByteArray)));
+    job.attachRequest(ZygoteServer::instance()
+                      ->startRequest(&job, scriptFileName, testDirectoryName,
+                                     QProcessEnvironment(), QByteArray()));
+
+    QVERIFY(waitFor(outputSpy, 10000));
+    pid_t processGroup = (pid_t) joined(outputSpy).trimmed().toLongLong();
+    QVERIFY(processGroup > 0);
+
+    job.abortSlot();
+
+    // Still alive during the grace period and killed after it:
+    QTest::qWait(200);
+    QCOMPARE(::kill(-processGroup, 0), 0);
+
+    QElapsedTimer timer;
+    timer.start();
+    while (::kill(-processGroup, 0) == 0 and timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    QVERIFY(::kill(-processGroup, 0) != 0);
+#endif
+}
+
+QTEST_MAIN(ZygoteTest)
+#include "tst_zygote.moc"
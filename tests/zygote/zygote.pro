@@ -0,0 +1,8 @@
+# Fork-server requests: streamed STDIN, STDOUT and STDERR and aborts.
+
+TEMPLATE = app
+TARGET = tst_zygote
+
+include (../browser.pri)
+
+SOURCES += tst_zygote.cpp